@@ -0,0 +1,62 @@
+#include "BackgroundTaskQueue.hpp"
+#include "Assert.hpp"
+
+
+namespace KK
+{
+
+BackgroundTaskQueue::BackgroundTaskQueue(const size_t thread_count)
+{
+	KK_ASSERT(thread_count >= 1u);
+
+	threads_.reserve(thread_count);
+	for(size_t i= 0u; i < thread_count; ++i)
+		threads_.emplace_back([this]{ WorkerThreadFunc(); });
+}
+
+BackgroundTaskQueue::~BackgroundTaskQueue()
+{
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		quit_= true;
+		tasks_.clear();
+	}
+	condition_.notify_all();
+
+	for(std::thread& thread : threads_)
+		thread.join();
+}
+
+size_t BackgroundTaskQueue::GetThreadCount() const
+{
+	return threads_.size();
+}
+
+void BackgroundTaskQueue::Push(TaskFunc func)
+{
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		tasks_.push_back(std::move(func));
+	}
+	condition_.notify_one();
+}
+
+void BackgroundTaskQueue::WorkerThreadFunc()
+{
+	while(true)
+	{
+		TaskFunc func;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this]{ return quit_ || !tasks_.empty(); });
+			if(quit_)
+				return;
+			func= std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+
+		func();
+	}
+}
+
+} // namespace KK
@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace KK
+{
+
+// Pool of persistent threads for long tasks, executed in background in order of pushing.
+// Unlike "ThreadPool" caller doesn't wait for tasks, so, tasks must publish their results themselves.
+class BackgroundTaskQueue final
+{
+public:
+	using TaskFunc= std::function<void()>;
+
+	explicit BackgroundTaskQueue(size_t thread_count);
+	// Waits for running tasks. Not started tasks are discarded.
+	~BackgroundTaskQueue();
+
+	BackgroundTaskQueue(const BackgroundTaskQueue&)= delete;
+	BackgroundTaskQueue& operator=(const BackgroundTaskQueue&)= delete;
+
+	size_t GetThreadCount() const;
+
+	void Push(TaskFunc func);
+
+private:
+	void WorkerThreadFunc();
+
+private:
+	std::vector<std::thread> threads_;
+
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::deque<TaskFunc> tasks_;
+	bool quit_= false;
+};
+
+} // namespace KK
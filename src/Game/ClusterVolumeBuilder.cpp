@@ -1,6 +1,13 @@
 #include "ClusterVolumeBuilder.hpp"
 #include "Assert.hpp"
 #include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define KK_CLUSTERS_USE_SSE
+#endif
 
 
 namespace KK
@@ -20,15 +27,74 @@ float WUnmappingFunction(const m_Vec2& w_convert_values, const float slice_numbe
 	return w_convert_values.y / std::exp2(slice_number / w_convert_values.x);
 }
 
+// Reserve space for counter and 31 elements for each cluster in average.
+// With wide ids more elements are expected, so, reserve more space.
+const size_t c_elements_list_capacity_per_cluster_id8= 32u;
+const size_t c_elements_list_capacity_per_cluster_id16= 64u;
+
+size_t GetListFormatElementSize(const ClusterVolumeBuilder::ListFormat list_format)
+{
+	return list_format == ClusterVolumeBuilder::ListFormat::Id8 ? sizeof(uint8_t) : sizeof(uint16_t);
+}
+
+size_t GetListFormatCapacityPerCluster(const ClusterVolumeBuilder::ListFormat list_format)
+{
+	return
+		list_format == ClusterVolumeBuilder::ListFormat::Id8
+			? c_elements_list_capacity_per_cluster_id8
+			: c_elements_list_capacity_per_cluster_id16;
+}
+
+// Counter must fit into list element.
+size_t GetListFormatMaxElementsPerCluster(const ClusterVolumeBuilder::ListFormat list_format)
+{
+	return list_format == ClusterVolumeBuilder::ListFormat::Id8 ? std::numeric_limits<uint8_t>::max() : std::numeric_limits<uint16_t>::max();
+}
+
 } // namespace
 
 ClusterVolumeBuilder::ClusterVolumeBuilder(
 	const uint32_t width,
 	const uint32_t height,
-	const uint32_t depth)
+	const uint32_t depth,
+	const ListFormat list_format)
 	: size_{ width, height, depth }
-	, clusters_(width * height * depth)
-{}
+	, list_format_(list_format)
+	, max_elements_per_cluster_(GetListFormatMaxElementsPerCluster(list_format))
+	, slices_w_(depth + 1u, 0.0f)
+	, elements_count_(width * height * depth, 0u)
+	, write_positions_(width * height * depth, 0u)
+	, offsets_(width * height * depth, 0u)
+	, elements_list_capacity_(width * height * depth * GetListFormatCapacityPerCluster(list_format))
+{
+	KK_ASSERT(width  <= std::numeric_limits<uint16_t>::max());
+	KK_ASSERT(height <= std::numeric_limits<uint16_t>::max());
+	KK_ASSERT(depth  <= std::numeric_limits<uint16_t>::max());
+
+	elements_list_.resize(elements_list_capacity_ * GetElementSize(), 0u);
+
+	// Reserve enough ranges for case, where each possible element of compact format affects all slices.
+	// For wide format vectors may grow.
+	const size_t elements_to_reserve= GetListFormatMaxElementsPerCluster(ListFormat::Id8) + 1u;
+	ranges_.reserve(elements_to_reserve * depth);
+	spheres_.reserve(elements_to_reserve);
+}
+
+void ClusterVolumeBuilder::SetThreadCount(const size_t thread_count)
+{
+	KK_ASSERT(thread_count >= 1u);
+	if(thread_count == GetThreadCount())
+		return;
+
+	thread_pool_.reset();
+	if(thread_count > 1u)
+		thread_pool_= std::make_unique<ThreadPool>(thread_count);
+}
+
+size_t ClusterVolumeBuilder::GetThreadCount() const
+{
+	return thread_pool_ == nullptr ? 1u : thread_pool_->GetThreadCount();
+}
 
 void ClusterVolumeBuilder::SetMatrix(const m_Mat4& mat, const float z_near, const float z_far)
 {
@@ -43,12 +109,26 @@ void ClusterVolumeBuilder::SetMatrix(const m_Mat4& mat, const float z_near, cons
 	*/
 	w_convert_values_.x= float(size_[2]) / std::log2(z_near / z_far);
 	w_convert_values_.y= z_near;
+
+	// Precalculate W for slices borders.
+	for(size_t i= 0u; i < slices_w_.size(); ++i)
+		slices_w_[i]= WUnmappingFunction(w_convert_values_, float(i));
+
+	// View matrix is rigid, so, length of matrix columns are equal to scale of projection.
+	// Use it in order to reconstruct view space coordinates from clip space coordinates.
+	projection_scale_.x= m_Vec3(mat.value[0], mat.value[4], mat.value[ 8]).GetLength();
+	projection_scale_.y= m_Vec3(mat.value[1], mat.value[5], mat.value[ 9]).GetLength();
+}
+
+void ClusterVolumeBuilder::SetRefinementEnabled(const bool enabled)
+{
+	refinement_enabled_= enabled;
 }
 
 void ClusterVolumeBuilder::ClearClusters()
 {
-	for(Cluster& cluster : clusters_)
-		cluster.elements.clear();
+	ranges_.clear();
+	spheres_.clear();
 }
 
 bool ClusterVolumeBuilder::AddSphere(const m_Vec3& center, const float radius, const ElementId id)
@@ -88,20 +168,135 @@ bool ClusterVolumeBuilder::AddSphere(const m_Vec3& center, const float radius, c
 		w_max= std::max(w_max, w);
 	}
 
+	SphereProjection projection;
+	projection.bb_min= bb_min;
+	projection.bb_max= bb_max;
+	projection.w_min= w_min;
+	projection.w_max= w_max;
+	projection.center= center;
+	projection.radius= radius;
+	return AddProjectedSphere(projection, id);
+}
+
+size_t ClusterVolumeBuilder::AddSpheres(
+	const m_Vec3* const centers,
+	const float* const radii,
+	const size_t count,
+	const ElementId first_id,
+	bool* const out_added)
+{
+	size_t added_count= 0u;
+	size_t i= 0u;
+
+#ifdef KK_CLUSTERS_USE_SSE
+	// Project 4 spheres at once.
+	// Perform exactly same operations in same order, as scalar code does, in order to get bit-identical result.
+
+	const __m128 m[16]
+	{
+		_mm_set1_ps(matrix_.value[ 0]), _mm_set1_ps(matrix_.value[ 1]), _mm_set1_ps(matrix_.value[ 2]), _mm_set1_ps(matrix_.value[ 3]),
+		_mm_set1_ps(matrix_.value[ 4]), _mm_set1_ps(matrix_.value[ 5]), _mm_set1_ps(matrix_.value[ 6]), _mm_set1_ps(matrix_.value[ 7]),
+		_mm_set1_ps(matrix_.value[ 8]), _mm_set1_ps(matrix_.value[ 9]), _mm_set1_ps(matrix_.value[10]), _mm_set1_ps(matrix_.value[11]),
+		_mm_set1_ps(matrix_.value[12]), _mm_set1_ps(matrix_.value[13]), _mm_set1_ps(matrix_.value[14]), _mm_set1_ps(matrix_.value[15]),
+	};
+
+	for(; i + 4u <= count; i+= 4u)
+	{
+		const __m128 center_x= _mm_setr_ps(centers[i].x, centers[i + 1u].x, centers[i + 2u].x, centers[i + 3u].x);
+		const __m128 center_y= _mm_setr_ps(centers[i].y, centers[i + 1u].y, centers[i + 2u].y, centers[i + 3u].y);
+		const __m128 center_z= _mm_setr_ps(centers[i].z, centers[i + 1u].z, centers[i + 2u].z, centers[i + 3u].z);
+		const __m128 radius= _mm_loadu_ps(radii + i);
+
+		const __m128 x_values[2]{ _mm_add_ps(center_x, radius), _mm_sub_ps(center_x, radius) };
+		const __m128 y_values[2]{ _mm_add_ps(center_y, radius), _mm_sub_ps(center_y, radius) };
+		const __m128 z_values[2]{ _mm_add_ps(center_z, radius), _mm_sub_ps(center_z, radius) };
+
+		__m128 bb_min_x= _mm_set1_ps(+1e24f);
+		__m128 bb_min_y= _mm_set1_ps(+1e24f);
+		__m128 bb_max_x= _mm_set1_ps(-1e24f);
+		__m128 bb_max_y= _mm_set1_ps(-1e24f);
+		__m128 w_min= _mm_set1_ps(+1e24f);
+		__m128 w_max= _mm_set1_ps(-1e24f);
+		for(size_t corner= 0u; corner < 8u; ++corner)
+		{
+			const __m128 x= x_values[(corner >> 2u) & 1u];
+			const __m128 y= y_values[(corner >> 1u) & 1u];
+			const __m128 z= z_values[(corner >> 0u) & 1u];
+
+			const __m128 proj_x=
+				_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m[0]), _mm_mul_ps(y, m[4])), _mm_mul_ps(z, m[ 8])), m[12]);
+			const __m128 proj_y=
+				_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m[1]), _mm_mul_ps(y, m[5])), _mm_mul_ps(z, m[ 9])), m[13]);
+			const __m128 w=
+				_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[3], x), _mm_mul_ps(m[7], y)), _mm_mul_ps(m[11], z)), m[15]);
+
+			// Argument order is important here - it gives same result as std::min/std::max.
+			bb_min_x= _mm_min_ps(proj_x, bb_min_x);
+			bb_min_y= _mm_min_ps(proj_y, bb_min_y);
+			bb_max_x= _mm_max_ps(proj_x, bb_max_x);
+			bb_max_y= _mm_max_ps(proj_y, bb_max_y);
+			w_min= _mm_min_ps(w, w_min);
+			w_max= _mm_max_ps(w, w_max);
+		}
+
+		float bb_min_x_values[4], bb_min_y_values[4], bb_max_x_values[4], bb_max_y_values[4], w_min_values[4], w_max_values[4];
+		_mm_storeu_ps(bb_min_x_values, bb_min_x);
+		_mm_storeu_ps(bb_min_y_values, bb_min_y);
+		_mm_storeu_ps(bb_max_x_values, bb_max_x);
+		_mm_storeu_ps(bb_max_y_values, bb_max_y);
+		_mm_storeu_ps(w_min_values, w_min);
+		_mm_storeu_ps(w_max_values, w_max);
+
+		for(size_t j= 0u; j < 4u; ++j)
+		{
+			SphereProjection projection;
+			projection.bb_min= m_Vec2(bb_min_x_values[j], bb_min_y_values[j]);
+			projection.bb_max= m_Vec2(bb_max_x_values[j], bb_max_y_values[j]);
+			projection.w_min= w_min_values[j];
+			projection.w_max= w_max_values[j];
+			projection.center= centers[i + j];
+			projection.radius= radii[i + j];
+
+			const bool added= AddProjectedSphere(projection, ElementId(first_id + added_count));
+			out_added[i + j]= added;
+			added_count+= added ? 1u : 0u;
+		}
+	}
+#endif
+
+	// Process remaining spheres.
+	for(; i < count; ++i)
+	{
+		const bool added= AddSphere(centers[i], radii[i], ElementId(first_id + added_count));
+		out_added[i]= added;
+		added_count+= added ? 1u : 0u;
+	}
+
+	return added_count;
+}
+
+bool ClusterVolumeBuilder::AddProjectedSphere(const SphereProjection& projection, const ElementId id)
+{
+	const m_Vec2& bb_min= projection.bb_min;
+	const m_Vec2& bb_max= projection.bb_max;
+
 	// Clamp values - logarith function exists only for positive numbers.
-	w_min= std::max(w_min, 0.0001f);
-	w_max= std::max(w_max, 0.0001f);
+	const float w_min= std::max(projection.w_min, 0.0001f);
+	const float w_max= std::max(projection.w_max, 0.0001f);
 
 	const int32_t slice_min= int32_t(WMappingFunction(w_convert_values_, w_min));
 	const int32_t slice_max= int32_t(WMappingFunction(w_convert_values_, w_max));
 	if(slice_max < 0 || slice_min >= int32_t(size_[2]))
 		return false;
 
+	KK_ASSERT(spheres_.size() <= std::numeric_limits<uint16_t>::max());
+	const uint16_t sphere_index= uint16_t(spheres_.size());
+
 	bool added= false;
 	for(int32_t slice= std::max(0, slice_min); slice <= std::min(slice_max, int32_t(size_[2]) - 1); ++slice)
 	{
-		const float slice_w_min= std::max(w_min, WUnmappingFunction(w_convert_values_, float(slice    )));
-		const float slice_w_max= std::min(w_max, WUnmappingFunction(w_convert_values_, float(slice + 1)));
+		const float slice_w_min= std::max(w_min, slices_w_[size_t(slice)]);
+		const float slice_w_max= std::min(w_max, slices_w_[size_t(slice + 1)]);
 		KK_ASSERT(slice_w_min > 0.0f);
 		KK_ASSERT(slice_w_max > 0.0f);
 
@@ -115,21 +310,189 @@ bool ClusterVolumeBuilder::AddSphere(const m_Vec3& center, const float radius, c
 		const int32_t cluster_min_y= int32_t((slice_min_y * 0.5f + 0.5f) * float(size_[1]));
 		const int32_t cluster_max_y= int32_t((slice_max_y * 0.5f + 0.5f) * float(size_[1]));
 
-		added= added | (cluster_min_x <= cluster_max_x && cluster_min_y <= cluster_max_y);
-		for(int32_t y= cluster_min_y; y <= cluster_max_y; ++y)
-		for(int32_t x= cluster_min_x; x <= cluster_max_x; ++x)
+		if(cluster_min_x > cluster_max_x || cluster_min_y > cluster_max_y)
+			continue;
+
+		KK_ASSERT(cluster_min_x >= 0 && cluster_max_x < int32_t(size_[0]));
+		KK_ASSERT(cluster_min_y >= 0 && cluster_max_y < int32_t(size_[1]));
+		KK_ASSERT(slice >= 0 && slice < int32_t(size_[2]));
+
+		ClustersRange range;
+		range.id= id;
+		range.sphere_index= sphere_index;
+		range.slice= uint16_t(slice);
+		range.min_x= uint16_t(cluster_min_x);
+		range.max_x= uint16_t(cluster_max_x);
+		range.min_y= uint16_t(cluster_min_y);
+		range.max_y= uint16_t(cluster_max_y);
+		ranges_.push_back(range);
+
+		added= true;
+	}
+
+	if(added)
+	{
+		ViewSpaceSphere sphere;
+		sphere.center=
+			m_Vec3(
+				(matrix_.value[0] * projection.center.x + matrix_.value[4] * projection.center.y + matrix_.value[ 8] * projection.center.z + matrix_.value[12]) / projection_scale_.x,
+				(matrix_.value[1] * projection.center.x + matrix_.value[5] * projection.center.y + matrix_.value[ 9] * projection.center.z + matrix_.value[13]) / projection_scale_.y,
+				(matrix_.value[3] * projection.center.x + matrix_.value[7] * projection.center.y + matrix_.value[11] * projection.center.z + matrix_.value[15]));
+		sphere.radius= projection.radius;
+		spheres_.push_back(sphere);
+	}
+
+	return added;
+}
+
+void ClusterVolumeBuilder::BuildLists()
+{
+	const size_t cluster_count= offsets_.size();
+	const size_t capacity= elements_list_capacity_;
+	const uint32_t slice_size= size_[0] * size_[1];
+
+	if(thread_pool_ == nullptr)
+	{
+		refinement_removed_elements_= CountElements(0u, size_[2]).refinement_removed_elements;
+		const size_t end_offset= CalculateOffsets(0u, uint32_t(cluster_count), 0u);
+		ScatterElements(0u, size_[2]);
+
+		// Vulkan requires multiple of 4 sizes.
+		elements_list_size_= std::min((end_offset + 3u) & ~size_t(3u), capacity);
+		return;
+	}
+
+	const size_t task_count= thread_pool_->GetThreadCount();
+	tasks_count_results_.resize(task_count);
+
+	thread_pool_->Run(
+		task_count,
+		[&](const size_t task_index)
 		{
-			KK_ASSERT(x >= 0 && x < int32_t(size_[0]));
-			KK_ASSERT(y >= 0 && y < int32_t(size_[1]));
-			KK_ASSERT(slice >= 0 && slice < int32_t(size_[2]));
-
-			clusters_[
-				x +
-				y * int32_t(size_[0]) +
-				slice * int32_t(size_[0] * size_[1])].elements.push_back(id);
+			tasks_count_results_[task_index]=
+				CountElements(GetTaskSliceBegin(task_index, task_count), GetTaskSliceBegin(task_index + 1u, task_count));
+		});
+
+	size_t total_size= 0u;
+	refinement_removed_elements_= 0u;
+	for(const CountResult& count_result : tasks_count_results_)
+	{
+		total_size+= count_result.lists_size;
+		refinement_removed_elements_+= count_result.refinement_removed_elements;
+	}
+
+	size_t end_offset= 0u;
+	if(total_size <= capacity)
+	{
+		// All lists fit, so, offsets of each slices range are known and can be calculated in parallel.
+		thread_pool_->Run(
+			task_count,
+			[&](const size_t task_index)
+			{
+				size_t start_offset= 0u;
+				for(size_t i= 0u; i < task_index; ++i)
+					start_offset+= tasks_count_results_[i].lists_size;
+
+				CalculateOffsets(
+					GetTaskSliceBegin(task_index, task_count) * slice_size,
+					GetTaskSliceBegin(task_index + 1u, task_count) * slice_size,
+					start_offset);
+				ScatterElements(GetTaskSliceBegin(task_index, task_count), GetTaskSliceBegin(task_index + 1u, task_count));
+			});
+		end_offset= total_size;
+	}
+	else
+	{
+		// Some elements will be dropped. Calculate offsets sequentially in order to drop exactly same elements, as in single thread mode.
+		end_offset= CalculateOffsets(0u, uint32_t(cluster_count), 0u);
+		thread_pool_->Run(
+			task_count,
+			[&](const size_t task_index)
+			{
+				ScatterElements(GetTaskSliceBegin(task_index, task_count), GetTaskSliceBegin(task_index + 1u, task_count));
+			});
+	}
+
+	// Vulkan requires multiple of 4 sizes.
+	elements_list_size_= std::min((end_offset + 3u) & ~size_t(3u), capacity);
+}
+
+ClusterVolumeBuilder::CountResult ClusterVolumeBuilder::CountElements(const uint32_t slice_begin, const uint32_t slice_end)
+{
+	const uint32_t slice_size= size_[0] * size_[1];
+	std::fill(elements_count_.begin() + slice_begin * slice_size, elements_count_.begin() + slice_end * slice_size, 0u);
+
+	CountResult result{ 0u, 0u };
+	for(const ClustersRange& range : ranges_)
+	{
+		if(range.slice < slice_begin || range.slice >= slice_end)
+			continue;
+
+		for(uint32_t y= range.min_y; y <= range.max_y; ++y)
+		for(uint32_t x= range.min_x; x <= range.max_x; ++x)
+		{
+			if(refinement_enabled_ && !IsSphereIntersectsCluster(spheres_[range.sphere_index], x, y, range.slice))
+			{
+				++result.refinement_removed_elements;
+				continue;
+			}
+			++elements_count_[GetClusterIndex(x, y, range.slice)];
+		}
+	}
+
+	// Each list contains counter and elements.
+	for(uint32_t i= slice_begin * slice_size; i < slice_end * slice_size; ++i)
+		result.lists_size+= 1u + std::min(size_t(elements_count_[i]), max_elements_per_cluster_);
+
+	return result;
+}
+
+size_t ClusterVolumeBuilder::CalculateOffsets(const uint32_t cluster_begin, const uint32_t cluster_end, const size_t start_offset)
+{
+	const size_t cluster_count= offsets_.size();
+	const size_t capacity= elements_list_capacity_;
+
+	// Calculate offsets, using prefix sum of elements count.
+	size_t offset= start_offset;
+	for(uint32_t i= cluster_begin; i < cluster_end; ++i)
+	{
+		// Always keep space for counters of this and all following clusters. Drop elements, which do not fit.
+		const size_t space_left= capacity - offset - (cluster_count - i);
+		const size_t count= std::min(std::min(size_t(elements_count_[i]), max_elements_per_cluster_), space_left);
+
+		offsets_[i]= OffsetType(offset);
+		SetListElement(offset, count);
+		write_positions_[i]= uint32_t(offset + 1u);
+		elements_count_[i]= uint32_t(count); // Now it is number of free positions in list of this cluster.
+
+		offset+= 1u + count;
+	}
+
+	return offset;
+}
+
+void ClusterVolumeBuilder::ScatterElements(const uint32_t slice_begin, const uint32_t slice_end)
+{
+	// Scatter elements, in order of addition.
+	for(const ClustersRange& range : ranges_)
+	{
+		if(range.slice < slice_begin || range.slice >= slice_end)
+			continue;
+
+		for(uint32_t y= range.min_y; y <= range.max_y; ++y)
+		for(uint32_t x= range.min_x; x <= range.max_x; ++x)
+		{
+			const uint32_t cluster_index= GetClusterIndex(x, y, range.slice);
+			if(elements_count_[cluster_index] == 0u)
+				continue;
+			if(refinement_enabled_ && !IsSphereIntersectsCluster(spheres_[range.sphere_index], x, y, range.slice))
+				continue;
+
+			--elements_count_[cluster_index];
+			SetListElement(write_positions_[cluster_index], range.id);
+			++write_positions_[cluster_index];
 		}
 	}
-	return added;
 }
 
 uint32_t ClusterVolumeBuilder::GetWidth () const
@@ -147,14 +510,100 @@ uint32_t ClusterVolumeBuilder::GetDepth () const
 	return size_[2];
 }
 
-const std::vector<ClusterVolumeBuilder::Cluster>& ClusterVolumeBuilder::GetClusters() const
+m_Vec2 ClusterVolumeBuilder::GetWConvertValues() const
 {
-	return clusters_;
+	return w_convert_values_;
 }
 
-m_Vec2 ClusterVolumeBuilder::GetWConvertValues() const
+const std::vector<ClusterVolumeBuilder::OffsetType>& ClusterVolumeBuilder::GetOffsets() const
 {
-	return w_convert_values_;
+	return offsets_;
+}
+
+const void* ClusterVolumeBuilder::GetElementsList() const
+{
+	return elements_list_.data();
+}
+
+size_t ClusterVolumeBuilder::GetElementsListSize() const
+{
+	return elements_list_size_;
+}
+
+size_t ClusterVolumeBuilder::GetElementsListCapacity() const
+{
+	return elements_list_capacity_;
+}
+
+ClusterVolumeBuilder::ListFormat ClusterVolumeBuilder::GetListFormat() const
+{
+	return list_format_;
+}
+
+size_t ClusterVolumeBuilder::GetElementSize() const
+{
+	return GetListFormatElementSize(list_format_);
+}
+
+size_t ClusterVolumeBuilder::GetMaxElements() const
+{
+	return max_elements_per_cluster_ + 1u;
+}
+
+size_t ClusterVolumeBuilder::GetRefinementRemovedElementsCount() const
+{
+	return refinement_removed_elements_;
+}
+
+bool ClusterVolumeBuilder::IsSphereIntersectsCluster(
+	const ViewSpaceSphere& sphere,
+	const uint32_t x,
+	const uint32_t y,
+	const uint32_t slice) const
+{
+	// Calculate view space bounding box of cluster and check distance from sphere center to it.
+	// Clusters on corners of sphere bounding rectangle are removed by this check.
+
+	const float w_min= slices_w_[slice];
+	const float w_max= slices_w_[slice + 1u];
+
+	const float x_min= float(x     ) / float(size_[0]) * 2.0f - 1.0f;
+	const float x_max= float(x + 1u) / float(size_[0]) * 2.0f - 1.0f;
+	const float y_min= float(y     ) / float(size_[1]) * 2.0f - 1.0f;
+	const float y_max= float(y + 1u) / float(size_[1]) * 2.0f - 1.0f;
+
+	const float view_x_min= std::min(x_min * w_min, x_min * w_max) / projection_scale_.x;
+	const float view_x_max= std::max(x_max * w_min, x_max * w_max) / projection_scale_.x;
+	const float view_y_min= std::min(y_min * w_min, y_min * w_max) / projection_scale_.y;
+	const float view_y_max= std::max(y_max * w_min, y_max * w_max) / projection_scale_.y;
+
+	const float dx= std::max(0.0f, std::max(view_x_min - sphere.center.x, sphere.center.x - view_x_max));
+	const float dy= std::max(0.0f, std::max(view_y_min - sphere.center.y, sphere.center.y - view_y_max));
+	const float dz= std::max(0.0f, std::max(w_min - sphere.center.z, sphere.center.z - w_max));
+
+	return dx * dx + dy * dy + dz * dz <= sphere.radius * sphere.radius;
+}
+
+void ClusterVolumeBuilder::SetListElement(const size_t index, const size_t value)
+{
+	KK_ASSERT(value <= max_elements_per_cluster_);
+	if(list_format_ == ListFormat::Id8)
+		elements_list_[index]= uint8_t(value);
+	else
+	{
+		const uint16_t value16= uint16_t(value);
+		std::memcpy(elements_list_.data() + index * sizeof(uint16_t), &value16, sizeof(uint16_t));
+	}
+}
+
+uint32_t ClusterVolumeBuilder::GetClusterIndex(const uint32_t x, const uint32_t y, const uint32_t slice) const
+{
+	return x + y * size_[0] + slice * (size_[0] * size_[1]);
+}
+
+uint32_t ClusterVolumeBuilder::GetTaskSliceBegin(const size_t task_index, const size_t task_count) const
+{
+	return uint32_t(size_t(size_[2]) * task_index / task_count);
 }
 
 } // namespace KK
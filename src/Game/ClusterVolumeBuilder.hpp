@@ -1,43 +1,140 @@
 #pragma once
 #include "../MathLib/Mat.hpp"
+#include "ThreadPool.hpp"
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 
 namespace KK
 {
 
+// Result of building is stored in format, directly used by GPU:
+// table of offsets for each cluster and elements list, where for each cluster elements count is followed by elements themselves.
+// All storage is preallocated, so, no dynamic allocations are needed for each frame.
 class ClusterVolumeBuilder final
 {
 public:
-	using ElementId= uint8_t; // TODO - maybe use less bits?
+	using ElementId= uint16_t;
+	using OffsetType= uint32_t;
 
-	struct Cluster
+	// Format of elements list. Counter of each list has same size, as element id.
+	enum class ListFormat
 	{
-		// TODO - remove dynamic allocation, use array with constant size or linked list.
-		std::vector<ElementId> elements;
+		Id8, // Up to 256 elements. Compact format.
+		Id16, // Up to 65536 elements.
 	};
 
 public:
-	ClusterVolumeBuilder(uint32_t width, uint32_t height, uint32_t depth);
+	ClusterVolumeBuilder(uint32_t width, uint32_t height, uint32_t depth, ListFormat list_format);
 
+	// Number of threads, used in "BuildLists". Each thread processes its own range of slices. Result does not depend on threads count.
+	void SetThreadCount(size_t thread_count);
+	size_t GetThreadCount() const;
+
+	// Matrix must be rigid view transformation, multiplied by perspective projection.
 	void SetMatrix(const m_Mat4& mat, float z_near, float z_far);
+
+	// If enabled, each cluster of element bounding rectangle is checked against element sphere, in order to remove clusters, not touched by sphere.
+	void SetRefinementEnabled(bool enabled);
 	void ClearClusters();
 
 	// Returns true, if added.
 	bool AddSphere(const m_Vec3& center, float radius, ElementId id);
 
+	// Add many spheres at once, using SIMD where it is available. Result is identical to sequential "AddSphere" calls.
+	// Added spheres get sequential ids, starting from "first_id". Result of adding of each sphere is written into "out_added".
+	// Returns number of added spheres.
+	size_t AddSpheres(const m_Vec3* centers, const float* radii, size_t count, ElementId first_id, bool* out_added);
+
+	// Fill offsets table and elements list. Call this after all elements are added.
+	void BuildLists();
+
 	uint32_t GetWidth () const;
 	uint32_t GetHeight() const;
 	uint32_t GetDepth () const;
-	const std::vector<Cluster>& GetClusters() const;
 	m_Vec2 GetWConvertValues() const;
 
+	// Results of "BuildLists".
+	const std::vector<OffsetType>& GetOffsets() const; // In elements.
+	const void* GetElementsList() const;
+	size_t GetElementsListSize() const; // In elements, aligned to 4 bytes.
+	size_t GetElementsListCapacity() const; // Maximum size of elements list.
+
+	ListFormat GetListFormat() const;
+	size_t GetElementSize() const; // In bytes.
+	size_t GetMaxElements() const; // Maximum number of different element ids.
+	size_t GetRefinementRemovedElementsCount() const; // Number of element-cluster pairs, removed by refinement.
+
+private:
+	// Rectangle of clusters in one slice, affected by one element.
+	struct ClustersRange
+	{
+		ElementId id;
+		uint16_t sphere_index;
+		uint16_t slice;
+		uint16_t min_x, max_x;
+		uint16_t min_y, max_y;
+	};
+
+	// Screen space bounding box of sphere, not divided by W.
+	struct SphereProjection
+	{
+		m_Vec2 bb_min;
+		m_Vec2 bb_max;
+		float w_min;
+		float w_max;
+		m_Vec3 center; // Source sphere.
+		float radius;
+	};
+
+	struct ViewSpaceSphere
+	{
+		m_Vec3 center;
+		float radius;
+	};
+
+	struct CountResult
+	{
+		size_t lists_size;
+		size_t refinement_removed_elements;
+	};
+
+private:
+	bool AddProjectedSphere(const SphereProjection& projection, ElementId id);
+
+	// Steps of lists building. Functions for different slices/clusters ranges may be called in parallel.
+	CountResult CountElements(uint32_t slice_begin, uint32_t slice_end);
+	size_t CalculateOffsets(uint32_t cluster_begin, uint32_t cluster_end, size_t start_offset); // Returns end offset.
+	void ScatterElements(uint32_t slice_begin, uint32_t slice_end);
+
+	bool IsSphereIntersectsCluster(const ViewSpaceSphere& sphere, uint32_t x, uint32_t y, uint32_t slice) const;
+	void SetListElement(size_t index, size_t value);
+	uint32_t GetClusterIndex(uint32_t x, uint32_t y, uint32_t slice) const;
+	uint32_t GetTaskSliceBegin(size_t task_index, size_t task_count) const;
+
 private:
 	const uint32_t size_[3];
-	std::vector<Cluster> clusters_;
+	const ListFormat list_format_;
+	const size_t max_elements_per_cluster_;
 	m_Mat4 matrix_;
 	m_Vec2 w_convert_values_;
+	std::vector<float> slices_w_; // W of borders between slices.
+	m_Vec2 projection_scale_;
+	bool refinement_enabled_= false;
+
+	std::vector<ClustersRange> ranges_; // In order of addition.
+	std::vector<ViewSpaceSphere> spheres_; // For each added element.
+	std::vector<uint32_t> elements_count_; // For each cluster.
+	std::vector<uint32_t> write_positions_; // For each cluster, used during lists building.
+	std::vector<OffsetType> offsets_;
+	std::vector<uint8_t> elements_list_; // Raw storage, element size depends on format.
+	size_t elements_list_capacity_= 0u;
+	size_t elements_list_size_= 0u;
+	size_t refinement_removed_elements_= 0u;
+
+	std::unique_ptr<ThreadPool> thread_pool_; // May be null for single thread.
+	std::vector<CountResult> tasks_count_results_; // For each thread task.
 };
 
 } // namespace KK
@@ -0,0 +1,625 @@
+#include "ClusterVolumeBuilderGPU.hpp"
+#include "Assert.hpp"
+#include "ShaderList.hpp"
+#include <cstring>
+
+
+namespace KK
+{
+
+namespace
+{
+
+struct DepthBoundsUniforms
+{
+	float matrix_values[4];
+	int32_t tiles_count[4];
+};
+
+static_assert(sizeof(ClusterVolumeBuilder::OffsetType) == 4u, "Invalid size");
+
+// Read list element from raw lights list, as shader does.
+size_t GetListElement(const uint8_t* const list, const ClusterVolumeBuilder::ListFormat list_format, const size_t index)
+{
+	if(list_format == ClusterVolumeBuilder::ListFormat::Id8)
+		return list[index];
+
+	uint16_t value;
+	std::memcpy(&value, list + index * sizeof(uint16_t), sizeof(uint16_t));
+	return value;
+}
+
+// Must match size in shader.
+const uint32_t c_workgroup_size= 64u;
+
+namespace ShaderBindings
+{
+
+const uint32_t light_buffer= 0u;
+const uint32_t cluster_offset_buffer= 1u;
+const uint32_t lights_list_buffer= 2u;
+const uint32_t counter_buffer= 3u;
+const uint32_t tile_depth_bounds_buffer= 4u;
+
+}
+
+namespace DepthBoundsShaderBindings
+{
+
+const uint32_t depth_image= 0u;
+const uint32_t tile_depth_bounds_buffer= 1u;
+
+}
+
+} // namespace
+
+ClusterVolumeBuilderGPU::ClusterVolumeBuilderGPU(
+	WindowVulkan& window_vulkan,
+	const ClusterVolumeBuilder& cpu_builder,
+	const vk::ImageView depth_image_view,
+	const vk::Buffer light_buffer,
+	const size_t light_buffer_size,
+	const vk::Buffer cluster_offset_buffer,
+	const vk::Buffer lights_list_buffer)
+	: vk_device_(window_vulkan.GetVulkanDevice())
+	, memory_properties_(window_vulkan.GetMemoryProperties())
+	, cluster_count_(cpu_builder.GetWidth() * cpu_builder.GetHeight() * cpu_builder.GetDepth())
+	, list_format_(cpu_builder.GetListFormat())
+	, lights_list_size_(cpu_builder.GetElementsListCapacity() * cpu_builder.GetElementSize())
+	, cluster_offset_buffer_(cluster_offset_buffer)
+	, lights_list_buffer_(lights_list_buffer)
+{
+	static_assert(sizeof(Uniforms) <= 128u, "Uniforms size is too big, limit is 128 bytes");
+
+	// Last 4 bytes of lights list are reserved for empty list, used in case of overflow.
+	KK_ASSERT(lights_list_size_ % 4u == 0u);
+	KK_ASSERT(lights_list_size_ >= cluster_count_ * cpu_builder.GetElementSize() + 4u);
+	KK_ASSERT(c_tiles_volume_size[0] * c_tiles_volume_size[1] * c_tiles_volume_size[2] <= cluster_count_);
+
+	counter_buffer_=
+		CreateBuffer(
+			sizeof(uint32_t),
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	tile_depth_bounds_buffer_=
+		CreateBuffer(
+			GetTileDepthBoundsBufferSize(),
+			vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	cluster_offset_read_back_buffer_=
+		CreateBuffer(
+			sizeof(ClusterVolumeBuilder::OffsetType) * cluster_count_,
+			vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+	lights_list_read_back_buffer_=
+		CreateBuffer(
+			lights_list_size_,
+			vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+	// Create pipeline.
+	shader_= CreateShader(vk_device_, ShaderNames::clusters_build_comp);
+
+	const vk::DescriptorSetLayoutBinding descriptor_set_layout_bindings[]
+	{
+		{
+			ShaderBindings::light_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+		{
+			ShaderBindings::cluster_offset_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+		{
+			ShaderBindings::lights_list_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+		{
+			ShaderBindings::counter_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+		{
+			ShaderBindings::tile_depth_bounds_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+	};
+
+	descriptor_set_layout_=
+		vk_device_.createDescriptorSetLayoutUnique(
+			vk::DescriptorSetLayoutCreateInfo(
+				vk::DescriptorSetLayoutCreateFlags(),
+				uint32_t(std::size(descriptor_set_layout_bindings)), descriptor_set_layout_bindings));
+
+	const vk::PushConstantRange push_constant_range(
+		vk::ShaderStageFlagBits::eCompute,
+		0u,
+		sizeof(Uniforms));
+
+	pipeline_layout_=
+		vk_device_.createPipelineLayoutUnique(
+			vk::PipelineLayoutCreateInfo(
+				vk::PipelineLayoutCreateFlags(),
+				1u, &*descriptor_set_layout_,
+				1u, &push_constant_range));
+
+	pipeline_=
+		vk_device_.createComputePipelineUnique(
+			nullptr,
+			vk::ComputePipelineCreateInfo(
+				vk::PipelineCreateFlags(),
+				vk::PipelineShaderStageCreateInfo(
+					vk::PipelineShaderStageCreateFlags(),
+					vk::ShaderStageFlagBits::eCompute,
+					*shader_,
+					"main"),
+				*pipeline_layout_));
+
+	// Create depth bounds pipeline.
+	depth_bounds_shader_= CreateShader(vk_device_, ShaderNames::clusters_depth_bounds_comp);
+
+	depth_bounds_sampler_=
+		vk_device_.createSamplerUnique(
+			vk::SamplerCreateInfo(
+				vk::SamplerCreateFlags(),
+				vk::Filter::eNearest,
+				vk::Filter::eNearest,
+				vk::SamplerMipmapMode::eNearest,
+				vk::SamplerAddressMode::eClampToEdge,
+				vk::SamplerAddressMode::eClampToEdge,
+				vk::SamplerAddressMode::eClampToEdge,
+				0.0f,
+				VK_FALSE,
+				0.0f,
+				VK_FALSE,
+				vk::CompareOp::eNever,
+				0.0f,
+				0.0f,
+				vk::BorderColor::eFloatTransparentBlack,
+				VK_FALSE));
+
+	const vk::DescriptorSetLayoutBinding depth_bounds_descriptor_set_layout_bindings[]
+	{
+		{
+			DepthBoundsShaderBindings::depth_image,
+			vk::DescriptorType::eCombinedImageSampler,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			&*depth_bounds_sampler_,
+		},
+		{
+			DepthBoundsShaderBindings::tile_depth_bounds_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+	};
+
+	depth_bounds_descriptor_set_layout_=
+		vk_device_.createDescriptorSetLayoutUnique(
+			vk::DescriptorSetLayoutCreateInfo(
+				vk::DescriptorSetLayoutCreateFlags(),
+				uint32_t(std::size(depth_bounds_descriptor_set_layout_bindings)), depth_bounds_descriptor_set_layout_bindings));
+
+	const vk::PushConstantRange depth_bounds_push_constant_range(
+		vk::ShaderStageFlagBits::eCompute,
+		0u,
+		sizeof(DepthBoundsUniforms));
+
+	depth_bounds_pipeline_layout_=
+		vk_device_.createPipelineLayoutUnique(
+			vk::PipelineLayoutCreateInfo(
+				vk::PipelineLayoutCreateFlags(),
+				1u, &*depth_bounds_descriptor_set_layout_,
+				1u, &depth_bounds_push_constant_range));
+
+	depth_bounds_pipeline_=
+		vk_device_.createComputePipelineUnique(
+			nullptr,
+			vk::ComputePipelineCreateInfo(
+				vk::PipelineCreateFlags(),
+				vk::PipelineShaderStageCreateInfo(
+					vk::PipelineShaderStageCreateFlags(),
+					vk::ShaderStageFlagBits::eCompute,
+					*depth_bounds_shader_,
+					"main"),
+				*depth_bounds_pipeline_layout_));
+
+	// Create descriptor sets.
+	const vk::DescriptorPoolSize descriptor_pool_sizes[]
+	{
+		{
+			vk::DescriptorType::eStorageBuffer,
+			uint32_t(std::size(descriptor_set_layout_bindings)) + 1u
+		},
+		{
+			vk::DescriptorType::eCombinedImageSampler,
+			1u
+		},
+	};
+
+	descriptor_pool_=
+		vk_device_.createDescriptorPoolUnique(
+			vk::DescriptorPoolCreateInfo(
+				vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+				2u, // max sets.
+				uint32_t(std::size(descriptor_pool_sizes)), descriptor_pool_sizes));
+
+	descriptor_set_=
+		std::move(
+		vk_device_.allocateDescriptorSetsUnique(
+			vk::DescriptorSetAllocateInfo(
+				*descriptor_pool_,
+				1u, &*descriptor_set_layout_)).front());
+
+	const vk::DescriptorBufferInfo descriptor_light_buffer_info(
+		light_buffer,
+		0u,
+		light_buffer_size);
+
+	const vk::DescriptorBufferInfo descriptor_offset_buffer_info(
+		cluster_offset_buffer_,
+		0u,
+		sizeof(ClusterVolumeBuilder::OffsetType) * cluster_count_);
+
+	const vk::DescriptorBufferInfo descriptor_lights_list_buffer_info(
+		lights_list_buffer_,
+		0u,
+		lights_list_size_);
+
+	const vk::DescriptorBufferInfo descriptor_counter_buffer_info(
+		*counter_buffer_.buffer,
+		0u,
+		sizeof(uint32_t));
+
+	const vk::DescriptorBufferInfo descriptor_tile_depth_bounds_buffer_info(
+		*tile_depth_bounds_buffer_.buffer,
+		0u,
+		GetTileDepthBoundsBufferSize());
+
+	vk_device_.updateDescriptorSets(
+		{
+			{
+				*descriptor_set_,
+				ShaderBindings::light_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_light_buffer_info,
+				nullptr
+			},
+			{
+				*descriptor_set_,
+				ShaderBindings::cluster_offset_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_offset_buffer_info,
+				nullptr
+			},
+			{
+				*descriptor_set_,
+				ShaderBindings::lights_list_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_lights_list_buffer_info,
+				nullptr
+			},
+			{
+				*descriptor_set_,
+				ShaderBindings::counter_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_counter_buffer_info,
+				nullptr
+			},
+			{
+				*descriptor_set_,
+				ShaderBindings::tile_depth_bounds_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_tile_depth_bounds_buffer_info,
+				nullptr
+			},
+		},
+		{});
+
+	depth_bounds_descriptor_set_=
+		std::move(
+		vk_device_.allocateDescriptorSetsUnique(
+			vk::DescriptorSetAllocateInfo(
+				*descriptor_pool_,
+				1u, &*depth_bounds_descriptor_set_layout_)).front());
+
+	const vk::DescriptorImageInfo descriptor_depth_image_info(
+		vk::Sampler(),
+		depth_image_view,
+		vk::ImageLayout::eShaderReadOnlyOptimal);
+
+	vk_device_.updateDescriptorSets(
+		{
+			{
+				*depth_bounds_descriptor_set_,
+				DepthBoundsShaderBindings::depth_image,
+				0u,
+				1u,
+				vk::DescriptorType::eCombinedImageSampler,
+				&descriptor_depth_image_info,
+				nullptr,
+				nullptr
+			},
+			{
+				*depth_bounds_descriptor_set_,
+				DepthBoundsShaderBindings::tile_depth_bounds_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_tile_depth_bounds_buffer_info,
+				nullptr
+			},
+		},
+		{});
+}
+
+ClusterVolumeBuilderGPU::~ClusterVolumeBuilderGPU()
+{
+	// Sync before destruction.
+	vk_device_.waitIdle();
+}
+
+void ClusterVolumeBuilderGPU::Build(
+	const vk::CommandBuffer command_buffer,
+	const m_Mat4& mat,
+	const uint32_t light_count,
+	const bool refinement_enabled)
+{
+	Uniforms uniforms{};
+	uniforms.view_matrix= mat;
+	// Same as in CPU builder.
+	uniforms.projection_scale[0]= m_Vec3(mat.value[0], mat.value[4], mat.value[ 8]).GetLength();
+	uniforms.projection_scale[1]= m_Vec3(mat.value[1], mat.value[5], mat.value[ 9]).GetLength();
+	uniforms.light_count= light_count;
+	uniforms.refinement_enabled= refinement_enabled ? 1u : 0u;
+	uniforms.tiled_mode= 0u;
+
+	DoBuildPass(command_buffer, uniforms);
+}
+
+void ClusterVolumeBuilderGPU::BuildTiled(
+	const vk::CommandBuffer command_buffer,
+	const CameraController::ViewMatrix& view_matrix,
+	const uint32_t light_count)
+{
+	// Wait for depth pre-pass and for previous frame reading of depth bounds.
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eFragmentShader,
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::DependencyFlags(),
+		{ { vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eShaderRead } },
+		{},
+		{});
+
+	DepthBoundsUniforms depth_bounds_uniforms;
+	depth_bounds_uniforms.matrix_values[0]= view_matrix.m0;
+	depth_bounds_uniforms.matrix_values[1]= view_matrix.m5;
+	depth_bounds_uniforms.matrix_values[2]= view_matrix.m10;
+	depth_bounds_uniforms.matrix_values[3]= view_matrix.m14;
+	depth_bounds_uniforms.tiles_count[0]= int32_t(c_tiles_volume_size[0]);
+	depth_bounds_uniforms.tiles_count[1]= int32_t(c_tiles_volume_size[1]);
+	depth_bounds_uniforms.tiles_count[2]= 0;
+	depth_bounds_uniforms.tiles_count[3]= 0;
+
+	command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, *depth_bounds_pipeline_);
+
+	command_buffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eCompute,
+		*depth_bounds_pipeline_layout_,
+		0u,
+		1u, &*depth_bounds_descriptor_set_,
+		0u, nullptr);
+
+	command_buffer.pushConstants(
+		*depth_bounds_pipeline_layout_,
+		vk::ShaderStageFlagBits::eCompute,
+		0u,
+		sizeof(depth_bounds_uniforms),
+		&depth_bounds_uniforms);
+
+	// One workgroup per tile.
+	command_buffer.dispatch(c_tiles_volume_size[0], c_tiles_volume_size[1], 1u);
+
+	Uniforms uniforms{};
+	uniforms.view_matrix= view_matrix.mat;
+	uniforms.projection_scale[0]= m_Vec3(view_matrix.mat.value[0], view_matrix.mat.value[4], view_matrix.mat.value[ 8]).GetLength();
+	uniforms.projection_scale[1]= m_Vec3(view_matrix.mat.value[1], view_matrix.mat.value[5], view_matrix.mat.value[ 9]).GetLength();
+	uniforms.light_count= light_count;
+	uniforms.refinement_enabled= 1u;
+	uniforms.tiled_mode= 1u;
+
+	// Barrier for depth bounds buffer is added together with barrier for clearing.
+	DoBuildPass(command_buffer, uniforms);
+}
+
+vk::Buffer ClusterVolumeBuilderGPU::GetTileDepthBoundsBuffer() const
+{
+	return *tile_depth_bounds_buffer_.buffer;
+}
+
+size_t ClusterVolumeBuilderGPU::GetTileDepthBoundsBufferSize() const
+{
+	return sizeof(float) * 2u * c_tiles_volume_size[0] * c_tiles_volume_size[1];
+}
+
+void ClusterVolumeBuilderGPU::ReadBackResults(const vk::CommandBuffer command_buffer)
+{
+	command_buffer.copyBuffer(
+		cluster_offset_buffer_,
+		*cluster_offset_read_back_buffer_.buffer,
+		{ vk::BufferCopy(0u, 0u, sizeof(ClusterVolumeBuilder::OffsetType) * cluster_count_) });
+
+	command_buffer.copyBuffer(
+		lights_list_buffer_,
+		*lights_list_read_back_buffer_.buffer,
+		{ vk::BufferCopy(0u, 0u, lights_list_size_) });
+
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eHost,
+		vk::DependencyFlags(),
+		{ { vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead } },
+		{},
+		{});
+}
+
+void ClusterVolumeBuilderGPU::DoBuildPass(const vk::CommandBuffer command_buffer, const Uniforms& uniforms)
+{
+	// Wait for previous frame reading of lists.
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eFragmentShader,
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlags(),
+		{},
+		{},
+		{});
+
+	// Clear allocation counter and lists. Shader writes lists bytes, using atomic "or", so, lists must be zeroed.
+	command_buffer.fillBuffer(*counter_buffer_.buffer, 0u, VK_WHOLE_SIZE, 0u);
+	command_buffer.fillBuffer(lights_list_buffer_, 0u, VK_WHOLE_SIZE, 0u);
+
+	// Wait for clearing, for light buffer update and for previous compute passes.
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::DependencyFlags(),
+		{ { vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite } },
+		{},
+		{});
+
+	command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline_);
+
+	command_buffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eCompute,
+		*pipeline_layout_,
+		0u,
+		1u, &*descriptor_set_,
+		0u, nullptr);
+
+	command_buffer.pushConstants(
+		*pipeline_layout_,
+		vk::ShaderStageFlagBits::eCompute,
+		0u,
+		sizeof(uniforms),
+		&uniforms);
+
+	command_buffer.dispatch((cluster_count_ + c_workgroup_size - 1u) / c_workgroup_size, 1u, 1u);
+
+	// Wait for result before lighting pass.
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlags(),
+		{ { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead } },
+		{},
+		{});
+}
+
+size_t ClusterVolumeBuilderGPU::CompareResults(const ClusterVolumeBuilder& cpu_builder)
+{
+	void* offsets_mapped= nullptr;
+	void* lights_list_mapped= nullptr;
+	vk_device_.mapMemory(*cluster_offset_read_back_buffer_.memory, 0u, VK_WHOLE_SIZE, vk::MemoryMapFlags(), &offsets_mapped);
+	vk_device_.mapMemory(*lights_list_read_back_buffer_.memory, 0u, VK_WHOLE_SIZE, vk::MemoryMapFlags(), &lights_list_mapped);
+
+	const auto gpu_offsets= static_cast<const ClusterVolumeBuilder::OffsetType*>(offsets_mapped);
+	const auto gpu_lights_list= static_cast<const uint8_t*>(lights_list_mapped);
+	const std::vector<ClusterVolumeBuilder::OffsetType>& cpu_offsets= cpu_builder.GetOffsets();
+	const auto cpu_lights_list= static_cast<const uint8_t*>(cpu_builder.GetElementsList());
+
+	const size_t element_size= cpu_builder.GetElementSize();
+	const size_t lights_list_elements= lights_list_size_ / element_size;
+
+	size_t different_clusters= 0u;
+	for(size_t i= 0u; i < cluster_count_; ++i)
+	{
+		const size_t gpu_offset= gpu_offsets[i];
+		const size_t cpu_offset= cpu_offsets[i];
+		if(gpu_offset >= lights_list_elements)
+		{
+			++different_clusters;
+			continue;
+		}
+
+		const size_t gpu_count= GetListElement(gpu_lights_list, list_format_, gpu_offset);
+		const size_t cpu_count= GetListElement(cpu_lights_list, list_format_, cpu_offset);
+		if(gpu_count != cpu_count ||
+			gpu_offset + 1u + gpu_count > lights_list_elements ||
+			std::memcmp(
+				gpu_lights_list + (gpu_offset + 1u) * element_size,
+				cpu_lights_list + (cpu_offset + 1u) * element_size,
+				cpu_count * element_size) != 0)
+			++different_clusters;
+	}
+
+	vk_device_.unmapMemory(*cluster_offset_read_back_buffer_.memory);
+	vk_device_.unmapMemory(*lights_list_read_back_buffer_.memory);
+
+	return different_clusters;
+}
+
+ClusterVolumeBuilderGPU::Buffer ClusterVolumeBuilderGPU::CreateBuffer(
+	const size_t size,
+	const vk::BufferUsageFlags usage,
+	const vk::MemoryPropertyFlags memory_flags)
+{
+	Buffer result;
+	result.buffer=
+		vk_device_.createBufferUnique(
+			vk::BufferCreateInfo(
+				vk::BufferCreateFlags(),
+				size,
+				usage));
+
+	const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*result.buffer);
+
+	vk::MemoryAllocateInfo vk_memory_allocate_info(buffer_memory_requirements.size);
+	for(uint32_t i= 0u; i < memory_properties_.memoryTypeCount; ++i)
+	{
+		if((buffer_memory_requirements.memoryTypeBits & (1u << i)) != 0 &&
+			(memory_properties_.memoryTypes[i].propertyFlags & memory_flags) == memory_flags)
+			vk_memory_allocate_info.memoryTypeIndex= i;
+	}
+
+	result.memory= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
+	vk_device_.bindBufferMemory(*result.buffer, *result.memory, 0u);
+
+	return result;
+}
+
+} // namespace KK
@@ -0,0 +1,106 @@
+#pragma once
+#include "CameraController.hpp"
+#include "ClusterVolumeBuilder.hpp"
+#include "WindowVulkan.hpp"
+
+
+namespace KK
+{
+
+// Builds clusters volume on GPU, using compute shader.
+// Input is light buffer, output - offsets and lights list buffers, in same format, as in CPU builder.
+// Lists of each cluster are same as lists of CPU builder, but order of lists in lights list buffer is different.
+// Also tiled mode is supported, where screen tiles are splitted into slices between min and max depth of tile, taken from depth buffer.
+class ClusterVolumeBuilderGPU final
+{
+public:
+	// Size of clusters volume in tiled mode. Contains same number of clusters, as regular volume.
+	static constexpr uint32_t c_tiles_volume_size[3]{ 32u, 24u, 4u };
+
+public:
+	ClusterVolumeBuilderGPU(
+		WindowVulkan& window_vulkan,
+		const ClusterVolumeBuilder& cpu_builder, // Used for sizes.
+		vk::ImageView depth_image_view, // Used in tiled mode.
+		vk::Buffer light_buffer,
+		size_t light_buffer_size,
+		vk::Buffer cluster_offset_buffer,
+		vk::Buffer lights_list_buffer);
+
+	~ClusterVolumeBuilderGPU();
+
+	// Light buffer must be already updated and must contain lists format, same as format of CPU builder.
+	// Result buffers are ready for fragment shaders reading after this call.
+	void Build(vk::CommandBuffer command_buffer, const m_Mat4& mat, uint32_t light_count, bool refinement_enabled);
+
+	// Build in tiled mode. Call it after depth pre-pass.
+	// Light buffer must contain tiled volume size.
+	void BuildTiled(vk::CommandBuffer command_buffer, const CameraController::ViewMatrix& view_matrix, uint32_t light_count);
+
+	// Min and max W for each tile, written in tiled mode.
+	vk::Buffer GetTileDepthBoundsBuffer() const;
+	size_t GetTileDepthBoundsBufferSize() const;
+
+	// Copy result buffers into host-visible memory. Call after "Build".
+	void ReadBackResults(vk::CommandBuffer command_buffer);
+
+	// Compare results, copied via "ReadBackResults", with results of CPU builder. GPU must be idle before this call.
+	// Returns number of clusters with different lists.
+	size_t CompareResults(const ClusterVolumeBuilder& cpu_builder);
+
+private:
+	struct Buffer
+	{
+		vk::UniqueBuffer buffer;
+		vk::UniqueDeviceMemory memory;
+	};
+
+	struct Uniforms
+	{
+		m_Mat4 view_matrix;
+		float projection_scale[2];
+		uint32_t light_count;
+		uint32_t refinement_enabled;
+		uint32_t tiled_mode;
+		uint32_t padding[3];
+	};
+
+private:
+	Buffer CreateBuffer(size_t size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memory_flags);
+	void DoBuildPass(vk::CommandBuffer command_buffer, const Uniforms& uniforms);
+
+private:
+	const vk::Device vk_device_;
+	const vk::PhysicalDeviceMemoryProperties memory_properties_;
+	const uint32_t cluster_count_;
+	const ClusterVolumeBuilder::ListFormat list_format_;
+	const size_t lights_list_size_; // In bytes.
+	const vk::Buffer cluster_offset_buffer_;
+	const vk::Buffer lights_list_buffer_;
+
+	// Counter for allocation of lights lists.
+	Buffer counter_buffer_;
+
+	Buffer tile_depth_bounds_buffer_;
+
+	// Host-visible copies of result buffers.
+	Buffer cluster_offset_read_back_buffer_;
+	Buffer lights_list_read_back_buffer_;
+
+	vk::UniqueShaderModule shader_;
+	vk::UniqueDescriptorSetLayout descriptor_set_layout_;
+	vk::UniquePipelineLayout pipeline_layout_;
+	vk::UniquePipeline pipeline_;
+
+	vk::UniqueShaderModule depth_bounds_shader_;
+	vk::UniqueSampler depth_bounds_sampler_;
+	vk::UniqueDescriptorSetLayout depth_bounds_descriptor_set_layout_;
+	vk::UniquePipelineLayout depth_bounds_pipeline_layout_;
+	vk::UniquePipeline depth_bounds_pipeline_;
+
+	vk::UniqueDescriptorPool descriptor_pool_;
+	vk::UniqueDescriptorSet descriptor_set_;
+	vk::UniqueDescriptorSet depth_bounds_descriptor_set_;
+};
+
+} // namespace KK
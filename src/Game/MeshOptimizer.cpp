@@ -0,0 +1,283 @@
+#include "MeshOptimizer.hpp"
+#include "Assert.hpp"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+
+namespace KK
+{
+
+namespace
+{
+
+// Parameters of scoring function, as in original article.
+const size_t c_cache_size= 32u;
+const float c_cache_decay_power= 1.5f;
+const float c_last_triangle_score= 0.75f;
+const float c_valence_boost_scale= 2.0f;
+const float c_valence_boost_power= 0.5f;
+
+float CalculateVertexScore(const int32_t cache_position, const uint32_t remaining_triangles)
+{
+	if(remaining_triangles == 0u)
+		return -1.0f; // No triangles left - vertex is useless.
+
+	float score= 0.0f;
+	if(cache_position >= 0)
+	{
+		// Vertices of last triangle have fixed score, in order to prevent using them again immediately.
+		if(cache_position < 3)
+			score= c_last_triangle_score;
+		else
+			score= std::pow(1.0f - float(cache_position - 3) / float(c_cache_size - 3u), c_cache_decay_power);
+	}
+
+	// Prefer vertices with few remaining triangles, in order to get rid of lone triangles.
+	score+= c_valence_boost_scale * std::pow(float(remaining_triangles), -c_valence_boost_power);
+	return score;
+}
+
+// Cell of vertex clustering grid and attributes id of vertex.
+using CellAttributesKey= std::pair<uint64_t, uint32_t>;
+
+struct CellAttributesKeyHasher
+{
+	size_t operator()(const CellAttributesKey& k) const
+	{
+		return std::hash<uint64_t>()(k.first * 31u + k.second);
+	}
+};
+
+} // namespace
+
+void OptimizeTrianglesOrder(uint32_t* const indices, const size_t index_count, const size_t vertex_count)
+{
+	const size_t triangle_count= index_count / 3u;
+	if(triangle_count == 0u)
+		return;
+
+	// Build lists of remaining triangles for each vertex.
+	std::vector<uint32_t> vertex_triangles_offset(vertex_count + 1u, 0u);
+	for(size_t i= 0u; i < triangle_count * 3u; ++i)
+	{
+		KK_ASSERT(indices[i] < vertex_count);
+		++vertex_triangles_offset[indices[i] + 1u];
+	}
+	for(size_t v= 0u; v < vertex_count; ++v)
+		vertex_triangles_offset[v + 1u]+= vertex_triangles_offset[v];
+
+	std::vector<uint32_t> vertex_triangles(triangle_count * 3u);
+	std::vector<uint32_t> vertex_remaining_triangles(vertex_count, 0u);
+	for(size_t t= 0u; t < triangle_count; ++t)
+	for(size_t j= 0u; j < 3u; ++j)
+	{
+		const uint32_t v= indices[t * 3u + j];
+		vertex_triangles[vertex_triangles_offset[v] + vertex_remaining_triangles[v]]= uint32_t(t);
+		++vertex_remaining_triangles[v];
+	}
+
+	std::vector<int32_t> vertex_cache_position(vertex_count, -1);
+	std::vector<float> vertex_score(vertex_count);
+	for(size_t v= 0u; v < vertex_count; ++v)
+		vertex_score[v]= CalculateVertexScore(-1, vertex_remaining_triangles[v]);
+
+	std::vector<bool> triangle_added(triangle_count, false);
+
+	std::vector<uint32_t> result;
+	result.reserve(triangle_count * 3u);
+
+	std::vector<uint32_t> cache, new_cache;
+	cache.reserve(c_cache_size + 3u);
+	new_cache.reserve(c_cache_size + 3u);
+
+	const size_t c_no_triangle= triangle_count;
+	size_t best_triangle= c_no_triangle;
+	size_t next_not_added_triangle= 0u;
+	for(size_t added_triangles= 0u; added_triangles < triangle_count; ++added_triangles)
+	{
+		if(best_triangle == c_no_triangle)
+		{
+			// No candidates, touching cache. Take next triangle in source order.
+			while(triangle_added[next_not_added_triangle])
+				++next_not_added_triangle;
+			best_triangle= next_not_added_triangle;
+		}
+
+		triangle_added[best_triangle]= true;
+		const uint32_t* const triangle= indices + best_triangle * 3u;
+		result.insert(result.end(), triangle, triangle + 3u);
+
+		// Remove triangle from lists of its vertices.
+		for(size_t j= 0u; j < 3u; ++j)
+		{
+			const uint32_t v= triangle[j];
+			uint32_t* const triangles_begin= vertex_triangles.data() + vertex_triangles_offset[v];
+			uint32_t* const triangles_end= triangles_begin + vertex_remaining_triangles[v];
+			uint32_t* const it= std::find(triangles_begin, triangles_end, uint32_t(best_triangle));
+			KK_ASSERT(it != triangles_end);
+			*it= *(triangles_end - 1);
+			--vertex_remaining_triangles[v];
+		}
+
+		// Put vertices of triangle at the beginning of cache.
+		new_cache.clear();
+		for(size_t j= 0u; j < 3u; ++j)
+		{
+			if(std::find(new_cache.begin(), new_cache.end(), triangle[j]) == new_cache.end())
+				new_cache.push_back(triangle[j]);
+		}
+		for(const uint32_t v : cache)
+		{
+			if(v != triangle[0] && v != triangle[1] && v != triangle[2])
+				new_cache.push_back(v);
+		}
+
+		// Update scores of vertices in cache (and vertices, pushed out of cache).
+		for(size_t i= 0u; i < new_cache.size(); ++i)
+		{
+			const uint32_t v= new_cache[i];
+			vertex_cache_position[v]= i < c_cache_size ? int32_t(i) : -1;
+			vertex_score[v]= CalculateVertexScore(vertex_cache_position[v], vertex_remaining_triangles[v]);
+		}
+
+		// Select best triangle among triangles, touching cache.
+		best_triangle= c_no_triangle;
+		float best_triangle_score= -1.0f;
+		for(const uint32_t v : new_cache)
+		{
+			const uint32_t* const triangles_begin= vertex_triangles.data() + vertex_triangles_offset[v];
+			const uint32_t* const triangles_end= triangles_begin + vertex_remaining_triangles[v];
+			for(const uint32_t* it= triangles_begin; it != triangles_end; ++it)
+			{
+				const uint32_t* const candidate= indices + size_t(*it) * 3u;
+				const float score= vertex_score[candidate[0]] + vertex_score[candidate[1]] + vertex_score[candidate[2]];
+				if(score > best_triangle_score)
+				{
+					best_triangle_score= score;
+					best_triangle= *it;
+				}
+			}
+		}
+
+		if(new_cache.size() > c_cache_size)
+			new_cache.resize(c_cache_size);
+		cache.swap(new_cache);
+	}
+
+	std::copy(result.begin(), result.end(), indices);
+}
+
+std::vector<uint32_t> OptimizeVerticesOrder(uint32_t* const indices, const size_t index_count, const size_t vertex_count)
+{
+	const uint32_t c_unused_vertex= ~0u;
+	std::vector<uint32_t> remap(vertex_count, c_unused_vertex);
+
+	uint32_t next_vertex= 0u;
+	for(size_t i= 0u; i < index_count; ++i)
+	{
+		uint32_t& new_index= remap[indices[i]];
+		if(new_index == c_unused_vertex)
+		{
+			new_index= next_vertex;
+			++next_vertex;
+		}
+		indices[i]= new_index;
+	}
+
+	for(uint32_t& new_index : remap)
+	{
+		if(new_index == c_unused_vertex)
+		{
+			new_index= next_vertex;
+			++next_vertex;
+		}
+	}
+
+	return remap;
+}
+
+std::vector<uint32_t> SimplifyMeshVertexClustering(
+	const uint32_t* const indices,
+	const size_t index_count,
+	const m_Vec3* const vertices_pos,
+	const uint32_t* const vertices_attributes_ids,
+	const size_t vertex_count,
+	const float cell_size)
+{
+	// Pack cell coordinates into 21 bit each.
+	const int32_t c_coord_offset= 1 << 20;
+	const auto get_cell_key=
+	[&](const m_Vec3& pos) -> uint64_t
+	{
+		const float inv_cell_size= 1.0f / cell_size;
+		const uint64_t x= uint64_t(std::clamp(int32_t(std::floor(pos.x * inv_cell_size)) + c_coord_offset, 0, 2 * c_coord_offset - 1));
+		const uint64_t y= uint64_t(std::clamp(int32_t(std::floor(pos.y * inv_cell_size)) + c_coord_offset, 0, 2 * c_coord_offset - 1));
+		const uint64_t z= uint64_t(std::clamp(int32_t(std::floor(pos.z * inv_cell_size)) + c_coord_offset, 0, 2 * c_coord_offset - 1));
+		return x | (y << 21u) | (z << 42u);
+	};
+
+	// First vertex of cell defines position of cell.
+	std::unordered_map<uint64_t, uint32_t> cells_vertices;
+	std::vector<uint64_t> vertices_cells(vertex_count);
+	for(size_t v= 0u; v < vertex_count; ++v)
+	{
+		vertices_cells[v]= get_cell_key(vertices_pos[v]);
+		cells_vertices.emplace(vertices_cells[v], uint32_t(v));
+	}
+
+	// Select one vertex for each attributes id in cell. Prefer vertex at position of cell,
+	// so, all split vertices of cell are moved to same position.
+	std::unordered_map<CellAttributesKey, uint32_t, CellAttributesKeyHasher> cells_attributes_vertices;
+	for(size_t v= 0u; v < vertex_count; ++v)
+	{
+		const auto insert_result= cells_attributes_vertices.emplace(CellAttributesKey(vertices_cells[v], vertices_attributes_ids[v]), uint32_t(v));
+		uint32_t& cell_vertex= insert_result.first->second;
+
+		const m_Vec3& cell_pos= vertices_pos[cells_vertices[vertices_cells[v]]];
+		if(vertices_pos[cell_vertex] != cell_pos && vertices_pos[v] == cell_pos)
+			cell_vertex= uint32_t(v);
+	}
+
+	std::vector<uint32_t> remap(vertex_count);
+	for(size_t v= 0u; v < vertex_count; ++v)
+		remap[v]= cells_attributes_vertices[CellAttributesKey(vertices_cells[v], vertices_attributes_ids[v])];
+
+	std::vector<uint32_t> result;
+	for(size_t i= 0u; i + 3u <= index_count; i+= 3u)
+	{
+		const uint32_t v0= remap[indices[i + 0u]];
+		const uint32_t v1= remap[indices[i + 1u]];
+		const uint32_t v2= remap[indices[i + 2u]];
+		if(v0 == v1 || v1 == v2 || v2 == v0)
+			continue;
+
+		result.push_back(v0);
+		result.push_back(v1);
+		result.push_back(v2);
+	}
+
+	return result;
+}
+
+size_t CountVertexCacheMisses(const uint32_t* const indices, const size_t index_count, const size_t vertex_count, const size_t cache_size)
+{
+	// Vertex is in FIFO cache, if less than "cache_size" misses happened since it was loaded.
+	std::vector<size_t> vertex_load_time(vertex_count, 0u);
+	size_t time= cache_size + 1u;
+	size_t misses= 0u;
+	for(size_t i= 0u; i < index_count; ++i)
+	{
+		size_t& load_time= vertex_load_time[indices[i]];
+		if(time - load_time > cache_size)
+		{
+			load_time= time;
+			++time;
+			++misses;
+		}
+	}
+
+	return misses;
+}
+
+} // namespace KK
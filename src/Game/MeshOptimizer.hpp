@@ -0,0 +1,37 @@
+#pragma once
+#include "../MathLib/Vec.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace KK
+{
+
+// Offline optimization of indexed triangle lists for GPU vertex processing.
+// All functions work with 32-bit indices in range [0; vertex_count).
+
+// Reorder triangles for better post-transform vertex cache usage.
+// Greedy algorithm by Tom Forsyth ("Linear-Speed Vertex Cache Optimisation").
+void OptimizeTrianglesOrder(uint32_t* indices, size_t index_count, size_t vertex_count);
+
+// Renumber vertices in order of first usage for better vertex fetch locality. Indices are rewritten.
+// Returns table of new positions of vertices (old index -> new index). Unused vertices are placed at the end.
+std::vector<uint32_t> OptimizeVerticesOrder(uint32_t* indices, size_t index_count, size_t vertex_count);
+
+// Simplify mesh via vertex clustering. Vertices in same cell of grid with same attributes id are replaced with one vertex of them.
+// Vertices with different attributes (split vertices of hard edges and texture seams) are not merged, but they are replaced with vertices
+// at same position, if possible, in order to avoid cracks.
+// Result indices refer to source vertices, degenerate triangles are removed.
+std::vector<uint32_t> SimplifyMeshVertexClustering(
+	const uint32_t* indices,
+	size_t index_count,
+	const m_Vec3* vertices_pos,
+	const uint32_t* vertices_attributes_ids,
+	size_t vertex_count,
+	float cell_size);
+
+// Simulate FIFO vertex cache of given size. Average cache miss ratio (ACMR) is misses count divided by triangles count.
+size_t CountVertexCacheMisses(const uint32_t* indices, size_t index_count, size_t vertex_count, size_t cache_size);
+
+} // namespace KK
@@ -41,15 +41,22 @@ ShadowmapSlot ShadowmapAllocator::GetLightShadowmapSlot(const ShadowmapLight& li
 	return it->second.shadowmap_slot;
 }
 
+bool ShadowmapAllocator::SlotsChanged() const
+{
+	return slots_changed_;
+}
+
 ShadowmapAllocator::LightsForShadowUpdate ShadowmapAllocator::UpdateLights(
 	const std::vector<ShadowmapLight>& lights,
 	const m_Vec3& cam_pos)
 {
-	++frame_number_;
+	const uint32_t last_detail_level= uint32_t(shadowmap_size_.size() - 1u);
 
 	// Copy lights to new container, calculate detail level.
 	lights_extra_.clear();
 	lights_extra_.reserve(lights.size());
+	detail_levels_.clear();
+	detail_levels_.reserve(lights.size());
 	for(const ShadowmapLight& in_light : lights)
 	{
 		LightExtra out_light;
@@ -60,9 +67,22 @@ ShadowmapAllocator::LightsForShadowUpdate ShadowmapAllocator::UpdateLights(
 		const float dist_k= 3.0f;
 		out_light.detail_level= std::log2(std::max(dist_k * dist / in_light.radius, 1.0f));
 
+		detail_levels_.push_back(std::min(uint32_t(out_light.detail_level), last_detail_level));
 		lights_extra_.push_back(std::move(out_light));
 	}
 
+	// Keep slots of previous update, without frame number increment, so, all lights are still marked as used.
+	if(lights == prev_lights_ && detail_levels_ == prev_detail_levels_)
+	{
+		slots_changed_= false;
+		return LightsForShadowUpdate();
+	}
+	prev_lights_= lights;
+	prev_detail_levels_.swap(detail_levels_);
+
+	++frame_number_;
+	slots_changed_= false;
+
 	// Sort by detail level.
 	std::sort(
 		lights_extra_.begin(),
@@ -76,7 +96,6 @@ ShadowmapAllocator::LightsForShadowUpdate ShadowmapAllocator::UpdateLights(
 	std::vector<size_t> detail_levels_left(shadowmap_size_.size());
 	for(size_t& s : detail_levels_left)
 		s= shadowmap_size_[ &s - detail_levels_left.data() ].count;
-	const uint32_t last_detail_level= uint32_t(detail_levels_left.size() - 1u);
 
 	// Assign detail levels.
 	for(LightExtra& light : lights_extra_)
@@ -110,6 +129,7 @@ ShadowmapAllocator::LightsForShadowUpdate ShadowmapAllocator::UpdateLights(
 		{
 			FreeSloot(light_data.shadowmap_slot);
 			light_data.shadowmap_slot= c_invalid_shadowmap_slot;
+			slots_changed_= true;
 		}
 	}
 
@@ -154,6 +174,7 @@ ShadowmapSlot ShadowmapAllocator::AllocateSlot(const uint32_t detail_level)
 		result.first= detail_level;
 		result.second= free_slots_[detail_level].back();
 		free_slots_[detail_level].pop_back();
+		slots_changed_= true;
 		return result;
 	}
 
@@ -178,6 +199,7 @@ ShadowmapSlot ShadowmapAllocator::AllocateSlot(const uint32_t detail_level)
 		// Remove lights from cache, only if there is no slots for new lights.
 		const ShadowmapSlot result= src_light->second.shadowmap_slot;
 		lights_set_.erase(src_light->first);
+		slots_changed_= true;
 		return result;
 	}
 
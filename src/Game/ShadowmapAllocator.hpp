@@ -33,6 +33,9 @@ public:
 
 	ShadowmapSlot GetLightShadowmapSlot(const ShadowmapLight& light) const;
 
+	// Returns true if slots of some lights were allocated, freed or reused by last "UpdateLights" call.
+	bool SlotsChanged() const;
+
 private:
 	struct LightExtra
 	{
@@ -62,11 +65,17 @@ private:
 private:
 	const ShadowmapSize shadowmap_size_;
 	uint32_t frame_number_= 1u;
+	bool slots_changed_= true;
 	LightsSet lights_set_;
 	std::vector< std::vector<uint32_t> > free_slots_;
 
 	// Cache lights container.
 	std::vector<LightExtra> lights_extra_;
+
+	// Input of previous update. If lights and their detail levels are not changed, update is skipped.
+	std::vector<ShadowmapLight> prev_lights_;
+	std::vector<uint32_t> prev_detail_levels_;
+	std::vector<uint32_t> detail_levels_;
 };
 
 } // namespace KK
@@ -20,8 +20,12 @@ struct Uniforms
 {
 	m_Vec3 light_pos;
 	float inv_light_radius;
+	float vertex_pos_step;
+	uint32_t vertex_pos_first_box;
 };
 
+const vk::ShaderStageFlags c_uniforms_stages= vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eGeometry;
+
 } // namespace
 
 Shadowmapper::Shadowmapper(
@@ -29,7 +33,8 @@ Shadowmapper::Shadowmapper(
 	GPUDataUploader& gpu_data_uploader,
 	const size_t vertex_size,
 	const size_t vertex_pos_offset,
-	const vk::Format vertex_pos_format)
+	const vk::Format vertex_pos_format,
+	const size_t instance_size)
 	: vk_device_(window_vulkan.GetVulkanDevice())
 {
 	const uint32_t base_cubemap_size= 1024u; // Most detailed cubemap size
@@ -95,7 +100,7 @@ Shadowmapper::Shadowmapper(
 	}
 
 	// Create shaders
-	shader_vert_= CreateShader(vk_device_, ShaderNames::cubemap_shadow_vert);
+	shader_vert_= CreateShader(vk_device_, instance_size > 0u ? ShaderNames::cubemap_shadow_instanced_vert : ShaderNames::cubemap_shadow_vert);
 	shader_geom_= CreateShader(vk_device_, ShaderNames::cubemap_shadow_geom);
 	shader_frag_= CreateShader(vk_device_, ShaderNames::cubemap_shadow_frag);
 
@@ -110,6 +115,13 @@ Shadowmapper::Shadowmapper(
 				vk::ShaderStageFlagBits::eGeometry,
 				nullptr,
 			},
+			{
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				1u,
+				vk::ShaderStageFlagBits::eVertex,
+				nullptr,
+			},
 		};
 
 		descriptor_set_layout_=
@@ -119,7 +131,7 @@ Shadowmapper::Shadowmapper(
 					uint32_t(std::size(descriptor_set_layout_bindings)), descriptor_set_layout_bindings));
 
 		const vk::PushConstantRange push_constant_range(
-			vk::ShaderStageFlagBits::eGeometry,
+			c_uniforms_stages,
 			0u,
 			sizeof(Uniforms));
 
@@ -152,16 +164,25 @@ Shadowmapper::Shadowmapper(
 			},
 		};
 
-		const vk::VertexInputBindingDescription vertex_input_binding_description(
-			0u, uint32_t(vertex_size), vk::VertexInputRate::eVertex);
+		// Instance bindings and attributes are used only for instanced drawing.
+		const vk::VertexInputBindingDescription vertex_input_binding_description[]
+		{
+			{ 0u, uint32_t(vertex_size), vk::VertexInputRate::eVertex },
+			{ 1u, uint32_t(instance_size), vk::VertexInputRate::eInstance },
+		};
 
 		const vk::VertexInputAttributeDescription vertex_input_attribute_description[]
-		{ {0u, 0u, vertex_pos_format, uint32_t(vertex_pos_offset)}, };
+		{
+			{0u, 0u, vertex_pos_format, uint32_t(vertex_pos_offset)},
+			{1u, 1u, vk::Format::eR32G32B32A32Sfloat, 0u},
+			{2u, 1u, vk::Format::eR32G32B32A32Sfloat, 16u},
+			{3u, 1u, vk::Format::eR32G32B32A32Sfloat, 32u},
+		};
 
 		const vk::PipelineVertexInputStateCreateInfo pipiline_vertex_input_state_create_info(
 			vk::PipelineVertexInputStateCreateFlags(),
-			1u, &vertex_input_binding_description,
-			uint32_t(std::size(vertex_input_attribute_description)), vertex_input_attribute_description);
+			instance_size > 0u ? 2u : 1u, vertex_input_binding_description,
+			instance_size > 0u ? 4u : 1u, vertex_input_attribute_description);
 
 		const vk::PipelineInputAssemblyStateCreateInfo pipeline_input_assembly_state_create_info(
 			vk::PipelineInputAssemblyStateCreateFlags(),
@@ -236,7 +257,7 @@ Shadowmapper::Shadowmapper(
 	}
 
 	// Create descriptor set pool.
-	const vk::DescriptorPoolSize descriptor_pool_size(vk::DescriptorType::eStorageBuffer, 1u);
+	const vk::DescriptorPoolSize descriptor_pool_size(vk::DescriptorType::eStorageBuffer, 2u);
 	descriptor_set_pool_=
 		vk_device_.createDescriptorPoolUnique(
 			vk::DescriptorPoolCreateInfo(
@@ -462,11 +483,33 @@ std::vector<vk::ImageView> Shadowmapper::GetDepthCubemapArrayImagesView() const
 	return result;
 }
 
+void Shadowmapper::SetVertexPosBoxesBuffer(const vk::Buffer buffer, const vk::DeviceSize size)
+{
+	const vk::DescriptorBufferInfo descriptor_buffer_info(buffer, 0u, size);
+
+	vk_device_.updateDescriptorSets(
+		{
+			{
+				*descriptor_set_,
+				1u,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_buffer_info,
+				nullptr
+			}
+		},
+		{});
+}
+
 void Shadowmapper::DrawToDepthCubemap(
 	const vk::CommandBuffer command_buffer,
 	const ShadowmapSlot slot,
 	const m_Vec3& light_pos,
 	const float light_radius,
+	const float vertex_pos_step,
+	const uint32_t vertex_pos_first_box,
 	const std::function<void()>& draw_function)
 {
 	KK_ASSERT(slot.first < detail_levels_.size());
@@ -498,9 +541,11 @@ void Shadowmapper::DrawToDepthCubemap(
 	Uniforms uniforms;
 	uniforms.light_pos= light_pos;
 	uniforms.inv_light_radius= 1.0f / light_radius;
+	uniforms.vertex_pos_step= vertex_pos_step;
+	uniforms.vertex_pos_first_box= vertex_pos_first_box;
 	command_buffer.pushConstants(
 		*pipeline_layout_,
-		vk::ShaderStageFlagBits::eGeometry,
+		c_uniforms_stages,
 		0,
 		sizeof(uniforms),
 		&uniforms);
@@ -16,17 +16,26 @@ public:
 		GPUDataUploader& gpu_data_uploader,
 		size_t vertex_size,
 		size_t vertex_pos_offset,
-		vk::Format vertex_pos_format);
+		vk::Format vertex_pos_format,
+		// If non-zero, instance data is read from vertex binding 1. Instance data must start with 3 columns of affine transformation matrix (3 x vec4).
+		// Such transformation produces world space positions, quantization boxes are not used.
+		size_t instance_size);
 	~Shadowmapper();
 
 	ShadowmapSize GetSize() const;
 	std::vector<vk::ImageView> GetDepthCubemapArrayImagesView() const;
 
+	// Buffer with offsets of vertex positions quantization boxes (vec4 for each box). Must be set before drawing.
+	void SetVertexPosBoxesBuffer(vk::Buffer buffer, vk::DeviceSize size);
+
+	// Vertex positions are transformed as pos.xyz * vertex_pos_step + offset of box with index vertex_pos_first_box + (pos.w >> 1).
 	void DrawToDepthCubemap(
 		vk::CommandBuffer command_buffer,
 		ShadowmapSlot slot,
 		const m_Vec3& light_pos,
 		float light_radius,
+		float vertex_pos_step,
+		uint32_t vertex_pos_first_box,
 		const std::function<void()>& draw_function);
 
 private:
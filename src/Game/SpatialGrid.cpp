@@ -0,0 +1,183 @@
+#include "SpatialGrid.hpp"
+#include "Assert.hpp"
+#include <algorithm>
+#include <cmath>
+
+
+namespace KK
+{
+
+namespace
+{
+
+const float c_min_cell_size= 1.0f;
+const size_t c_max_cells= 65536u;
+
+} // namespace
+
+SpatialGrid::SpatialGrid(const m_Vec3* const boxes_min, const m_Vec3* const boxes_max, const size_t count)
+	: boxes_min_(boxes_min, boxes_min + count)
+	, boxes_max_(boxes_max, boxes_max + count)
+{
+	m_Vec3 bb_min(+1e24f, +1e24f, +1e24f);
+	m_Vec3 bb_max(-1e24f, -1e24f, -1e24f);
+	float average_box_size= 0.0f;
+	for(size_t i= 0u; i < count; ++i)
+	{
+		bb_min.x= std::min(bb_min.x, boxes_min[i].x);
+		bb_min.y= std::min(bb_min.y, boxes_min[i].y);
+		bb_min.z= std::min(bb_min.z, boxes_min[i].z);
+		bb_max.x= std::max(bb_max.x, boxes_max[i].x);
+		bb_max.y= std::max(bb_max.y, boxes_max[i].y);
+		bb_max.z= std::max(bb_max.z, boxes_max[i].z);
+		average_box_size+=
+			std::max(
+				std::max(boxes_max[i].x - boxes_min[i].x, boxes_max[i].y - boxes_min[i].y),
+				boxes_max[i].z - boxes_min[i].z);
+	}
+	if(count == 0u)
+		bb_min= bb_max= m_Vec3(0.0f, 0.0f, 0.0f);
+	else
+		average_box_size/= float(count);
+
+	start_= bb_min;
+
+	// Cell size is about size of box, but number of cells is limited.
+	cell_size_= std::max(average_box_size, c_min_cell_size);
+	while(true)
+	{
+		size_[0]= std::max(1u, uint32_t(std::ceil((bb_max.x - bb_min.x) / cell_size_)));
+		size_[1]= std::max(1u, uint32_t(std::ceil((bb_max.y - bb_min.y) / cell_size_)));
+		size_[2]= std::max(1u, uint32_t(std::ceil((bb_max.z - bb_min.z) / cell_size_)));
+		if(size_t(size_[0]) * size_t(size_[1]) * size_t(size_[2]) <= c_max_cells)
+			break;
+		cell_size_*= 1.25f;
+	}
+	inv_cell_size_= 1.0f / cell_size_;
+
+	const size_t cell_count= size_t(size_[0]) * size_t(size_[1]) * size_t(size_[2]);
+
+	// Count boxes of each cell, calculate offsets, after that fill cells.
+	cells_offsets_.resize(cell_count + 1u, 0u);
+	for(size_t pass= 0u; pass < 2u; ++pass)
+	{
+		for(size_t i= 0u; i < count; ++i)
+		{
+			uint32_t cell_min[3], cell_max[3];
+			GetCellsRange(boxes_min[i], boxes_max[i], cell_min, cell_max);
+
+			for(uint32_t z= cell_min[2]; z <= cell_max[2]; ++z)
+			for(uint32_t y= cell_min[1]; y <= cell_max[1]; ++y)
+			for(uint32_t x= cell_min[0]; x <= cell_max[0]; ++x)
+			{
+				const size_t cell_index= x + y * size_[0] + z * (size_[0] * size_[1]);
+				if(pass == 0u)
+					++cells_offsets_[cell_index + 1u];
+				else
+				{
+					cells_boxes_[cells_offsets_[cell_index]]= BoxIndex(i);
+					++cells_offsets_[cell_index];
+				}
+			}
+		}
+
+		if(pass == 0u)
+		{
+			for(size_t i= 0u; i < cell_count; ++i)
+				cells_offsets_[i + 1u]+= cells_offsets_[i];
+			cells_boxes_.resize(cells_offsets_[cell_count]);
+		}
+		else
+		{
+			// Offsets were shifted while filling - restore them.
+			for(size_t i= cell_count; i > 0u; --i)
+				cells_offsets_[i]= cells_offsets_[i - 1u];
+			cells_offsets_[0]= 0u;
+		}
+	}
+}
+
+void SpatialGrid::FindBoxesContainingPoint(const m_Vec3& point, std::vector<BoxIndex>& out_boxes) const
+{
+	out_boxes.clear();
+
+	uint32_t cell_min[3], cell_max[3];
+	GetCellsRange(point, point, cell_min, cell_max);
+	const size_t cell_index= cell_min[0] + cell_min[1] * size_[0] + cell_min[2] * (size_[0] * size_[1]);
+
+	// Each box is stored only once in each cell, so, no duplicates are possible here.
+	for(uint32_t i= cells_offsets_[cell_index]; i < cells_offsets_[cell_index + 1u]; ++i)
+	{
+		const BoxIndex box_index= cells_boxes_[i];
+		const m_Vec3& bb_min= boxes_min_[box_index];
+		const m_Vec3& bb_max= boxes_max_[box_index];
+		if( point.x >= bb_min.x && point.x <= bb_max.x &&
+			point.y >= bb_min.y && point.y <= bb_max.y &&
+			point.z >= bb_min.z && point.z <= bb_max.z)
+			out_boxes.push_back(box_index);
+	}
+
+	std::sort(out_boxes.begin(), out_boxes.end());
+}
+
+void SpatialGrid::FindBoxesIntersectingSphere(const m_Vec3& center, const float radius, std::vector<BoxIndex>& out_boxes) const
+{
+	out_boxes.clear();
+
+	const m_Vec3 sphere_min= center - m_Vec3(radius, radius, radius);
+	const m_Vec3 sphere_max= center + m_Vec3(radius, radius, radius);
+
+	uint32_t cell_min[3], cell_max[3];
+	GetCellsRange(sphere_min, sphere_max, cell_min, cell_max);
+
+	for(uint32_t z= cell_min[2]; z <= cell_max[2]; ++z)
+	for(uint32_t y= cell_min[1]; y <= cell_max[1]; ++y)
+	for(uint32_t x= cell_min[0]; x <= cell_max[0]; ++x)
+	{
+		const size_t cell_index= x + y * size_[0] + z * (size_[0] * size_[1]);
+		for(uint32_t i= cells_offsets_[cell_index]; i < cells_offsets_[cell_index + 1u]; ++i)
+		{
+			const BoxIndex box_index= cells_boxes_[i];
+			const m_Vec3& bb_min= boxes_min_[box_index];
+			const m_Vec3& bb_max= boxes_max_[box_index];
+			if( sphere_max.x >= bb_min.x && sphere_min.x <= bb_max.x &&
+				sphere_max.y >= bb_min.y && sphere_min.y <= bb_max.y &&
+				sphere_max.z >= bb_min.z && sphere_min.z <= bb_max.z)
+				out_boxes.push_back(box_index);
+		}
+	}
+
+	// Box may be found in several cells.
+	std::sort(out_boxes.begin(), out_boxes.end());
+	out_boxes.erase(std::unique(out_boxes.begin(), out_boxes.end()), out_boxes.end());
+}
+
+const uint32_t* SpatialGrid::GetSize() const
+{
+	return size_;
+}
+
+float SpatialGrid::GetCellSize() const
+{
+	return cell_size_;
+}
+
+size_t SpatialGrid::GetCellsElementsCount() const
+{
+	return cells_boxes_.size();
+}
+
+void SpatialGrid::GetCellsRange(const m_Vec3& min, const m_Vec3& max, uint32_t* const out_cell_min, uint32_t* const out_cell_max) const
+{
+	// Clamp to grid borders - all boxes are inside grid, so, outer cells are enough.
+	const float min_relative[3]{ (min.x - start_.x) * inv_cell_size_, (min.y - start_.y) * inv_cell_size_, (min.z - start_.z) * inv_cell_size_ };
+	const float max_relative[3]{ (max.x - start_.x) * inv_cell_size_, (max.y - start_.y) * inv_cell_size_, (max.z - start_.z) * inv_cell_size_ };
+	for(size_t i= 0u; i < 3u; ++i)
+	{
+		const float max_cell= float(size_[i] - 1u);
+		out_cell_min[i]= uint32_t(std::max(0.0f, std::min(std::floor(min_relative[i]), max_cell)));
+		out_cell_max[i]= uint32_t(std::max(0.0f, std::min(std::floor(max_relative[i]), max_cell)));
+	}
+}
+
+} // namespace KK
@@ -0,0 +1,46 @@
+#pragma once
+#include "../MathLib/Vec.hpp"
+#include <cstdint>
+#include <vector>
+
+
+namespace KK
+{
+
+// Uniform grid over set of axis-aligned boxes. Each cell contains indices of boxes, touching this cell.
+// Built once, used for fast point and sphere queries instead of linear search over all boxes.
+class SpatialGrid final
+{
+public:
+	using BoxIndex= uint32_t;
+
+public:
+	SpatialGrid(const m_Vec3* boxes_min, const m_Vec3* boxes_max, size_t count);
+
+	// Find boxes, containing point (borders are included). Result is sorted.
+	void FindBoxesContainingPoint(const m_Vec3& point, std::vector<BoxIndex>& out_boxes) const;
+
+	// Find boxes, intersecting box of sphere. Result is sorted.
+	void FindBoxesIntersectingSphere(const m_Vec3& center, float radius, std::vector<BoxIndex>& out_boxes) const;
+
+	const uint32_t* GetSize() const; // Cells count for each dimension.
+	float GetCellSize() const;
+	size_t GetCellsElementsCount() const; // Total number of indices in all cells.
+
+private:
+	void GetCellsRange(const m_Vec3& min, const m_Vec3& max, uint32_t* out_cell_min, uint32_t* out_cell_max) const;
+
+private:
+	uint32_t size_[3]{ 1u, 1u, 1u };
+	m_Vec3 start_;
+	float cell_size_= 1.0f;
+	float inv_cell_size_= 1.0f;
+
+	std::vector<m_Vec3> boxes_min_;
+	std::vector<m_Vec3> boxes_max_;
+
+	std::vector<uint32_t> cells_offsets_; // Cells count + 1 offsets into "cells_boxes_".
+	std::vector<BoxIndex> cells_boxes_;
+};
+
+} // namespace KK
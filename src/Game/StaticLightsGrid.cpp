@@ -0,0 +1,142 @@
+#include "StaticLightsGrid.hpp"
+#include "Assert.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace KK
+{
+
+namespace
+{
+
+const float c_min_cell_size= 2.0f;
+const size_t c_max_cells= 65536u;
+
+} // namespace
+
+StaticLightsGrid::StaticLightsGrid(
+	const m_Vec3& bb_min,
+	const m_Vec3& bb_max,
+	const m_Vec3* const centers,
+	const float* const radii,
+	const size_t count)
+	: start_(bb_min)
+	, light_count_(count)
+{
+	KK_ASSERT(count <= std::numeric_limits<ElementId>::max());
+
+	const m_Vec3 bb_size(
+		std::max(bb_max.x - bb_min.x, 0.0f),
+		std::max(bb_max.y - bb_min.y, 0.0f),
+		std::max(bb_max.z - bb_min.z, 0.0f));
+
+	// Increase cell size until grid fits into limit.
+	cell_size_= c_min_cell_size;
+	while(true)
+	{
+		size_[0]= std::max(1u, uint32_t(std::ceil(bb_size.x / cell_size_)));
+		size_[1]= std::max(1u, uint32_t(std::ceil(bb_size.y / cell_size_)));
+		size_[2]= std::max(1u, uint32_t(std::ceil(bb_size.z / cell_size_)));
+		if(size_t(size_[0]) * size_t(size_[1]) * size_t(size_[2]) <= c_max_cells)
+			break;
+		cell_size_*= 1.25f;
+	}
+
+	const size_t cell_count= size_t(size_[0]) * size_t(size_[1]) * size_t(size_[2]);
+
+	// Collect lights of each cell. Check distance from light center to cell box.
+	std::vector<std::vector<ElementId>> cells_lights(cell_count);
+	for(size_t i= 0u; i < count; ++i)
+	{
+		const m_Vec3& center= centers[i];
+		const float radius= radii[i];
+
+		const float relative_center[3]
+		{
+			(center.x - start_.x) / cell_size_,
+			(center.y - start_.y) / cell_size_,
+			(center.z - start_.z) / cell_size_,
+		};
+
+		int32_t cell_min[3], cell_max[3];
+		for(size_t j= 0u; j < 3u; ++j)
+		{
+			cell_min[j]= std::max(int32_t(std::floor(relative_center[j] - radius / cell_size_)), 0);
+			cell_max[j]= std::min(int32_t(std::floor(relative_center[j] + radius / cell_size_)), int32_t(size_[j]) - 1);
+		}
+
+		for(int32_t z= cell_min[2]; z <= cell_max[2]; ++z)
+		for(int32_t y= cell_min[1]; y <= cell_max[1]; ++y)
+		for(int32_t x= cell_min[0]; x <= cell_max[0]; ++x)
+		{
+			const m_Vec3 box_min= start_ + m_Vec3(float(x), float(y), float(z)) * cell_size_;
+			const m_Vec3 box_max= box_min + m_Vec3(cell_size_, cell_size_, cell_size_);
+
+			const float dx= std::max(0.0f, std::max(box_min.x - center.x, center.x - box_max.x));
+			const float dy= std::max(0.0f, std::max(box_min.y - center.y, center.y - box_max.y));
+			const float dz= std::max(0.0f, std::max(box_min.z - center.z, center.z - box_max.z));
+			if(dx * dx + dy * dy + dz * dz > radius * radius)
+				continue;
+
+			cells_lights[size_t(x) + size_t(y) * size_[0] + size_t(z) * (size_[0] * size_[1])].push_back(ElementId(i));
+		}
+	}
+
+	// Fill offsets and lists. Cells with same list as previous cell share it.
+	lists_elements_count_= 0u;
+	std::vector<ElementId> lists;
+	std::vector<uint32_t> offsets(cell_count, 0u);
+	for(size_t i= 0u; i < cell_count; ++i)
+	{
+		if(i > 0u && cells_lights[i] == cells_lights[i - 1u])
+		{
+			offsets[i]= offsets[i - 1u];
+			continue;
+		}
+
+		offsets[i]= uint32_t(lists.size());
+		lists.push_back(ElementId(cells_lights[i].size()));
+		lists.insert(lists.end(), cells_lights[i].begin(), cells_lights[i].end());
+	}
+	lists_elements_count_= lists.size();
+
+	// Pack lists elements into words.
+	data_.resize(cell_count + (lists.size() + 1u) / 2u, 0u);
+	std::copy(offsets.begin(), offsets.end(), data_.begin());
+	for(size_t i= 0u; i < lists.size(); ++i)
+		data_[cell_count + i / 2u]|= DataWord(lists[i]) << (16u * (i & 1u));
+}
+
+const uint32_t* StaticLightsGrid::GetSize() const
+{
+	return size_;
+}
+
+const m_Vec3& StaticLightsGrid::GetStart() const
+{
+	return start_;
+}
+
+float StaticLightsGrid::GetCellSize() const
+{
+	return cell_size_;
+}
+
+size_t StaticLightsGrid::GetLightCount() const
+{
+	return light_count_;
+}
+
+const std::vector<StaticLightsGrid::DataWord>& StaticLightsGrid::GetData() const
+{
+	return data_;
+}
+
+size_t StaticLightsGrid::GetListsElementsCount() const
+{
+	return lists_elements_count_;
+}
+
+} // namespace KK
@@ -0,0 +1,41 @@
+#pragma once
+#include "../MathLib/Vec.hpp"
+#include <cstdint>
+#include <vector>
+
+
+namespace KK
+{
+
+// World-space uniform grid, where each cell contains list of static lights, affecting this cell.
+// Built once for world. Result is stored in format, directly used by GPU:
+// table of offsets for each cell, followed by lists, where for each cell lights count is followed by lights ids.
+// Offsets are in list elements, lists elements are 16-bit and packed into 32-bit words.
+class StaticLightsGrid final
+{
+public:
+	using ElementId= uint16_t;
+	using DataWord= uint32_t;
+
+public:
+	// Grid covers given box. Cell size is selected in order to limit total number of cells.
+	StaticLightsGrid(const m_Vec3& bb_min, const m_Vec3& bb_max, const m_Vec3* centers, const float* radii, size_t count);
+
+	const uint32_t* GetSize() const; // Cells count for each dimension.
+	const m_Vec3& GetStart() const;
+	float GetCellSize() const;
+	size_t GetLightCount() const;
+
+	const std::vector<DataWord>& GetData() const;
+	size_t GetListsElementsCount() const; // Total number of elements in lists, include counters.
+
+private:
+	uint32_t size_[3]{ 1u, 1u, 1u };
+	m_Vec3 start_;
+	float cell_size_= 1.0f;
+	size_t light_count_= 0u;
+	std::vector<DataWord> data_;
+	size_t lists_elements_count_= 0u;
+};
+
+} // namespace KK
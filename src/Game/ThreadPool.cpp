@@ -0,0 +1,95 @@
+#include "ThreadPool.hpp"
+#include "Assert.hpp"
+
+
+namespace KK
+{
+
+ThreadPool::ThreadPool(const size_t thread_count)
+{
+	KK_ASSERT(thread_count >= 1u);
+
+	threads_.reserve(thread_count - 1u);
+	for(size_t i= 1u; i < thread_count; ++i)
+		threads_.emplace_back([this]{ WorkerThreadFunc(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		quit_= true;
+	}
+	start_condition_.notify_all();
+
+	for(std::thread& thread : threads_)
+		thread.join();
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+	return threads_.size() + 1u;
+}
+
+void ThreadPool::Run(const size_t task_count, const TaskFunc& func)
+{
+	if(threads_.empty())
+	{
+		for(size_t i= 0u; i < task_count; ++i)
+			func(i);
+		return;
+	}
+
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		func_= &func;
+		task_count_= task_count;
+		next_task_= 0u;
+		threads_finished_= 0u;
+		++generation_;
+	}
+	start_condition_.notify_all();
+
+	ProcessTasks();
+
+	// Wait for all threads, not only for all tasks. Threads must not touch task data after return.
+	std::unique_lock<std::mutex> lock(mutex_);
+	finish_condition_.wait(lock, [this]{ return threads_finished_ == threads_.size(); });
+	func_= nullptr;
+}
+
+void ThreadPool::WorkerThreadFunc()
+{
+	uint64_t last_generation= 0u;
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			start_condition_.wait(lock, [&]{ return quit_ || generation_ != last_generation; });
+			if(quit_)
+				return;
+			last_generation= generation_;
+		}
+
+		ProcessTasks();
+
+		{
+			const std::lock_guard<std::mutex> lock(mutex_);
+			++threads_finished_;
+		}
+		finish_condition_.notify_one();
+	}
+}
+
+void ThreadPool::ProcessTasks()
+{
+	while(true)
+	{
+		const size_t task_index= next_task_.fetch_add(1u);
+		if(task_index >= task_count_)
+			break;
+		(*func_)(task_index);
+	}
+}
+
+} // namespace KK
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace KK
+{
+
+// Simple pool of persistent threads for data-parallel tasks.
+// Calling thread participates in work too.
+class ThreadPool final
+{
+public:
+	using TaskFunc= std::function<void(size_t task_index)>;
+
+	// Total number of threads, including calling thread.
+	explicit ThreadPool(size_t thread_count);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&)= delete;
+	ThreadPool& operator=(const ThreadPool&)= delete;
+
+	size_t GetThreadCount() const;
+
+	// Run "func" for each task index in range [0; task_count), wait until all tasks are finished.
+	void Run(size_t task_count, const TaskFunc& func);
+
+private:
+	void WorkerThreadFunc();
+	void ProcessTasks();
+
+private:
+	std::vector<std::thread> threads_;
+
+	std::mutex mutex_;
+	std::condition_variable start_condition_;
+	std::condition_variable finish_condition_;
+	uint64_t generation_= 0u;
+	size_t threads_finished_= 0u;
+	bool quit_= false;
+
+	const TaskFunc* func_= nullptr;
+	size_t task_count_= 0u;
+	std::atomic<size_t> next_task_{0u};
+};
+
+} // namespace KK
@@ -0,0 +1,708 @@
+#include "TriangleGroupsCullerGPU.hpp"
+#include "Assert.hpp"
+#include "ShaderList.hpp"
+#include <algorithm>
+
+
+namespace KK
+{
+
+namespace
+{
+
+static_assert(sizeof(TriangleGroupsCullerGPU::TriangleGroupDescription) == 80u, "Invalid size");
+static_assert(sizeof(TriangleGroupsCullerGPU::SectorDescription) == 80u, "Invalid size");
+static_assert(sizeof(vk::DrawIndexedIndirectCommand) == 20u, "Invalid size");
+
+// Upper levels are too coarse for culling, so, limit number of levels. This also limits alignment of pyramid size.
+const uint32_t c_max_mip_levels= 8u;
+
+const size_t c_max_update_buffer_size= 65536u;
+
+// Must match size in shaders.
+const uint32_t c_cull_workgroup_size= 64u;
+const uint32_t c_build_workgroup_size[2]{ 8u, 8u };
+
+// Must match modes in shader.
+const int32_t c_cull_mode_pre_pass_no_occlusion= 0;
+const int32_t c_cull_mode_pre_pass= 1;
+const int32_t c_cull_mode_main_pass= 2;
+
+namespace BuildShaderBindings
+{
+
+const uint32_t source_image= 0u;
+const uint32_t destination_image= 1u;
+
+}
+
+namespace CullShaderBindings
+{
+
+const uint32_t triangle_groups_buffer= 0u;
+const uint32_t sectors_buffer= 1u;
+const uint32_t visibility_flags_buffer= 2u;
+const uint32_t commands_buffer= 3u;
+const uint32_t pyramid_image= 4u;
+
+}
+
+} // namespace
+
+TriangleGroupsCullerGPU::TriangleGroupsCullerGPU(
+	WindowVulkan& window_vulkan,
+	const vk::ImageView depth_image_view,
+	const vk::Extent2D depth_image_size,
+	const size_t max_triangle_groups,
+	const size_t max_sectors)
+	: vk_device_(window_vulkan.GetVulkanDevice())
+	, memory_properties_(window_vulkan.GetMemoryProperties())
+	, queue_family_index_(window_vulkan.GetQueueFamilyIndex())
+	, depth_image_size_(depth_image_size)
+	, max_triangle_groups_(std::max(max_triangle_groups, size_t(1u)))
+	, max_sectors_(std::max(max_sectors, size_t(1u)))
+{
+	static_assert(sizeof(CullUniforms) <= 128u, "Uniforms size is too big, limit is 128 bytes");
+	static_assert(sizeof(BuildUniforms) <= 128u, "Uniforms size is too big, limit is 128 bytes");
+
+	triangle_groups_buffer_=
+		CreateBuffer(
+			sizeof(TriangleGroupDescription) * max_triangle_groups_,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	sectors_buffer_=
+		CreateBuffer(
+			sizeof(SectorDescription) * max_sectors_,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	visibility_flags_buffer_=
+		CreateBuffer(
+			sizeof(uint32_t) * max_triangle_groups_,
+			vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	commands_buffer_=
+		CreateBuffer(
+			sizeof(vk::DrawIndexedIndirectCommand) * max_triangle_groups_ * 3u,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	{ // Create pyramid image.
+		const vk::Extent2D mip0_size((depth_image_size_.width + 1u) / 2u, (depth_image_size_.height + 1u) / 2u);
+
+		pyramid_mip_levels_= 1u;
+		while(pyramid_mip_levels_ < c_max_mip_levels && (std::max(mip0_size.width, mip0_size.height) >> (pyramid_mip_levels_ - 1u)) > 1u)
+			++pyramid_mip_levels_;
+
+		const uint32_t alignment= 1u << (pyramid_mip_levels_ - 1u);
+		pyramid_size_.width = (mip0_size.width  + alignment - 1u) / alignment * alignment;
+		pyramid_size_.height= (mip0_size.height + alignment - 1u) / alignment * alignment;
+
+		pyramid_image_=
+			vk_device_.createImageUnique(
+				vk::ImageCreateInfo(
+					vk::ImageCreateFlags(),
+					vk::ImageType::e2D,
+					vk::Format::eR32Sfloat,
+					vk::Extent3D(pyramid_size_.width, pyramid_size_.height, 1u),
+					pyramid_mip_levels_,
+					1u,
+					vk::SampleCountFlagBits::e1,
+					vk::ImageTiling::eOptimal,
+					vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+					vk::SharingMode::eExclusive,
+					0u, nullptr,
+					vk::ImageLayout::eUndefined));
+
+		const vk::MemoryRequirements image_memory_requirements= vk_device_.getImageMemoryRequirements(*pyramid_image_);
+
+		vk::MemoryAllocateInfo vk_memory_allocate_info(image_memory_requirements.size);
+		for(uint32_t i= 0u; i < memory_properties_.memoryTypeCount; ++i)
+		{
+			if((image_memory_requirements.memoryTypeBits & (1u << i)) != 0 &&
+				(memory_properties_.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal) != vk::MemoryPropertyFlags())
+				vk_memory_allocate_info.memoryTypeIndex= i;
+		}
+
+		pyramid_image_memory_= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
+		vk_device_.bindImageMemory(*pyramid_image_, *pyramid_image_memory_, 0u);
+
+		pyramid_image_view_=
+			vk_device_.createImageViewUnique(
+				vk::ImageViewCreateInfo(
+					vk::ImageViewCreateFlags(),
+					*pyramid_image_,
+					vk::ImageViewType::e2D,
+					vk::Format::eR32Sfloat,
+					vk::ComponentMapping(),
+					vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0u, pyramid_mip_levels_, 0u, 1u)));
+
+		for(uint32_t i= 0u; i < pyramid_mip_levels_; ++i)
+			pyramid_mips_image_views_.push_back(
+				vk_device_.createImageViewUnique(
+					vk::ImageViewCreateInfo(
+						vk::ImageViewCreateFlags(),
+						*pyramid_image_,
+						vk::ImageViewType::e2D,
+						vk::Format::eR32Sfloat,
+						vk::ComponentMapping(),
+						vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, i, 1u, 0u, 1u))));
+	}
+
+	// Shaders read images only via "texelFetch", so, filtration is not important.
+	sampler_=
+		vk_device_.createSamplerUnique(
+			vk::SamplerCreateInfo(
+				vk::SamplerCreateFlags(),
+				vk::Filter::eNearest,
+				vk::Filter::eNearest,
+				vk::SamplerMipmapMode::eNearest,
+				vk::SamplerAddressMode::eClampToEdge,
+				vk::SamplerAddressMode::eClampToEdge,
+				vk::SamplerAddressMode::eClampToEdge,
+				0.0f,
+				VK_FALSE,
+				0.0f,
+				VK_FALSE,
+				vk::CompareOp::eNever,
+				0.0f,
+				float(pyramid_mip_levels_),
+				vk::BorderColor::eFloatTransparentBlack,
+				VK_FALSE));
+
+	// Create pyramid build pipeline.
+	build_shader_= CreateShader(vk_device_, ShaderNames::hi_z_build_comp);
+
+	const vk::DescriptorSetLayoutBinding build_descriptor_set_layout_bindings[]
+	{
+		{
+			BuildShaderBindings::source_image,
+			vk::DescriptorType::eCombinedImageSampler,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			&*sampler_,
+		},
+		{
+			BuildShaderBindings::destination_image,
+			vk::DescriptorType::eStorageImage,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+	};
+
+	build_descriptor_set_layout_=
+		vk_device_.createDescriptorSetLayoutUnique(
+			vk::DescriptorSetLayoutCreateInfo(
+				vk::DescriptorSetLayoutCreateFlags(),
+				uint32_t(std::size(build_descriptor_set_layout_bindings)), build_descriptor_set_layout_bindings));
+
+	const vk::PushConstantRange build_push_constant_range(
+		vk::ShaderStageFlagBits::eCompute,
+		0u,
+		sizeof(BuildUniforms));
+
+	build_pipeline_layout_=
+		vk_device_.createPipelineLayoutUnique(
+			vk::PipelineLayoutCreateInfo(
+				vk::PipelineLayoutCreateFlags(),
+				1u, &*build_descriptor_set_layout_,
+				1u, &build_push_constant_range));
+
+	build_pipeline_=
+		vk_device_.createComputePipelineUnique(
+			nullptr,
+			vk::ComputePipelineCreateInfo(
+				vk::PipelineCreateFlags(),
+				vk::PipelineShaderStageCreateInfo(
+					vk::PipelineShaderStageCreateFlags(),
+					vk::ShaderStageFlagBits::eCompute,
+					*build_shader_,
+					"main"),
+				*build_pipeline_layout_));
+
+	// Create cull pipeline.
+	cull_shader_= CreateShader(vk_device_, ShaderNames::triangle_groups_cull_comp);
+
+	const vk::DescriptorSetLayoutBinding cull_descriptor_set_layout_bindings[]
+	{
+		{
+			CullShaderBindings::triangle_groups_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+		{
+			CullShaderBindings::sectors_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+		{
+			CullShaderBindings::visibility_flags_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+		{
+			CullShaderBindings::commands_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			nullptr,
+		},
+		{
+			CullShaderBindings::pyramid_image,
+			vk::DescriptorType::eCombinedImageSampler,
+			1u,
+			vk::ShaderStageFlagBits::eCompute,
+			&*sampler_,
+		},
+	};
+
+	cull_descriptor_set_layout_=
+		vk_device_.createDescriptorSetLayoutUnique(
+			vk::DescriptorSetLayoutCreateInfo(
+				vk::DescriptorSetLayoutCreateFlags(),
+				uint32_t(std::size(cull_descriptor_set_layout_bindings)), cull_descriptor_set_layout_bindings));
+
+	const vk::PushConstantRange cull_push_constant_range(
+		vk::ShaderStageFlagBits::eCompute,
+		0u,
+		sizeof(CullUniforms));
+
+	cull_pipeline_layout_=
+		vk_device_.createPipelineLayoutUnique(
+			vk::PipelineLayoutCreateInfo(
+				vk::PipelineLayoutCreateFlags(),
+				1u, &*cull_descriptor_set_layout_,
+				1u, &cull_push_constant_range));
+
+	cull_pipeline_=
+		vk_device_.createComputePipelineUnique(
+			nullptr,
+			vk::ComputePipelineCreateInfo(
+				vk::PipelineCreateFlags(),
+				vk::PipelineShaderStageCreateInfo(
+					vk::PipelineShaderStageCreateFlags(),
+					vk::ShaderStageFlagBits::eCompute,
+					*cull_shader_,
+					"main"),
+				*cull_pipeline_layout_));
+
+	// Create descriptor sets.
+	const vk::DescriptorPoolSize descriptor_pool_sizes[]
+	{
+		{
+			vk::DescriptorType::eStorageBuffer,
+			4u
+		},
+		{
+			vk::DescriptorType::eCombinedImageSampler,
+			pyramid_mip_levels_ + 1u
+		},
+		{
+			vk::DescriptorType::eStorageImage,
+			pyramid_mip_levels_
+		},
+	};
+
+	descriptor_pool_=
+		vk_device_.createDescriptorPoolUnique(
+			vk::DescriptorPoolCreateInfo(
+				vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+				pyramid_mip_levels_ + 1u, // max sets.
+				uint32_t(std::size(descriptor_pool_sizes)), descriptor_pool_sizes));
+
+	// Each mip is built from previous mip, first mip - from depth image.
+	for(uint32_t i= 0u; i < pyramid_mip_levels_; ++i)
+	{
+		build_descriptor_sets_.push_back(
+			std::move(
+			vk_device_.allocateDescriptorSetsUnique(
+				vk::DescriptorSetAllocateInfo(
+					*descriptor_pool_,
+					1u, &*build_descriptor_set_layout_)).front()));
+
+		const vk::DescriptorImageInfo descriptor_source_image_info(
+			vk::Sampler(),
+			i == 0u ? depth_image_view : *pyramid_mips_image_views_[i - 1u],
+			i == 0u ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eGeneral);
+
+		const vk::DescriptorImageInfo descriptor_destination_image_info(
+			vk::Sampler(),
+			*pyramid_mips_image_views_[i],
+			vk::ImageLayout::eGeneral);
+
+		vk_device_.updateDescriptorSets(
+			{
+				{
+					*build_descriptor_sets_.back(),
+					BuildShaderBindings::source_image,
+					0u,
+					1u,
+					vk::DescriptorType::eCombinedImageSampler,
+					&descriptor_source_image_info,
+					nullptr,
+					nullptr
+				},
+				{
+					*build_descriptor_sets_.back(),
+					BuildShaderBindings::destination_image,
+					0u,
+					1u,
+					vk::DescriptorType::eStorageImage,
+					&descriptor_destination_image_info,
+					nullptr,
+					nullptr
+				},
+			},
+			{});
+	}
+
+	cull_descriptor_set_=
+		std::move(
+		vk_device_.allocateDescriptorSetsUnique(
+			vk::DescriptorSetAllocateInfo(
+				*descriptor_pool_,
+				1u, &*cull_descriptor_set_layout_)).front());
+
+	const vk::DescriptorBufferInfo descriptor_triangle_groups_buffer_info(
+		*triangle_groups_buffer_.buffer,
+		0u,
+		sizeof(TriangleGroupDescription) * max_triangle_groups_);
+
+	const vk::DescriptorBufferInfo descriptor_sectors_buffer_info(
+		*sectors_buffer_.buffer,
+		0u,
+		sizeof(SectorDescription) * max_sectors_);
+
+	const vk::DescriptorBufferInfo descriptor_visibility_flags_buffer_info(
+		*visibility_flags_buffer_.buffer,
+		0u,
+		sizeof(uint32_t) * max_triangle_groups_);
+
+	const vk::DescriptorBufferInfo descriptor_commands_buffer_info(
+		*commands_buffer_.buffer,
+		0u,
+		sizeof(vk::DrawIndexedIndirectCommand) * max_triangle_groups_ * 3u);
+
+	const vk::DescriptorImageInfo descriptor_pyramid_image_info(
+		vk::Sampler(),
+		*pyramid_image_view_,
+		vk::ImageLayout::eGeneral);
+
+	vk_device_.updateDescriptorSets(
+		{
+			{
+				*cull_descriptor_set_,
+				CullShaderBindings::triangle_groups_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_triangle_groups_buffer_info,
+				nullptr
+			},
+			{
+				*cull_descriptor_set_,
+				CullShaderBindings::sectors_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_sectors_buffer_info,
+				nullptr
+			},
+			{
+				*cull_descriptor_set_,
+				CullShaderBindings::visibility_flags_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_visibility_flags_buffer_info,
+				nullptr
+			},
+			{
+				*cull_descriptor_set_,
+				CullShaderBindings::commands_buffer,
+				0u,
+				1u,
+				vk::DescriptorType::eStorageBuffer,
+				nullptr,
+				&descriptor_commands_buffer_info,
+				nullptr
+			},
+			{
+				*cull_descriptor_set_,
+				CullShaderBindings::pyramid_image,
+				0u,
+				1u,
+				vk::DescriptorType::eCombinedImageSampler,
+				&descriptor_pyramid_image_info,
+				nullptr,
+				nullptr
+			},
+		},
+		{});
+}
+
+TriangleGroupsCullerGPU::~TriangleGroupsCullerGPU()
+{
+	// Sync before destruction.
+	vk_device_.waitIdle();
+}
+
+void TriangleGroupsCullerGPU::SetTriangleGroups(
+	const vk::CommandBuffer command_buffer,
+	const TriangleGroupDescription* const triangle_groups,
+	const size_t count)
+{
+	KK_ASSERT(count <= max_triangle_groups_);
+	triangle_group_count_= std::min(count, max_triangle_groups_);
+
+	UploadData(command_buffer, *triangle_groups_buffer_.buffer, triangle_groups, sizeof(TriangleGroupDescription) * triangle_group_count_);
+}
+
+void TriangleGroupsCullerGPU::SetSectors(const vk::CommandBuffer command_buffer, const SectorDescription* const sectors, const size_t count)
+{
+	KK_ASSERT(count <= max_sectors_);
+	UploadData(command_buffer, *sectors_buffer_.buffer, sectors, sizeof(SectorDescription) * std::min(count, max_sectors_));
+}
+
+void TriangleGroupsCullerGPU::SetLodParams(const m_Vec3& cam_pos, const float lod_max_error)
+{
+	lod_cam_pos_= cam_pos;
+	lod_max_error_= lod_max_error;
+}
+
+void TriangleGroupsCullerGPU::CullPrePass(const vk::CommandBuffer command_buffer, const bool occlusion_culling)
+{
+	// Pyramid image is used by cull shader, so, set its layout before first cull pass.
+	if(!pyramid_image_prepared_)
+	{
+		pyramid_image_prepared_= true;
+
+		const vk::ImageMemoryBarrier image_memory_barrier(
+			vk::AccessFlags(),
+			vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+			vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eGeneral,
+			queue_family_index_,
+			queue_family_index_,
+			*pyramid_image_,
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0u, pyramid_mip_levels_, 0u, 1u));
+
+		command_buffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTopOfPipe,
+			vk::PipelineStageFlagBits::eComputeShader,
+			vk::DependencyFlags(),
+			0u, nullptr,
+			0u, nullptr,
+			1u, &image_memory_barrier);
+	}
+
+	// Wait for data upload and for previous frame drawing, using commands.
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eDrawIndirect,
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::DependencyFlags(),
+		{ { vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead } },
+		{},
+		{});
+
+	if(!occlusion_culling)
+		pyramid_valid_= false;
+
+	// Matrix of previous frame is used - pyramid contains depth of previous frame.
+	DoCullPass(command_buffer, pyramid_view_matrix_, pyramid_valid_ ? c_cull_mode_pre_pass : c_cull_mode_pre_pass_no_occlusion);
+}
+
+void TriangleGroupsCullerGPU::CullMainPass(const vk::CommandBuffer command_buffer, const m_Mat4& view_matrix)
+{
+	// Wait for depth pre-pass and for pre-pass culling, which reads pyramid of previous frame.
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::DependencyFlags(),
+		{ { vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite } },
+		{},
+		{});
+
+	// Build pyramid.
+	command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, *build_pipeline_);
+
+	vk::Extent2D source_size= depth_image_size_;
+	for(uint32_t i= 0u; i < pyramid_mip_levels_; ++i)
+	{
+		const vk::Extent2D destination_size(pyramid_size_.width >> i, pyramid_size_.height >> i);
+
+		BuildUniforms uniforms;
+		uniforms.sizes[0]= int32_t(source_size.width);
+		uniforms.sizes[1]= int32_t(source_size.height);
+		uniforms.sizes[2]= int32_t(destination_size.width);
+		uniforms.sizes[3]= int32_t(destination_size.height);
+
+		command_buffer.bindDescriptorSets(
+			vk::PipelineBindPoint::eCompute,
+			*build_pipeline_layout_,
+			0u,
+			1u, &*build_descriptor_sets_[i],
+			0u, nullptr);
+
+		command_buffer.pushConstants(
+			*build_pipeline_layout_,
+			vk::ShaderStageFlagBits::eCompute,
+			0u,
+			sizeof(uniforms),
+			&uniforms);
+
+		command_buffer.dispatch(
+			(destination_size.width  + c_build_workgroup_size[0] - 1u) / c_build_workgroup_size[0],
+			(destination_size.height + c_build_workgroup_size[1] - 1u) / c_build_workgroup_size[1],
+			1u);
+
+		// Wait for this mip before reading it.
+		command_buffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eComputeShader,
+			vk::DependencyFlags(),
+			{ { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead } },
+			{},
+			{});
+
+		source_size= destination_size;
+	}
+
+	pyramid_view_matrix_= view_matrix;
+	pyramid_valid_= true;
+
+	DoCullPass(command_buffer, view_matrix, c_cull_mode_main_pass);
+}
+
+void TriangleGroupsCullerGPU::Invalidate()
+{
+	pyramid_valid_= false;
+}
+
+vk::Buffer TriangleGroupsCullerGPU::GetCommandsBuffer() const
+{
+	return *commands_buffer_.buffer;
+}
+
+vk::DeviceSize TriangleGroupsCullerGPU::GetCommandOffset(const CommandsList list, const size_t triangle_group_index) const
+{
+	return vk::DeviceSize(sizeof(vk::DrawIndexedIndirectCommand) * (size_t(list) * max_triangle_groups_ + triangle_group_index));
+}
+
+void TriangleGroupsCullerGPU::UploadData(
+	const vk::CommandBuffer command_buffer,
+	const vk::Buffer buffer,
+	const void* const data,
+	const size_t size)
+{
+	if(size == 0u)
+		return;
+
+	// Wait for reading of data in previous frame.
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlags(),
+		{},
+		{},
+		{});
+
+	for(size_t offset= 0u; offset < size; offset+= c_max_update_buffer_size)
+		command_buffer.updateBuffer(
+			buffer,
+			offset,
+			std::min(c_max_update_buffer_size, size - offset),
+			static_cast<const uint8_t*>(data) + offset);
+}
+
+void TriangleGroupsCullerGPU::DoCullPass(const vk::CommandBuffer command_buffer, const m_Mat4& view_matrix, const int32_t mode)
+{
+	if(triangle_group_count_ == 0u)
+		return;
+
+	CullUniforms uniforms;
+	uniforms.view_matrix= view_matrix;
+	uniforms.params[0]= mode;
+	uniforms.params[1]= int32_t(triangle_group_count_);
+	uniforms.params[2]= int32_t(pyramid_mip_levels_);
+	uniforms.params[3]= int32_t(max_triangle_groups_);
+	uniforms.depth_size[0]= int32_t(depth_image_size_.width);
+	uniforms.depth_size[1]= int32_t(depth_image_size_.height);
+	uniforms.depth_size[2]= 0;
+	uniforms.depth_size[3]= 0;
+	// Same parameters are used in both passes, so, same levels of detail are selected.
+	uniforms.lod_params[0]= lod_cam_pos_.x;
+	uniforms.lod_params[1]= lod_cam_pos_.y;
+	uniforms.lod_params[2]= lod_cam_pos_.z;
+	uniforms.lod_params[3]= lod_max_error_;
+
+	command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, *cull_pipeline_);
+
+	command_buffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eCompute,
+		*cull_pipeline_layout_,
+		0u,
+		1u, &*cull_descriptor_set_,
+		0u, nullptr);
+
+	command_buffer.pushConstants(
+		*cull_pipeline_layout_,
+		vk::ShaderStageFlagBits::eCompute,
+		0u,
+		sizeof(uniforms),
+		&uniforms);
+
+	command_buffer.dispatch(uint32_t((triangle_group_count_ + c_cull_workgroup_size - 1u) / c_cull_workgroup_size), 1u, 1u);
+
+	// Wait for result before drawing.
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eDrawIndirect,
+		vk::DependencyFlags(),
+		{ { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead } },
+		{},
+		{});
+}
+
+TriangleGroupsCullerGPU::Buffer TriangleGroupsCullerGPU::CreateBuffer(
+	const size_t size,
+	const vk::BufferUsageFlags usage,
+	const vk::MemoryPropertyFlags memory_flags)
+{
+	Buffer result;
+	result.buffer=
+		vk_device_.createBufferUnique(
+			vk::BufferCreateInfo(
+				vk::BufferCreateFlags(),
+				size,
+				usage));
+
+	const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*result.buffer);
+
+	vk::MemoryAllocateInfo vk_memory_allocate_info(buffer_memory_requirements.size);
+	for(uint32_t i= 0u; i < memory_properties_.memoryTypeCount; ++i)
+	{
+		if((buffer_memory_requirements.memoryTypeBits & (1u << i)) != 0 &&
+			(memory_properties_.memoryTypes[i].propertyFlags & memory_flags) == memory_flags)
+			vk_memory_allocate_info.memoryTypeIndex= i;
+	}
+
+	result.memory= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
+	vk_device_.bindBufferMemory(*result.buffer, *result.memory, 0u);
+
+	return result;
+}
+
+} // namespace KK
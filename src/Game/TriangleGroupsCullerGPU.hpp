@@ -0,0 +1,166 @@
+#pragma once
+#include "../MathLib/Mat.hpp"
+#include "WindowVulkan.hpp"
+
+
+namespace KK
+{
+
+// Culls triangle groups of world on GPU and writes indirect draw commands for them.
+// Command for each triangle group is placed at index of this group, culled groups have zero instance count.
+// Normally triangle groups are uploaded once, for each frame only clip frustums of sectors are uploaded.
+// Also groups, already culled on CPU, may be uploaded each frame together with single sector, accepting everything.
+//
+// Optionally hierarchical-Z occlusion culling is performed.
+// Pyramid of max depth is built from result of depth pre-pass and bounding boxes of groups are tested against it.
+// Occlusion culling is performed in two phases. Before depth pre-pass groups are tested against pyramid of previous frame.
+// After depth pre-pass new pyramid is built and groups are tested against it.
+// Groups, visible in second phase, but culled in first phase, are written into separate "late" commands list,
+// because they are missing in depth buffer and can't be drawn with "equal" depth test.
+class TriangleGroupsCullerGPU final
+{
+public:
+	static constexpr size_t c_max_lods= 2u; // Must match constant in shader.
+
+	// Input for one triangle group. Must match struct in shader.
+	struct TriangleGroupDescription
+	{
+		float bb_min[3];
+		uint32_t index_count;
+		float bb_max[3];
+		uint32_t first_index;
+		int32_t vertex_offset;
+		uint32_t sector_index;
+		uint32_t first_instance; // Written into commands as is. May be used for passing of per-draw data.
+		uint32_t instance_count; // Written into commands for visible groups.
+		// Levels of detail in order of error increasing. Full detail level is not included.
+		// Selected by same rule, as on CPU - most simplified level with error, not greater than distance * max error.
+		uint32_t lods_first_index[c_max_lods];
+		uint32_t lods_index_count[c_max_lods];
+		float lods_error[c_max_lods];
+		uint32_t lod_count;
+		uint32_t reserved;
+	};
+
+	// Planes of clip frustum of sector, inner side is positive. For invisible sectors all groups must be rejected by planes.
+	struct SectorDescription
+	{
+		float planes[5][4]; // normal, dist
+	};
+
+	enum class CommandsList
+	{
+		PrePass, // Groups inside clip frustums, visible in previous frame.
+		MainPass, // Groups, visible in current frame and drawn in depth pre-pass.
+		LatePass, // Groups, visible in current frame, but not drawn in depth pre-pass.
+	};
+
+public:
+	TriangleGroupsCullerGPU(
+		WindowVulkan& window_vulkan,
+		vk::ImageView depth_image_view,
+		vk::Extent2D depth_image_size,
+		size_t max_triangle_groups,
+		size_t max_sectors);
+
+	~TriangleGroupsCullerGPU();
+
+	// Upload triangle groups. Call it outside render pass, when set of groups is changed.
+	// Pyramid of previous frame is preserved, so, groups may be uploaded each frame.
+	void SetTriangleGroups(vk::CommandBuffer command_buffer, const TriangleGroupDescription* triangle_groups, size_t count);
+
+	// Upload clip frustums of sectors. Call it each frame, outside render pass, before "CullPrePass".
+	void SetSectors(vk::CommandBuffer command_buffer, const SectorDescription* sectors, size_t count);
+
+	// Set parameters for levels of detail selection. Call it each frame before "CullPrePass".
+	// Zero error disables levels of detail.
+	void SetLodParams(const m_Vec3& cam_pos, float lod_max_error);
+
+	// Cull groups by clip frustums of sectors and (optionally) by pyramid of previous frame.
+	// Call before depth pre-pass. After this call pre-pass commands are ready.
+	void CullPrePass(vk::CommandBuffer command_buffer, bool occlusion_culling);
+
+	// Build pyramid from depth pre-pass result and test groups against it.
+	// Call after depth pre-pass. After this call main pass and late pass commands are ready.
+	void CullMainPass(vk::CommandBuffer command_buffer, const m_Mat4& view_matrix);
+
+	// Discard pyramid of previous frame. Call it, if view is changed unpredictable.
+	void Invalidate();
+
+	vk::Buffer GetCommandsBuffer() const;
+	vk::DeviceSize GetCommandOffset(CommandsList list, size_t triangle_group_index) const;
+
+private:
+	struct Buffer
+	{
+		vk::UniqueBuffer buffer;
+		vk::UniqueDeviceMemory memory;
+	};
+
+	struct CullUniforms
+	{
+		m_Mat4 view_matrix;
+		int32_t params[4]; // mode, triangle group count, pyramid mip levels, max triangle groups
+		int32_t depth_size[4];
+		float lod_params[4]; // camera position, max error
+	};
+
+	struct BuildUniforms
+	{
+		int32_t sizes[4]; // source size, destination size
+	};
+
+private:
+	Buffer CreateBuffer(size_t size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memory_flags);
+	void UploadData(vk::CommandBuffer command_buffer, vk::Buffer buffer, const void* data, size_t size);
+	void DoCullPass(vk::CommandBuffer command_buffer, const m_Mat4& view_matrix, int32_t mode);
+
+private:
+	const vk::Device vk_device_;
+	const vk::PhysicalDeviceMemoryProperties memory_properties_;
+	const uint32_t queue_family_index_;
+	const vk::Extent2D depth_image_size_;
+	const size_t max_triangle_groups_;
+	const size_t max_sectors_;
+
+	size_t triangle_group_count_= 0u;
+
+	m_Vec3 lod_cam_pos_{ 0.0f, 0.0f, 0.0f };
+	float lod_max_error_= 0.0f;
+
+	// Matrix, used for building of current pyramid.
+	m_Mat4 pyramid_view_matrix_;
+	bool pyramid_valid_= false;
+	bool pyramid_image_prepared_= false;
+
+	Buffer triangle_groups_buffer_;
+	Buffer sectors_buffer_;
+	Buffer visibility_flags_buffer_; // Result of pre-pass culling.
+	Buffer commands_buffer_; // All lists of commands.
+
+	// Mip 0 has half size of depth image. Size is aligned in order to make each next mip exactly two times smaller.
+	vk::Extent2D pyramid_size_;
+	uint32_t pyramid_mip_levels_= 1u;
+	vk::UniqueImage pyramid_image_;
+	vk::UniqueDeviceMemory pyramid_image_memory_;
+	vk::UniqueImageView pyramid_image_view_; // All mips.
+	std::vector<vk::UniqueImageView> pyramid_mips_image_views_;
+
+	vk::UniqueSampler sampler_;
+
+	vk::UniqueShaderModule build_shader_;
+	vk::UniqueDescriptorSetLayout build_descriptor_set_layout_;
+	vk::UniquePipelineLayout build_pipeline_layout_;
+	vk::UniquePipeline build_pipeline_;
+
+	vk::UniqueShaderModule cull_shader_;
+	vk::UniqueDescriptorSetLayout cull_descriptor_set_layout_;
+	vk::UniquePipelineLayout cull_pipeline_layout_;
+	vk::UniquePipeline cull_pipeline_;
+
+	vk::UniqueDescriptorPool descriptor_pool_;
+	std::vector<vk::UniqueDescriptorSet> build_descriptor_sets_; // For each mip.
+	vk::UniqueDescriptorSet cull_descriptor_set_;
+};
+
+} // namespace KK
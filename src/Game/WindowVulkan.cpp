@@ -90,12 +90,24 @@ WindowVulkan::WindowVulkan(
 	}
 
 	// Create Vulkan instance.
+	// Request Vulkan 1.2, if possible, for optional features, such as descriptor indexing.
+	// Vulkan 1.0 loaders have no "vkEnumerateInstanceVersion", so, fetch it dynamically.
+	uint32_t loader_api_version= VK_API_VERSION_1_0;
+	if(const auto vkEnumerateInstanceVersion=
+		PFN_vkEnumerateInstanceVersion(vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion")))
+	{
+		if(vkEnumerateInstanceVersion(&loader_api_version) != VK_SUCCESS)
+			loader_api_version= VK_API_VERSION_1_0;
+	}
+	const uint32_t instance_api_version=
+		loader_api_version >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
+
 	const vk::ApplicationInfo vk_app_info(
 		"Klassenkampf",
 		VK_MAKE_VERSION(0, 0, 1),
 		"Klassenkampf",
 		VK_MAKE_VERSION(0, 0, 1),
-		VK_MAKE_VERSION(1, 0, 0));
+		instance_api_version);
 
 	vk::InstanceCreateInfo vk_instance_create_info(
 		vk::InstanceCreateFlags(),
@@ -209,14 +221,52 @@ WindowVulkan::WindowVulkan(
 
 	const char* const device_extension_names[]{ VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
-	const vk::PhysicalDeviceFeatures physical_device_features= GetRequiredDeviceFeatures();
+	vk::PhysicalDeviceFeatures physical_device_features= GetRequiredDeviceFeatures();
+
+	// Optional features.
+	const vk::PhysicalDeviceFeatures supported_features= physical_device.getFeatures();
+	if(supported_features.multiDrawIndirect != VK_FALSE) // For drawing of many triangle groups via single call
+	{
+		physical_device_features.setMultiDrawIndirect(VK_TRUE);
+		multi_draw_indirect_supported_= true;
+	}
+	if(supported_features.drawIndirectFirstInstance != VK_FALSE) // For passing of per-draw data via instance index
+	{
+		physical_device_features.setDrawIndirectFirstInstance(VK_TRUE);
+		draw_indirect_first_instance_supported_= true;
+	}
+
+	// Descriptor indexing is core since Vulkan 1.2. Request only features, needed for bindless textures.
+	vk::PhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features;
+	// Fetch "vkGetPhysicalDeviceFeatures2" dynamically too, because it is missing in Vulkan 1.0 loaders.
+	const auto vkGetPhysicalDeviceFeatures2=
+		PFN_vkGetPhysicalDeviceFeatures2(vk_instance_->getProcAddr("vkGetPhysicalDeviceFeatures2"));
+	if(instance_api_version >= VK_API_VERSION_1_2 &&
+		physical_device.getProperties().apiVersion >= VK_API_VERSION_1_2 &&
+		vkGetPhysicalDeviceFeatures2 != nullptr)
+	{
+		vk::PhysicalDeviceDescriptorIndexingFeatures supported_descriptor_indexing_features;
+		vk::PhysicalDeviceFeatures2 supported_features2;
+		supported_features2.pNext= &supported_descriptor_indexing_features;
+		vkGetPhysicalDeviceFeatures2(physical_device, &static_cast<VkPhysicalDeviceFeatures2&>(supported_features2));
 
-	const vk::DeviceCreateInfo vk_device_create_info(
+		if(supported_descriptor_indexing_features.runtimeDescriptorArray != VK_FALSE &&
+			supported_descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing != VK_FALSE)
+		{
+			descriptor_indexing_features.setRuntimeDescriptorArray(VK_TRUE);
+			descriptor_indexing_features.setShaderSampledImageArrayNonUniformIndexing(VK_TRUE);
+			descriptor_indexing_supported_= true;
+		}
+	}
+
+	vk::DeviceCreateInfo vk_device_create_info(
 		vk::DeviceCreateFlags(),
 		1u, &vk_device_queue_create_info,
 		0u, nullptr,
 		uint32_t(std::size(device_extension_names)), device_extension_names,
 		&physical_device_features);
+	if(descriptor_indexing_supported_)
+		vk_device_create_info.pNext= &descriptor_indexing_features;
 
 	// Create physical device.
 	// HACK! createDeviceUnique works wrong! Use other method instead.
@@ -474,4 +524,19 @@ const vk::PhysicalDevice& WindowVulkan::GetPhysicalDevice() const
 	return physical_device_;
 }
 
+bool WindowVulkan::IsMultiDrawIndirectSupported() const
+{
+	return multi_draw_indirect_supported_;
+}
+
+bool WindowVulkan::IsDrawIndirectFirstInstanceSupported() const
+{
+	return draw_indirect_first_instance_supported_;
+}
+
+bool WindowVulkan::IsDescriptorIndexingSupported() const
+{
+	return descriptor_indexing_supported_;
+}
+
 } // namespace KK
@@ -27,6 +27,9 @@ public:
 	vk::RenderPass GetRenderPass() const; // Render pass for rendering directly into screen.
 	const vk::PhysicalDeviceMemoryProperties& GetMemoryProperties() const;
 	const vk::PhysicalDevice& GetPhysicalDevice() const;
+	bool IsMultiDrawIndirectSupported() const;
+	bool IsDrawIndirectFirstInstanceSupported() const;
+	bool IsDescriptorIndexingSupported() const; // Runtime descriptor arrays with non-uniform indexing of sampled images.
 
 private:
 	struct CommandBufferData
@@ -52,6 +55,9 @@ private:
 	vk::UniqueDevice vk_device_;
 	vk::Queue vk_queue_= nullptr;
 	uint32_t vk_queue_family_index_= ~0u;
+	bool multi_draw_indirect_supported_= false;
+	bool draw_indirect_first_instance_supported_= false;
+	bool descriptor_indexing_supported_= false;
 	vk::Extent2D viewport_size_;
 	vk::PhysicalDeviceMemoryProperties memory_properties_;
 	vk::PhysicalDevice physical_device_;
@@ -4,9 +4,13 @@
 #include "DDSImage.hpp"
 #include "Image.hpp"
 #include "Log.hpp"
+#include "MeshOptimizer.hpp"
 #include "ShaderList.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
+#include <limits>
 
 
 namespace KK
@@ -18,6 +22,9 @@ namespace
 struct Uniforms
 {
 	m_Mat4 view_matrix;
+	// World space position= quantized position * step + offset of quantization box of vertex.
+	float vertex_pos_step;
+	uint32_t vertex_pos_first_box; // In boxes buffer. Vertices contain indices of boxes, relative to this.
 };
 static_assert(sizeof(Uniforms) <= 128u, "Uniforms size is too big, limit is 128 bytes");
 
@@ -31,43 +38,450 @@ struct LightBuffer
 		uint32_t shadowmap_index[2];
 	};
 
-	static constexpr size_t c_max_lights= 256u;
+	// Actual limit depends also on lights list format.
+	static constexpr size_t c_max_lights= 1024u;
 
 	float ambient_color[4];
 	uint32_t cluster_volume_size[4];
 	float viewport_size[2];
 	float w_convert_values[2];
+	uint32_t lights_options[4]; // [0] - 0 for 8-bit ids, 1 for 16-bit ids; [1] - 1 if static lights grid is used
 	Light lights[c_max_lights];
 };
 
 static_assert(sizeof(LightBuffer::Light) == 48u, "Invalid size");
-static_assert(sizeof(LightBuffer) == 48u + LightBuffer::c_max_lights * 48u, "Invalid size");
+static_assert(sizeof(LightBuffer) == 64u + LightBuffer::c_max_lights * 48u, "Invalid size");
+static_assert(sizeof(LightBuffer) <= 65536u, "Light buffer is updated via single \"updateBuffer\" call");
 
-struct WorldVertex
+struct ZBinsBufferHeader
 {
-	float pos[3];
-	float tex_coord[2];
-	int8_t normal[3];
-	int8_t binormal[3];
-	int8_t tangent[3];
-	int8_t reserved[3];
+	uint32_t size[4]; // tiles x, tiles y, words per tile, bins count
+	float w_convert_values[2];
+	float padding[2];
+};
+
+// Bins and masks follow header.
+static_assert(sizeof(ZBinsBufferHeader) == 32u, "Invalid size");
+
+struct StaticLightsGridBufferHeader
+{
+	uint32_t size[4]; // cells x, y, z
+	float start[3];
+	float inverse_cell_size;
+};
+
+// Grid data follows header.
+static_assert(sizeof(StaticLightsGridBufferHeader) == 32u, "Invalid size");
+
+// Markers in shadowmap indices of static lights. Must match shader values.
+// Lights of invisible sectors are skipped, because they may shine through walls.
+const uint32_t c_static_light_invisible_sector= 0xFFFFFFFFu;
+// Lights without free shadowmap are drawn without shadow, as in clusters mode. Array number is out of range.
+const uint32_t c_static_light_no_shadowmap= 0x0000FFFFu;
+
+// Packed array number (low 16 bits) and layer (high 16 bits).
+uint32_t PackShadowmapSlot(const ShadowmapSlot& slot)
+{
+	if(slot == ShadowmapAllocator::c_invalid_shadowmap_slot)
+		return c_static_light_no_shadowmap;
+	return (slot.first & 0xFFFFu) | (slot.second << 16u);
+}
+
+// Rectangle in normalized device coordinates. Defines frustum with apex in camera position.
+struct ClipRect
+{
+	float min_x, min_y, max_x, max_y;
+};
+
+const ClipRect c_full_clip_rect{ -1.0f, -1.0f, +1.0f, +1.0f };
+
+// Limit of sectors processing count (relative to sectors count) for portals traversal.
+const size_t c_max_portals_traversal_iterations_per_sector= 16u;
+
+bool IsClipRectEmpty(const ClipRect& rect)
+{
+	return rect.min_x >= rect.max_x || rect.min_y >= rect.max_y;
+}
+
+bool IsClipRectInside(const ClipRect& inner, const ClipRect& outer)
+{
+	return
+		inner.min_x >= outer.min_x && inner.max_x <= outer.max_x &&
+		inner.min_y >= outer.min_y && inner.max_y <= outer.max_y;
+}
+
+ClipRect IntersectClipRects(const ClipRect& l, const ClipRect& r)
+{
+	return ClipRect{ std::max(l.min_x, r.min_x), std::max(l.min_y, r.min_y), std::min(l.max_x, r.max_x), std::min(l.max_y, r.max_y) };
+}
+
+ClipRect UniteClipRects(const ClipRect& l, const ClipRect& r)
+{
+	return ClipRect{ std::min(l.min_x, r.min_x), std::min(l.min_y, r.min_y), std::max(l.max_x, r.max_x), std::max(l.max_y, r.max_y) };
+}
+
+// Returns false, if polygon is fully behind near plane.
+bool CalculatePolygonClipRect(
+	const m_Vec3* const vertices,
+	const size_t vertex_count,
+	const m_Mat4& view_matrix,
+	const float z_near,
+	ClipRect& out_rect)
+{
+	// Clip polygon in clip space by near plane. Use x, y, w components.
+	m_Vec3 clip_vertices[8];
+	KK_ASSERT(vertex_count * 2u <= std::size(clip_vertices));
+	m_Vec3 projected[4];
+	KK_ASSERT(vertex_count <= std::size(projected));
+	for(size_t i= 0u; i < vertex_count; ++i)
+	{
+		const m_Vec3& v= vertices[i];
+		const m_Vec3 proj= v * view_matrix;
+		projected[i]=
+			m_Vec3(
+				proj.x,
+				proj.y,
+				view_matrix.value[3] * v.x + view_matrix.value[7] * v.y + view_matrix.value[11] * v.z + view_matrix.value[15]);
+	}
+
+	size_t clip_vertex_count= 0u;
+	for(size_t i= 0u; i < vertex_count; ++i)
+	{
+		const m_Vec3& cur= projected[i];
+		const m_Vec3& next= projected[(i + 1u) % vertex_count];
+		if(cur.z >= z_near)
+			clip_vertices[clip_vertex_count++]= cur;
+		if((cur.z >= z_near) != (next.z >= z_near))
+			clip_vertices[clip_vertex_count++]= cur + (next - cur) * ((z_near - cur.z) / (next.z - cur.z));
+	}
+
+	if(clip_vertex_count == 0u)
+		return false;
+
+	out_rect= ClipRect{ +1e24f, +1e24f, -1e24f, -1e24f };
+	for(size_t i= 0u; i < clip_vertex_count; ++i)
+	{
+		const m_Vec3& v= clip_vertices[i];
+		const float x= v.x / v.z;
+		const float y= v.y / v.z;
+		out_rect.min_x= std::min(out_rect.min_x, x);
+		out_rect.min_y= std::min(out_rect.min_y, y);
+		out_rect.max_x= std::max(out_rect.max_x, x);
+		out_rect.max_y= std::max(out_rect.max_y, y);
+	}
+
+	return true;
+}
+
+m_Plane3 MakeNormalizedPlane(const float a, const float b, const float c, const float d)
+{
+	const m_Vec3 normal(a, b, c);
+	const float inv_length= 1.0f / std::max(normal.GetLength(), 1.0e-12f);
+	return m_Plane3(normal * inv_length, d * inv_length);
+}
+
+// Planes are derived from matrix - "x >= min_x * w", "x <= max_x * w", etc.
+void MakeClipFrustumPlanes(const m_Mat4& m, const float z_near, const ClipRect& rect, m_Plane3* const out_planes)
+{
+	out_planes[0]=
+		MakeNormalizedPlane(
+			m.value[0] - rect.min_x * m.value[3],
+			m.value[4] - rect.min_x * m.value[7],
+			m.value[8] - rect.min_x * m.value[11],
+			m.value[12] - rect.min_x * m.value[15]);
+	out_planes[1]=
+		MakeNormalizedPlane(
+			rect.max_x * m.value[3] - m.value[0],
+			rect.max_x * m.value[7] - m.value[4],
+			rect.max_x * m.value[11] - m.value[8],
+			rect.max_x * m.value[15] - m.value[12]);
+	out_planes[2]=
+		MakeNormalizedPlane(
+			m.value[1] - rect.min_y * m.value[3],
+			m.value[5] - rect.min_y * m.value[7],
+			m.value[9] - rect.min_y * m.value[11],
+			m.value[13] - rect.min_y * m.value[15]);
+	out_planes[3]=
+		MakeNormalizedPlane(
+			rect.max_y * m.value[3] - m.value[1],
+			rect.max_y * m.value[7] - m.value[5],
+			rect.max_y * m.value[11] - m.value[9],
+			rect.max_y * m.value[15] - m.value[13]);
+	out_planes[4]= MakeNormalizedPlane(m.value[3], m.value[7], m.value[11], m.value[15] - z_near);
+}
+
+// Test box corner, farthest along plane normal.
+bool IsBoxInsideFrustum(const m_Vec3& bb_min, const m_Vec3& bb_max, const m_Plane3* const planes, const size_t plane_count)
+{
+	for(size_t i= 0u; i < plane_count; ++i)
+	{
+		const m_Plane3& plane= planes[i];
+		const m_Vec3 corner(
+			plane.normal.x >= 0.0f ? bb_max.x : bb_min.x,
+			plane.normal.y >= 0.0f ? bb_max.y : bb_min.y,
+			plane.normal.z >= 0.0f ? bb_max.z : bb_min.z);
+		if(plane.IsPointBehindPlane(corner))
+			return false;
+	}
+	return true;
+}
+
+float GetBoxSquareDistance(const m_Vec3& point, const m_Vec3& bb_min, const m_Vec3& bb_max)
+{
+	const float dx= std::max(0.0f, std::max(bb_min.x - point.x, point.x - bb_max.x));
+	const float dy= std::max(0.0f, std::max(bb_min.y - point.y, point.y - bb_max.y));
+	const float dz= std::max(0.0f, std::max(bb_min.z - point.z, point.z - bb_max.z));
+	return dx * dx + dy * dy + dz * dz;
+}
+
+// Bits of non-negative floats have same order as floats itself.
+uint64_t DistanceToSortKey(const float distance)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &distance, sizeof(float));
+	return uint64_t(bits);
+}
+
+// Limit of "vkCmdUpdateBuffer".
+const size_t c_max_update_buffer_size= 65536u;
+
+// Number of lights, added into clusters volume at once.
+const size_t c_lights_batch_size= 16u;
+
+// Compact vertex, splitted into two streams. Depth-only passes read only positions stream.
+// Position is quantized relative to box of sector. Tangent frame is packed.
+struct WorldVertexPos
+{
+	uint16_t pos[3]; // See "vertex_pos_step" and "vertex_pos_boxes" of model.
+	uint16_t binormal_sign_and_box; // Bit 0 - binormal sign (0 - negative, 1 - positive), bits 1-15 - index of quantization box.
+};
+static_assert(sizeof(WorldVertexPos) == 8u, "Invalid size");
+
+struct WorldVertexAttributes
+{
+	int16_t tex_coord[2]; // Fixed point, as in segment model.
+	int8_t normal[2]; // Octahedral encoding.
+	int8_t tangent[2]; // Octahedral encoding.
+};
+static_assert(sizeof(WorldVertexAttributes) == 8u, "Invalid size");
+
+const vk::Format c_world_vertex_pos_format= vk::Format::eR16G16B16A16Uint;
+
+// Limited by bits of box index in vertex.
+const size_t c_max_vertex_pos_boxes= 32768u;
+
+// Positions on lattice with such step are exactly representable in float, if they are less, than 2^24 steps.
+const float c_max_exact_vertex_pos_steps= 16777216.0f;
+
+// Load fails if quantization error is too big. Error is half of step.
+const float c_max_vertex_pos_step= 1.0f / 64.0f;
+
+// Instance of segment model. Transformation is applied to quantized vertex positions of model.
+struct WorldInstance
+{
+	float pos_transform[3][4]; // Columns of affine transformation matrix.
+	float normal_transform[4]; // 2x2 matrix of rotation around Z axis.
+};
+static_assert(sizeof(WorldInstance) == 64u, "Invalid size");
+
+// Octahedral encoding of direction into two signed normalized bytes.
+void PackDirectionOctahedral(const m_Vec3& dir, int8_t* const out)
+{
+	const float l1= std::abs(dir.x) + std::abs(dir.y) + std::abs(dir.z);
+	if(l1 <= 0.0f)
+	{
+		out[0]= out[1]= 0;
+		return;
+	}
+
+	float x= dir.x / l1;
+	float y= dir.y / l1;
+	if(dir.z < 0.0f)
+	{
+		const float folded_x= (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		const float folded_y= (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x= folded_x;
+		y= folded_y;
+	}
+
+	out[0]= int8_t(std::round(x * 127.0f));
+	out[1]= int8_t(std::round(y * 127.0f));
+}
+
+// Pack tangent frame and texture coordinates of segment model vertex. Tangent frame is rotated.
+void PackSegmentModelVertex(
+	const SegmentModelFormat::Vertex& in_v,
+	const m_Mat4& rotate_mat,
+	WorldVertexPos& out_v_pos,
+	WorldVertexAttributes& out_v)
+{
+	const m_Vec3 normal(float(in_v.normal[0]), float(in_v.normal[1]), float(in_v.normal[2]));
+	const m_Vec3 binormal(float(in_v.binormal[0]), float(in_v.binormal[1]), float(in_v.binormal[2]));
+	const m_Vec3 tangent(float(in_v.tangent[0]), float(in_v.tangent[1]), float(in_v.tangent[2]));
+	const m_Vec3 normal_transformed= normal * rotate_mat;
+	const m_Vec3 binormal_transformed= binormal * rotate_mat;
+	const m_Vec3 tangent_transformed= tangent * rotate_mat;
+
+	// Binormal is reconstructed from normal and tangent.
+	out_v_pos.binormal_sign_and_box= uint16_t(mVec3Dot(mVec3Cross(normal_transformed, tangent_transformed), binormal_transformed) >= 0.0f ? 1u : 0u);
+
+	PackDirectionOctahedral(normal_transformed, out_v.normal);
+	PackDirectionOctahedral(tangent_transformed, out_v.tangent);
+	out_v.tex_coord[0]= in_v.tex_coord[0];
+	out_v.tex_coord[1]= in_v.tex_coord[1];
+}
+
+// Key for welding of identical world vertices.
+// Position is snapped to fine grid in order to weld vertices of neighbor segments with small transformation errors.
+struct WorldVertexWeldKey
+{
+	int32_t pos[3];
+	uint16_t binormal_sign;
+	WorldVertexAttributes attributes;
+};
+
+const float c_weld_grid_scale= 4096.0f;
+
+bool operator==(const WorldVertexWeldKey& l, const WorldVertexWeldKey& r)
+{
+	return
+		l.pos[0] == r.pos[0] && l.pos[1] == r.pos[1] && l.pos[2] == r.pos[2] &&
+		l.binormal_sign == r.binormal_sign &&
+		l.attributes.tex_coord[0] == r.attributes.tex_coord[0] && l.attributes.tex_coord[1] == r.attributes.tex_coord[1] &&
+		l.attributes.normal[0] == r.attributes.normal[0] && l.attributes.normal[1] == r.attributes.normal[1] &&
+		l.attributes.tangent[0] == r.attributes.tangent[0] && l.attributes.tangent[1] == r.attributes.tangent[1];
+}
+
+struct WorldVertexWeldKeyHasher
+{
+	size_t operator()(const WorldVertexWeldKey& k) const
+	{
+		const uint64_t pos_hash=
+			uint64_t(uint32_t(k.pos[0])) * 73856093u ^
+			uint64_t(uint32_t(k.pos[1])) * 19349663u ^
+			uint64_t(uint32_t(k.pos[2])) * 83492791u;
+		const uint64_t attributes_bits=
+			uint64_t(uint16_t(k.attributes.tex_coord[0])) |
+			(uint64_t(uint16_t(k.attributes.tex_coord[1])) << 16u) |
+			(uint64_t(uint8_t(k.attributes.normal[0])) << 32u) |
+			(uint64_t(uint8_t(k.attributes.normal[1])) << 40u) |
+			(uint64_t(uint8_t(k.attributes.tangent[0])) << 48u) |
+			(uint64_t(uint8_t(k.attributes.tangent[1])) << 56u);
+		return std::hash<uint64_t>()((pos_hash * 31u + attributes_bits) * 2u + k.binormal_sign);
+	}
 };
 
+// Cache size for ACMR statistics.
+const size_t c_stats_vertex_cache_size= 32u;
+
+// Cell sizes of vertex clustering for levels of detail. Cell size is approximately equal to error of level.
+const float c_lod_cell_sizes[]{ 1.0f / 32.0f, 1.0f / 8.0f };
+
+const float c_max_quantized_pos= 65535.0f;
+
+// Page grows until one of these limits is reached. Single sector may exceed vertices limit.
+const size_t c_streaming_page_max_sectors= 16u;
+const size_t c_streaming_page_max_vertices= 65535u;
+
+// Evicted slot is reused only after this number of frames, when it is not used by frames in flight.
+const uint64_t c_streaming_slot_reuse_delay_frames= 4u;
+
+// Limit uploads in order to avoid stalls.
+const size_t c_streaming_max_uploads_per_frame= 2u;
+
+const uint32_t c_streaming_infinite_distance= std::numeric_limits<uint32_t>::max();
+
+// Transformation of segment model into world space. Rotation is also returned separately for tangent frame transformation.
+void CalculateSegmentMatrices(
+	const WorldData::Segment& segment,
+	const SegmentModelFormat::SegmentModelHeader& header,
+	m_Mat4& out_segment_mat,
+	m_Mat4& out_rotate_mat)
+{
+	m_Mat4 base_transform_mat, to_center_mat, from_center_mat, translate_mat;
+	base_transform_mat.MakeIdentity();
+	base_transform_mat.value[ 0]= header.scale[0];
+	base_transform_mat.value[ 5]= header.scale[1];
+	base_transform_mat.value[10]= header.scale[2];
+	base_transform_mat.value[12]= header.shift[0];
+	base_transform_mat.value[13]= header.shift[1];
+	base_transform_mat.value[14]= header.shift[2];
+
+	to_center_mat.Translate(m_Vec3(-0.5f, -0.5f, 0.0f));
+	out_rotate_mat.RotateZ(float(segment.angle) * MathConstants::half_pi);
+	from_center_mat.Translate(m_Vec3(+0.5f, +0.5f, 0.0f));
+	translate_mat.Translate(m_Vec3(float(segment.pos[0]), float(segment.pos[1]), float(segment.pos[2])));
+	out_segment_mat= base_transform_mat * to_center_mat * out_rotate_mat * from_center_mat * translate_mat;
+}
+
+// Quantize positions relative to box offset, which is multiple of step. Binormal sign of packed vertices is preserved.
+// Position is snapped to lattice independently of box, so, equal positions in different boxes are dequantized into equal positions.
+void QuantizeVerticesPositions(
+	const m_Vec3* const vertices_pos,
+	const size_t vertex_count,
+	const m_Vec3& box_offset,
+	const float step,
+	const uint32_t box_index,
+	WorldVertexPos* const out_vertices)
+{
+	KK_ASSERT(box_index < c_max_vertex_pos_boxes);
+	const float inv_step= 1.0f / step; // Step is power of two, so, scaling by it is exact.
+	const m_Vec3 box_offset_steps= box_offset * inv_step;
+	for(size_t i= 0u; i < vertex_count; ++i)
+	{
+		const m_Vec3 pos_steps= vertices_pos[i] * inv_step;
+		out_vertices[i].pos[0]= uint16_t(std::max(0.0f, std::min(std::round(pos_steps.x) - box_offset_steps.x, c_max_quantized_pos)));
+		out_vertices[i].pos[1]= uint16_t(std::max(0.0f, std::min(std::round(pos_steps.y) - box_offset_steps.y, c_max_quantized_pos)));
+		out_vertices[i].pos[2]= uint16_t(std::max(0.0f, std::min(std::round(pos_steps.z) - box_offset_steps.z, c_max_quantized_pos)));
+		out_vertices[i].binormal_sign_and_box= uint16_t((out_vertices[i].binormal_sign_and_box & 1u) | (box_index << 1u));
+	}
+}
+
 // Bindings must match shader bindings.
 namespace WorldShaderBindings
 {
 	const uint32_t light_buffer= 0u;
 	const uint32_t cluster_offset_buffer= 1u;
 	const uint32_t lights_list_buffer= 2u;
+	const uint32_t tile_depth_bounds_buffer= 3u;
 	const uint32_t ssao_image= 4u;
 	const uint32_t depth_cubemaps_array= 5u;
+	const uint32_t z_bins_buffer= 6u;
+	const uint32_t static_lights_buffer= 7u;
 	const uint32_t albedo_tex= 8u;
 	const uint32_t normals_tex= 9u;
 	const uint32_t occlusion_tex= 10u;
+	const uint32_t material_textures= 8u; // Bindless mode - all textures of all materials.
+	const uint32_t static_lights_grid_buffer= 11u;
+	const uint32_t static_lights_shadowmaps_buffer= 12u;
+	const uint32_t vertex_pos_boxes_buffer= 13u;
 }
 
 } // namespace
 
+struct WorldRenderer::SectorsGeometry
+{
+	// Indices of triangle groups are relative to start of these arrays.
+	std::vector<m_Vec3> vertices_pos; // Not quantized. Filled only for baked segments.
+	std::vector<WorldVertexPos> vertices_pos_packed;
+	std::vector<WorldVertexAttributes> vertices_attributes;
+	std::vector<uint32_t> indices;
+	uint32_t max_index= 0u;
+
+	// Optimization statistics.
+	size_t vertices_before_weld= 0u;
+	size_t cache_misses_before= 0u;
+	size_t cache_misses_after= 0u;
+	size_t lods_triangle_count= 0u;
+};
+
+struct WorldRenderer::StreamingPageBuildResult
+{
+	SectorsGeometry geometry; // Positions are quantized.
+	std::vector< std::vector<Sector::TriangleGroup> > sectors_triangle_groups; // For each sector of page.
+	std::atomic<bool> ready{ false }; // Set by background thread after build finish.
+};
+
 WorldRenderer::WorldRenderer(
 	Settings& settings,
 	CommandsProcessor& command_processor,
@@ -82,10 +496,23 @@ WorldRenderer::WorldRenderer(
 	, viewport_size_(window_vulkan.GetViewportSize())
 	, memory_properties_(window_vulkan.GetMemoryProperties())
 	, queue_family_index_(window_vulkan.GetQueueFamilyIndex())
+	, multi_draw_indirect_supported_(window_vulkan.IsMultiDrawIndirectSupported())
+	, draw_indirect_first_instance_supported_(window_vulkan.IsDrawIndirectFirstInstanceSupported())
+	// Instanced segments are drawn in shadows via indirect commands with non-zero first instance.
+	, instanced_segments_(settings.GetOrSetInt("r_instanced_segments", 0) != 0 && draw_indirect_first_instance_supported_)
 	, tonemapper_(settings, window_vulkan)
 	, ambient_occlusion_culculator_(settings, window_vulkan, gpu_data_uploader, tonemapper_)
-	, shadowmapper_(window_vulkan, gpu_data_uploader, sizeof(WorldVertex), offsetof(WorldVertex, pos), vk::Format::eR32G32B32Sfloat)
-	, cluster_volume_builder_(16u, 8u, 24u)
+	, shadowmapper_(
+		window_vulkan,
+		gpu_data_uploader,
+		sizeof(WorldVertexPos),
+		offsetof(WorldVertexPos, pos),
+		c_world_vertex_pos_format,
+		instanced_segments_ ? sizeof(WorldInstance) : 0u)
+	, cluster_volume_builder_(
+		16u, 8u, 24u,
+		settings.GetOrSetInt("r_clusters_16bit_lists", 1) != 0 ? ClusterVolumeBuilder::ListFormat::Id16 : ClusterVolumeBuilder::ListFormat::Id8)
+	, z_bins_builder_(32u, 24u, 256u, LightBuffer::c_max_lights)
 	, shadowmap_allocator_(shadowmapper_.GetSize())
 {
 
@@ -93,12 +520,17 @@ WorldRenderer::WorldRenderer(
 		CommandsMap(
 		{
 			{ "test_light_add", std::bind(&WorldRenderer::ComandTestLightAdd, this, std::placeholders::_1) },
-			{ "test_light_remove", std::bind(&WorldRenderer::CommandTestLightRemove, this) }
+			{ "test_light_remove", std::bind(&WorldRenderer::CommandTestLightRemove, this) },
+			{ "clusters_stats", std::bind(&WorldRenderer::CommandClustersStats, this) },
+			{ "culling_stats", std::bind(&WorldRenderer::CommandCullingStats, this) },
+			{ "world_streaming_stats", std::bind(&WorldRenderer::CommandWorldStreamingStats, this) },
 		}));
 	command_processor.RegisterCommands(commands_map_);
 
+	if(instanced_segments_)
+		Log::Info("Use instanced segments");
+
 	depth_pre_pass_pipeline_= CreateDepthPrePassPipeline();
-	lighting_pass_pipeline_= CreateLightingPassPipeline();
 
 	{ // Prepare lighting buffer.
 		vk_light_data_buffer_=
@@ -127,8 +559,8 @@ WorldRenderer::WorldRenderer(
 			vk_device_.createBufferUnique(
 				vk::BufferCreateInfo(
 					vk::BufferCreateFlags(),
-					sizeof(uint32_t) * size,
-					vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst));
+					sizeof(ClusterVolumeBuilder::OffsetType) * size,
+					vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc));
 
 		const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*cluster_offset_buffer_);
 
@@ -144,13 +576,13 @@ WorldRenderer::WorldRenderer(
 		vk_device_.bindBufferMemory(*cluster_offset_buffer_, *cluster_offset_buffer_memory_, 0u);
 	}
 	{ // Prepare lights list buffer.
-		lights_list_buffer_size_= cluster_volume_builder_.GetWidth() * cluster_volume_builder_.GetHeight() * cluster_volume_builder_.GetDepth() * 32u;
+		lights_list_buffer_size_= cluster_volume_builder_.GetElementsListCapacity();
 		lights_list_buffer_=
 			vk_device_.createBufferUnique(
 				vk::BufferCreateInfo(
 					vk::BufferCreateFlags(),
-					sizeof(uint8_t) * lights_list_buffer_size_,
-					vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst));
+					cluster_volume_builder_.GetElementSize() * lights_list_buffer_size_,
+					vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc));
 
 		const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*lights_list_buffer_);
 
@@ -165,6 +597,39 @@ WorldRenderer::WorldRenderer(
 		lights_list_buffer_memory_= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
 		vk_device_.bindBufferMemory(*lights_list_buffer_, *lights_list_buffer_memory_, 0u);
 	}
+	{ // Prepare Z-bins buffer.
+		const size_t max_words_per_tile= (z_bins_builder_.GetMaxElements() + ZBinsBuilder::c_bits_in_mask_word - 1u) / ZBinsBuilder::c_bits_in_mask_word;
+		z_bins_buffer_=
+			vk_device_.createBufferUnique(
+				vk::BufferCreateInfo(
+					vk::BufferCreateFlags(),
+					sizeof(ZBinsBufferHeader) +
+					sizeof(ZBinsBuilder::BinType) * z_bins_builder_.GetBinCount() +
+					sizeof(ZBinsBuilder::MaskWord) * z_bins_builder_.GetTilesX() * z_bins_builder_.GetTilesY() * max_words_per_tile,
+					vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst));
+
+		const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*z_bins_buffer_);
+
+		vk::MemoryAllocateInfo vk_memory_allocate_info(buffer_memory_requirements.size);
+		for(uint32_t i= 0u; i < memory_properties_.memoryTypeCount; ++i)
+		{
+			if((buffer_memory_requirements.memoryTypeBits & (1u << i)) != 0 &&
+				(memory_properties_.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal) != vk::MemoryPropertyFlags())
+				vk_memory_allocate_info.memoryTypeIndex= i;
+		}
+
+		z_bins_buffer_memory_= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
+		vk_device_.bindBufferMemory(*z_bins_buffer_, *z_bins_buffer_memory_, 0u);
+	}
+
+	cluster_volume_builder_gpu_.emplace(
+		window_vulkan,
+		cluster_volume_builder_,
+		tonemapper_.GetDepthImageView(),
+		*vk_light_data_buffer_,
+		sizeof(LightBuffer),
+		*cluster_offset_buffer_,
+		*lights_list_buffer_);
 
 	// Load segment models.
 	struct SegmentModelDescription
@@ -185,23 +650,39 @@ WorldRenderer::WorldRenderer(
 		{ WorldData::SegmentType::Column3Lights, "column3_lights" },
 	};
 
-	SegmentModels segment_models;
+	// Load stub images. They are needed for loading of materials.
+	const std::pair<ImageIndex*, const char*> stub_images[]
+	{
+		{ &stub_albedo_image_, "albedo_stub" },
+		{ &stub_normal_map_image_, "normals_stub" },
+		{ &stub_occlusion_image_, "occlusion_stub" },
+	};
+	for(const auto& stub_image : stub_images)
+	{
+		if(const std::optional<ImageIndex> image_index= LoadImage(stub_image.second))
+			*stub_image.first= *image_index;
+		else
+			Log::FatalError("Could not load image \"", stub_image.second, "\"");
+	}
+
+	// Load models and their materials.
 	for(const SegmentModelDescription& segment_model_description : segment_models_names)
 	{
 		const std::string file_path= "segment_models/" + std::string(segment_model_description.file_name) + ".kks";
 		if(std::optional<SegmentModel> model= LoadSegmentModel(file_path))
-			segment_models.emplace(segment_model_description.type, std::move(*model));
+			segment_models_.emplace(segment_model_description.type, std::move(*model));
 	}
 
-	// Load materials.
-	stub_albedo_image_id_= "albedo_stub";
-	LoadImage(stub_albedo_image_id_);
-	stub_normal_map_image_id_= "normals_stub";
-	LoadImage(stub_normal_map_image_id_);
-	stub_occlusion_image_id_= "occlusion_stub";
-	LoadImage(stub_occlusion_image_id_);
-
-	world_model_= LoadWorld(world, segment_models);
+	// In streaming mode geometry of world is built in background, by pages near camera.
+	// Instanced segments are small enough, so, streaming is not needed for them.
+	const bool world_streaming= settings_.GetOrSetInt("r_world_streaming", 0) != 0 && !instanced_segments_;
+	world_model_= LoadWorld(world, segment_models_, world_streaming);
+	if(world_streaming)
+	{
+		const int64_t thread_count= std::max(int64_t(1), std::min(settings_.GetOrSetInt("r_world_streaming_threads", 2), int64_t(32)));
+		streaming_task_queue_.emplace(size_t(thread_count));
+		Log::Info("Use world streaming");
+	}
 
 	// Load test world model.
 	{
@@ -219,11 +700,140 @@ WorldRenderer::WorldRenderer(
 		segment.type= WorldData::SegmentType::Floor;
 		test_world.sectors.back().segments.push_back(std::move(segment));
 
-		test_world_model_= LoadWorld(test_world, test_segment_models);
+		test_world_model_= LoadWorld(test_world, test_segment_models, false);
+	}
+
+	{ // Upload quantization boxes of all models into single buffer. Models use ranges of this buffer.
+		std::vector<float> boxes_data;
+		for(WorldModel* const model : { &world_model_, &test_world_model_ })
+		{
+			model->first_vertex_pos_box= uint32_t(boxes_data.size() / 4u);
+			for(const m_Vec3& box_offset : model->vertex_pos_boxes)
+			{
+				boxes_data.push_back(box_offset.x);
+				boxes_data.push_back(box_offset.y);
+				boxes_data.push_back(box_offset.z);
+				boxes_data.push_back(0.0f);
+			}
+		}
+
+		vertex_pos_boxes_buffer_=
+			vk_device_.createBufferUnique(
+				vk::BufferCreateInfo(
+					vk::BufferCreateFlags(),
+					boxes_data.size() * sizeof(float),
+					vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst));
+
+		const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*vertex_pos_boxes_buffer_);
+
+		vk::MemoryAllocateInfo vk_memory_allocate_info(buffer_memory_requirements.size);
+		for(uint32_t i= 0u; i < memory_properties_.memoryTypeCount; ++i)
+		{
+			if((buffer_memory_requirements.memoryTypeBits & (1u << i)) != 0 &&
+				(memory_properties_.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal) != vk::MemoryPropertyFlags())
+				vk_memory_allocate_info.memoryTypeIndex= i;
+		}
+
+		vertex_pos_boxes_buffer_memory_= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
+		vk_device_.bindBufferMemory(*vertex_pos_boxes_buffer_, *vertex_pos_boxes_buffer_memory_, 0u);
+
+		UploadBufferData(*vertex_pos_boxes_buffer_, 0u, boxes_data.data(), boxes_data.size() * sizeof(float));
+		shadowmapper_.SetVertexPosBoxesBuffer(*vertex_pos_boxes_buffer_, boxes_data.size() * sizeof(float));
 	}
 
 	gpu_data_uploader_.Flush();
 
+	{ // Select textures mode. Size of bindless textures array depends on materials count, so, create lighting pipeline after materials loading.
+		const vk::PhysicalDeviceLimits limits= window_vulkan.GetPhysicalDevice().getProperties().limits;
+		const size_t max_samplers=
+			std::min(
+				std::min(limits.maxPerStageDescriptorSamplers, limits.maxPerStageDescriptorSampledImages),
+				std::min(limits.maxDescriptorSetSamplers, limits.maxDescriptorSetSampledImages));
+		const size_t global_samplers= 1u + shadowmapper_.GetDepthCubemapArrayImagesView().size(); // ssao image + depth cubemaps
+
+		// Instance index is used for instanced segments, so, material index can't be passed via it.
+		bindless_textures_=
+			settings_.GetOrSetInt("r_bindless_textures", 1) != 0 &&
+			!instanced_segments_ &&
+			window_vulkan.IsDescriptorIndexingSupported() &&
+			draw_indirect_first_instance_supported_ &&
+			global_samplers + materials_.size() * 3u <= max_samplers;
+		if(bindless_textures_)
+			Log::Info("Use bindless textures");
+
+		lighting_pass_pipeline_= CreateLightingPassPipeline();
+	}
+
+	{ // Create triangle groups culler. Use size, enough for all models.
+		size_t max_triangle_groups= 0u;
+		size_t max_sectors= 0u;
+		for(const WorldModel* const model : { &world_model_, &test_world_model_ })
+		{
+			max_triangle_groups= std::max(max_triangle_groups, model->gpu_triangle_groups.size());
+			max_sectors= std::max(max_sectors, model->sectors.size());
+			// Draw list of streamed model is used for occlusion culling. Each resident group has at least one draw command.
+			if(model->streaming != std::nullopt)
+				max_triangle_groups= std::max(max_triangle_groups, model->streaming->slot_count * model->streaming->slot_draw_commands);
+		}
+
+		triangle_groups_culler_.emplace(
+			window_vulkan,
+			tonemapper_.GetDepthImageView(),
+			tonemapper_.GetFramebufferSize(),
+			max_triangle_groups,
+			max_sectors);
+		gpu_culling_sectors_.reserve(max_sectors);
+		draw_list_culler_triangle_groups_.reserve(max_triangle_groups);
+	}
+
+	{ // Prepare static lights buffers. Use size, enough for all models.
+		size_t max_static_lights= 1u;
+		size_t max_grid_data_size= 1u;
+		for(const WorldModel* const model : { &world_model_, &test_world_model_ })
+		{
+			max_static_lights= std::max(max_static_lights, model->static_lights_grid->GetLightCount());
+			max_grid_data_size= std::max(max_grid_data_size, model->static_lights_grid->GetData().size());
+		}
+
+		const std::pair<vk::UniqueBuffer*, vk::UniqueDeviceMemory*> buffers[]
+		{
+			{ &static_lights_buffer_, &static_lights_buffer_memory_ },
+			{ &static_lights_grid_buffer_, &static_lights_grid_buffer_memory_ },
+			{ &static_lights_shadowmaps_buffer_, &static_lights_shadowmaps_buffer_memory_ },
+		};
+		const size_t buffers_sizes[]
+		{
+			sizeof(LightBuffer::Light) * max_static_lights,
+			sizeof(StaticLightsGridBufferHeader) + sizeof(StaticLightsGrid::DataWord) * max_grid_data_size,
+			sizeof(uint32_t) * max_static_lights,
+		};
+
+		for(size_t b= 0u; b < std::size(buffers); ++b)
+		{
+			vk::UniqueBuffer& buffer= *buffers[b].first;
+			buffer=
+				vk_device_.createBufferUnique(
+					vk::BufferCreateInfo(
+						vk::BufferCreateFlags(),
+						buffers_sizes[b],
+						vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst));
+
+			const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*buffer);
+
+			vk::MemoryAllocateInfo vk_memory_allocate_info(buffer_memory_requirements.size);
+			for(uint32_t i= 0u; i < memory_properties_.memoryTypeCount; ++i)
+			{
+				if((buffer_memory_requirements.memoryTypeBits & (1u << i)) != 0 &&
+					(memory_properties_.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal) != vk::MemoryPropertyFlags())
+					vk_memory_allocate_info.memoryTypeIndex= i;
+			}
+
+			vk::UniqueDeviceMemory& memory= *buffers[b].second;
+			memory= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
+			vk_device_.bindBufferMemory(*buffer, *memory, 0u);
+		}
+	}
+
 	// Create descriptor set pool.
 	const vk::DescriptorPoolSize vk_descriptor_pool_sizes[]
 	{
@@ -233,7 +843,7 @@ WorldRenderer::WorldRenderer(
 		},
 		{
 			vk::DescriptorType::eStorageBuffer,
-			3u // global storage buffers
+			9u + 1u // global storage buffers + depth pre-pass boxes buffer
 		},
 		{
 			vk::DescriptorType::eCombinedImageSampler,
@@ -245,7 +855,7 @@ WorldRenderer::WorldRenderer(
 		vk_device_.createDescriptorPoolUnique(
 			vk::DescriptorPoolCreateInfo(
 				vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-				uint32_t(materials_.size()) + 1u, // max sets.
+				bindless_textures_ ? 3u : uint32_t(materials_.size()) + 2u, // max sets.
 				uint32_t(std::size(vk_descriptor_pool_sizes)), vk_descriptor_pool_sizes));
 
 	{ // Create globals descriptor set
@@ -265,12 +875,27 @@ WorldRenderer::WorldRenderer(
 		const vk::DescriptorBufferInfo descriptor_offset_buffer_info(
 			*cluster_offset_buffer_,
 			0u,
-			sizeof(uint32_t) * cluster_volume_builder_.GetWidth() * cluster_volume_builder_.GetHeight() * cluster_volume_builder_.GetDepth());
+			sizeof(ClusterVolumeBuilder::OffsetType) * cluster_volume_builder_.GetOffsets().size());
 
 		const vk::DescriptorBufferInfo lights_list_buffer_info(
 			*lights_list_buffer_,
 			0u,
-			sizeof(uint8_t) * lights_list_buffer_size_);
+			cluster_volume_builder_.GetElementSize() * lights_list_buffer_size_);
+
+		const vk::DescriptorBufferInfo tile_depth_bounds_buffer_info(
+			cluster_volume_builder_gpu_->GetTileDepthBoundsBuffer(),
+			0u,
+			cluster_volume_builder_gpu_->GetTileDepthBoundsBufferSize());
+
+		const vk::DescriptorBufferInfo z_bins_buffer_info(
+			*z_bins_buffer_,
+			0u,
+			VK_WHOLE_SIZE);
+
+		const vk::DescriptorBufferInfo static_lights_buffer_info(*static_lights_buffer_, 0u, VK_WHOLE_SIZE);
+		const vk::DescriptorBufferInfo static_lights_grid_buffer_info(*static_lights_grid_buffer_, 0u, VK_WHOLE_SIZE);
+		const vk::DescriptorBufferInfo static_lights_shadowmaps_buffer_info(*static_lights_shadowmaps_buffer_, 0u, VK_WHOLE_SIZE);
+		const vk::DescriptorBufferInfo vertex_pos_boxes_buffer_info(*vertex_pos_boxes_buffer_, 0u, VK_WHOLE_SIZE);
 
 		const vk::DescriptorImageInfo descriptor_ssao_image_info(
 			vk::Sampler(),
@@ -316,6 +941,16 @@ WorldRenderer::WorldRenderer(
 					&lights_list_buffer_info,
 					nullptr
 				},
+				{
+					*global_descriptors_set_,
+					WorldShaderBindings::tile_depth_bounds_buffer,
+					0u,
+					1u,
+					vk::DescriptorType::eStorageBuffer,
+					nullptr,
+					&tile_depth_bounds_buffer_info,
+					nullptr
+				},
 				{
 					*global_descriptors_set_,
 					WorldShaderBindings::ssao_image,
@@ -336,71 +971,197 @@ WorldRenderer::WorldRenderer(
 					nullptr,
 					nullptr
 				},
-			},
-			{});
-	}
-	for(auto& material_pair : materials_)
-	{
-		Material& material= material_pair.second;
-
-		// Create descriptor set.
-		material.descriptor_set=
-			std::move(
-			vk_device_.allocateDescriptorSetsUnique(
-				vk::DescriptorSetAllocateInfo(
-					*vk_descriptor_pool_,
-					1u, &*lighting_pass_pipeline_.descriptor_set_layouts[1])).front());
-
-		// Write descriptor set.
-		const vk::DescriptorImageInfo descriptor_albedo_tex_info(
-			vk::Sampler(),
-			*GetMaterialAlbedoImage(material).image_view,
-			vk::ImageLayout::eShaderReadOnlyOptimal);
-		const vk::DescriptorImageInfo descriptor_normals_tex_info(
-			vk::Sampler(),
-			*GetMaterialNormalsImage(material).image_view,
-			vk::ImageLayout::eShaderReadOnlyOptimal);
-		const vk::DescriptorImageInfo descriptor_occlusion_tex_info(
-			vk::Sampler(),
-			*GetMaterialOcclusionImage(material).image_view,
-			vk::ImageLayout::eShaderReadOnlyOptimal);
-
-		vk_device_.updateDescriptorSets(
-			{
 				{
-					*material.descriptor_set,
-					WorldShaderBindings::albedo_tex,
+					*global_descriptors_set_,
+					WorldShaderBindings::z_bins_buffer,
 					0u,
 					1u,
-					vk::DescriptorType::eCombinedImageSampler,
-					&descriptor_albedo_tex_info,
+					vk::DescriptorType::eStorageBuffer,
 					nullptr,
+					&z_bins_buffer_info,
 					nullptr
 				},
 				{
-					*material.descriptor_set,
-					WorldShaderBindings::normals_tex,
+					*global_descriptors_set_,
+					WorldShaderBindings::static_lights_buffer,
 					0u,
 					1u,
-					vk::DescriptorType::eCombinedImageSampler,
-					&descriptor_normals_tex_info,
+					vk::DescriptorType::eStorageBuffer,
 					nullptr,
+					&static_lights_buffer_info,
 					nullptr
 				},
 				{
-					*material.descriptor_set,
-					WorldShaderBindings::occlusion_tex,
+					*global_descriptors_set_,
+					WorldShaderBindings::static_lights_grid_buffer,
 					0u,
 					1u,
-					vk::DescriptorType::eCombinedImageSampler,
-					&descriptor_occlusion_tex_info,
+					vk::DescriptorType::eStorageBuffer,
+					nullptr,
+					&static_lights_grid_buffer_info,
+					nullptr
+				},
+				{
+					*global_descriptors_set_,
+					WorldShaderBindings::static_lights_shadowmaps_buffer,
+					0u,
+					1u,
+					vk::DescriptorType::eStorageBuffer,
+					nullptr,
+					&static_lights_shadowmaps_buffer_info,
+					nullptr
+				},
+				{
+					*global_descriptors_set_,
+					WorldShaderBindings::vertex_pos_boxes_buffer,
+					0u,
+					1u,
+					vk::DescriptorType::eStorageBuffer,
 					nullptr,
+					&vertex_pos_boxes_buffer_info,
 					nullptr
 				},
 			},
 			{});
 	}
-}
+	{ // Create depth pre-pass descriptor set.
+		depth_pre_pass_descriptor_set_=
+			std::move(
+			vk_device_.allocateDescriptorSetsUnique(
+				vk::DescriptorSetAllocateInfo(
+					*vk_descriptor_pool_,
+					1u, &*depth_pre_pass_pipeline_.descriptor_set_layouts[0])).front());
+
+		const vk::DescriptorBufferInfo vertex_pos_boxes_buffer_info(*vertex_pos_boxes_buffer_, 0u, VK_WHOLE_SIZE);
+		vk_device_.updateDescriptorSets(
+			{
+				{
+					*depth_pre_pass_descriptor_set_,
+					0u,
+					0u,
+					1u,
+					vk::DescriptorType::eStorageBuffer,
+					nullptr,
+					&vertex_pos_boxes_buffer_info,
+					nullptr
+				},
+			},
+			{});
+	}
+	if(bindless_textures_)
+	{
+		// Create single descriptor set for all materials.
+		bindless_textures_descriptor_set_=
+			std::move(
+			vk_device_.allocateDescriptorSetsUnique(
+				vk::DescriptorSetAllocateInfo(
+					*vk_descriptor_pool_,
+					1u, &*lighting_pass_pipeline_.descriptor_set_layouts[1])).front());
+
+		// Write descriptor set. Place textures in order of materials indices. Normals use separate sampler.
+		std::vector<vk::DescriptorImageInfo> textures_info(materials_.size() * 3u);
+		for(size_t i= 0u; i < materials_.size(); ++i)
+		{
+			const Material& material= materials_[i];
+			vk::DescriptorImageInfo* const material_textures_info= textures_info.data() + i * 3u;
+
+			material_textures_info[0]=
+				vk::DescriptorImageInfo(
+					*lighting_pass_pipeline_.samplers[2],
+					*images_[material.albedo_image].image_view,
+					vk::ImageLayout::eShaderReadOnlyOptimal);
+			material_textures_info[1]=
+				vk::DescriptorImageInfo(
+					*lighting_pass_pipeline_.samplers[3],
+					*images_[material.normals_image].image_view,
+					vk::ImageLayout::eShaderReadOnlyOptimal);
+			material_textures_info[2]=
+				vk::DescriptorImageInfo(
+					*lighting_pass_pipeline_.samplers[2],
+					*images_[material.occlusion_image].image_view,
+					vk::ImageLayout::eShaderReadOnlyOptimal);
+		}
+
+		if(!textures_info.empty())
+			vk_device_.updateDescriptorSets(
+				{
+					{
+						*bindless_textures_descriptor_set_,
+						WorldShaderBindings::material_textures,
+						0u,
+						uint32_t(textures_info.size()),
+						vk::DescriptorType::eCombinedImageSampler,
+						textures_info.data(),
+						nullptr,
+						nullptr
+					},
+				},
+				{});
+	}
+	else
+	{
+		for(Material& material : materials_)
+		{
+
+			// Create descriptor set.
+			material.descriptor_set=
+				std::move(
+				vk_device_.allocateDescriptorSetsUnique(
+					vk::DescriptorSetAllocateInfo(
+						*vk_descriptor_pool_,
+						1u, &*lighting_pass_pipeline_.descriptor_set_layouts[1])).front());
+
+			// Write descriptor set.
+			const vk::DescriptorImageInfo descriptor_albedo_tex_info(
+				vk::Sampler(),
+				*images_[material.albedo_image].image_view,
+				vk::ImageLayout::eShaderReadOnlyOptimal);
+			const vk::DescriptorImageInfo descriptor_normals_tex_info(
+				vk::Sampler(),
+				*images_[material.normals_image].image_view,
+				vk::ImageLayout::eShaderReadOnlyOptimal);
+			const vk::DescriptorImageInfo descriptor_occlusion_tex_info(
+				vk::Sampler(),
+				*images_[material.occlusion_image].image_view,
+				vk::ImageLayout::eShaderReadOnlyOptimal);
+
+			vk_device_.updateDescriptorSets(
+				{
+					{
+						*material.descriptor_set,
+						WorldShaderBindings::albedo_tex,
+						0u,
+						1u,
+						vk::DescriptorType::eCombinedImageSampler,
+						&descriptor_albedo_tex_info,
+						nullptr,
+						nullptr
+					},
+					{
+						*material.descriptor_set,
+						WorldShaderBindings::normals_tex,
+						0u,
+						1u,
+						vk::DescriptorType::eCombinedImageSampler,
+						&descriptor_normals_tex_info,
+						nullptr,
+						nullptr
+					},
+					{
+						*material.descriptor_set,
+						WorldShaderBindings::occlusion_tex,
+						0u,
+						1u,
+						vk::DescriptorType::eCombinedImageSampler,
+						&descriptor_occlusion_tex_info,
+						nullptr,
+						nullptr
+					},
+				},
+				{});
+		}
+	}
+}
 
 WorldRenderer::~WorldRenderer()
 {
@@ -410,45 +1171,62 @@ WorldRenderer::~WorldRenderer()
 
 void WorldRenderer::BeginFrame(const vk::CommandBuffer command_buffer)
 {
+	// 0 - build clusters on CPU, 1 - build clusters on GPU, 2 - build on GPU and compare result with CPU result.
+	const int64_t clusters_build_mode= std::max(int64_t(0), std::min(settings_.GetInt("r_clusters_gpu", 1), int64_t(2)));
+	settings_.SetInt("r_clusters_gpu", clusters_build_mode);
+
+	// Static lights grid mode - static lights are fetched from precalculated world-space grid, clusters are used only for dynamic lights.
+	const bool use_static_lights_grid= settings_.GetOrSetInt("r_lights_static_grid", 0) != 0;
+
+	// Z-binning mode - use depth bins and tiles masks instead of clusters.
+	const bool use_z_bins= settings_.GetOrSetInt("r_lights_z_binning", 0) != 0;
+
+	// Tiled mode - slices of each screen tile are placed between min and max depth of tile. Requires GPU build, comparison with CPU is not possible.
+	const bool clusters_tiled= settings_.GetOrSetInt("r_clusters_tiled", 0) != 0 && clusters_build_mode == 1 && !use_z_bins;
+
+	if(clusters_gpu_compare_pending_)
+	{
+		// Previous frame was built on both GPU and CPU. Wait for it and compare results.
+		clusters_gpu_compare_pending_= false;
+		vk_device_.waitIdle();
+
+		const size_t different_clusters= cluster_volume_builder_gpu_->CompareResults(cluster_volume_builder_);
+		if(different_clusters > 0u)
+			Log::Warning("GPU clusters differ from CPU clusters: ", different_clusters, " of ", cluster_volume_builder_.GetOffsets().size());
+	}
+
 	const bool use_test_world_model= settings_.GetInt("test_world_model", 0) != 0;
 	settings_.SetInt("test_world_model", use_test_world_model ? 1 : 0);
 
 	const CameraController::ViewMatrix view_matrix= camera_controller_.CalculateViewMatrix();
 	const m_Vec3 cam_pos= camera_controller_.GetCameraPosition();
+
+	const bool world_geometry_changed=
+		!use_test_world_model &&
+		world_model_.streaming != std::nullopt &&
+		UpdateWorldStreaming(command_buffer, world_model_, cam_pos);
+
 	const WorldModel& model= use_test_world_model ? test_world_model_ : world_model_;
 
-	// Calculate visible sectors.
-	const Sector* cam_sector= nullptr;
-	for(const Sector& sector : model.sectors)
-	{
-		if(cam_pos.x >= sector.bb_min.x && cam_pos.x <= sector.bb_max.x &&
-			cam_pos.y >= sector.bb_min.y && cam_pos.y <= sector.bb_max.y &&
-			cam_pos.z >= sector.bb_min.z && cam_pos.z <= sector.bb_max.z)
-		{
-			cam_sector= &sector;
-			break;
-		}
-	}
+	// GPU culling mode - triangle groups are culled in compute shader and drawn via indirect commands. Only sectors are processed on CPU.
+	// Triangle groups of streamed model are changed, so, it is not supported for it.
+	const bool gpu_culling= settings_.GetOrSetInt("r_gpu_culling", 0) != 0 && model.streaming == std::nullopt;
 
-	VisibleSectors visible_sectors;
-	for(const Sector& sector : model.sectors)
-	{
-		if(cam_sector != nullptr)
-		{
-			// Find adjacent sectors.
-			const bool intersects= !(
-				sector.bb_min.x > cam_sector->bb_max.x ||
-				sector.bb_min.y > cam_sector->bb_max.y ||
-				sector.bb_min.z > cam_sector->bb_max.z ||
-				sector.bb_max.x < cam_sector->bb_min.x ||
-				sector.bb_max.y < cam_sector->bb_min.y ||
-				sector.bb_max.z < cam_sector->bb_min.z );
-			if(!intersects)
-				continue;
-		}
+	// Without GPU culling occlusion culling is performed for groups of draw list, culled on CPU.
+	const bool occlusion_culling= settings_.GetOrSetInt("r_occlusion_culling", 0) != 0;
 
-		visible_sectors.push_back(size_t(&sector - model.sectors.data()));
-	}
+	// Max allowed error of level of detail relative to distance. Approximately angular size of error in radians.
+	// Same value is used for levels of detail selection on CPU and in GPU culling.
+	const float lod_max_error=
+		settings_.GetOrSetInt("r_lod", 1) != 0 ? float(settings_.GetOrSetReal("r_lod_max_error", 0.002)) : 0.0f;
+
+	VisibleSectors visible_sectors;
+	CalculateVisibleSectors(model, view_matrix, cam_pos, visible_sectors, sectors_clip_frustums_);
+	if(gpu_culling)
+		visible_triangle_groups_.clear();
+	else
+		CullTriangleGroups(model, view_matrix, visible_sectors, sectors_clip_frustums_, visible_triangle_groups_);
+	BuildDrawLists(visible_triangle_groups_, cam_pos, lod_max_error);
 
 	// Prepare light.
 	LightBuffer light_buffer;
@@ -456,125 +1234,349 @@ void WorldRenderer::BeginFrame(const vk::CommandBuffer command_buffer)
 	light_buffer.ambient_color[1]= 0.1f;
 	light_buffer.ambient_color[2]= 0.1f;
 	light_buffer.ambient_color[3]= 0.0f;
-	light_buffer.cluster_volume_size[0]= cluster_volume_builder_.GetWidth ();
-	light_buffer.cluster_volume_size[1]= cluster_volume_builder_.GetHeight();
-	light_buffer.cluster_volume_size[2]= cluster_volume_builder_.GetDepth ();
-	light_buffer.cluster_volume_size[3]= 0;
+	if(use_z_bins)
+	{
+		light_buffer.cluster_volume_size[0]= z_bins_builder_.GetTilesX();
+		light_buffer.cluster_volume_size[1]= z_bins_builder_.GetTilesY();
+		light_buffer.cluster_volume_size[2]= z_bins_builder_.GetBinCount();
+		light_buffer.cluster_volume_size[3]= 2;
+	}
+	else if(clusters_tiled)
+	{
+		light_buffer.cluster_volume_size[0]= ClusterVolumeBuilderGPU::c_tiles_volume_size[0];
+		light_buffer.cluster_volume_size[1]= ClusterVolumeBuilderGPU::c_tiles_volume_size[1];
+		light_buffer.cluster_volume_size[2]= ClusterVolumeBuilderGPU::c_tiles_volume_size[2];
+		light_buffer.cluster_volume_size[3]= 1;
+	}
+	else
+	{
+		light_buffer.cluster_volume_size[0]= cluster_volume_builder_.GetWidth ();
+		light_buffer.cluster_volume_size[1]= cluster_volume_builder_.GetHeight();
+		light_buffer.cluster_volume_size[2]= cluster_volume_builder_.GetDepth ();
+		light_buffer.cluster_volume_size[3]= 0;
+	}
 	light_buffer.viewport_size[0]= float(tonemapper_.GetFramebufferSize().width );
 	light_buffer.viewport_size[1]= float(tonemapper_.GetFramebufferSize().height);
 
-	cluster_volume_builder_.ClearClusters();
+	const bool clusters_refine= settings_.GetOrSetInt("r_clusters_refine", 1) != 0;
+
 	cluster_volume_builder_.SetMatrix(view_matrix.mat, view_matrix.z_near, view_matrix.z_far);
+	cluster_volume_builder_.SetRefinementEnabled(clusters_refine);
+	z_bins_builder_.SetMatrix(view_matrix.mat, view_matrix.z_near, view_matrix.z_far);
 
 	light_buffer.w_convert_values[0]= cluster_volume_builder_.GetWConvertValues().x;
 	light_buffer.w_convert_values[1]= cluster_volume_builder_.GetWConvertValues().y;
+	light_buffer.lights_options[0]= cluster_volume_builder_.GetListFormat() == ClusterVolumeBuilder::ListFormat::Id8 ? 0u : 1u;
+	light_buffer.lights_options[1]= use_static_lights_grid ? 1u : 0u;
+	light_buffer.lights_options[2]= 0u;
+	light_buffer.lights_options[3]= 0u;
+
+	if(!use_static_lights_grid)
+		static_lights_uploaded_model_= nullptr; // Shadowmap indices become outdated, so, upload all again after enabling.
+	else if(static_lights_uploaded_model_ != &model)
+	{
+		UploadStaticLights(command_buffer, model);
+		static_lights_uploaded_model_= &model;
+	}
 
-	uint32_t light_count= 0u;
-	std::vector<ShadowmapLight> shadowmap_lights;
-
+	// Collect lights, which may be visible. Static lights are not needed in grid mode.
+	light_candidates_.clear();
 	if(test_light_ != std::nullopt)
+		light_candidates_.push_back(&*test_light_);
+	if(!use_static_lights_grid)
+	{
+		for(const size_t sector_index : visible_sectors)
+		for(const Sector::Light& sector_light : model.sectors[sector_index].lights)
+			light_candidates_.push_back(&sector_light);
+	}
+
+	// Skip lights build if view, lights and build parameters are the same as in previous frame.
+	// Clusters, lights and shadowmaps, built previously, are still valid, so, GPU buffers are reused.
+	const uint32_t lights_build_flags=
+		uint32_t(clusters_build_mode) |
+		(use_z_bins ? 4u : 0u) |
+		(clusters_tiled ? 8u : 0u) |
+		(use_static_lights_grid ? 16u : 0u) |
+		(clusters_refine ? 32u : 0u);
+
+	bool lights_build_state_same=
+		settings_.GetOrSetInt("r_lights_skip_unchanged", 1) != 0 &&
+		!world_geometry_changed && // Shadowmaps must be redrawn.
+		clusters_build_mode != 2 && // Comparison requires new build each frame.
+		lights_build_state_.model == &model &&
+		lights_build_state_.flags == lights_build_flags &&
+		std::memcmp(&lights_build_state_.view_matrix, &view_matrix.mat, sizeof(m_Mat4)) == 0 &&
+		lights_build_state_.z_near == view_matrix.z_near &&
+		lights_build_state_.z_far == view_matrix.z_far &&
+		lights_build_state_.viewport_size[0] == light_buffer.viewport_size[0] &&
+		lights_build_state_.viewport_size[1] == light_buffer.viewport_size[1] &&
+		lights_build_state_.lights.size() == light_candidates_.size();
+	for(size_t i= 0u; i < light_candidates_.size() && lights_build_state_same; ++i)
+		lights_build_state_same= std::memcmp(&lights_build_state_.lights[i], light_candidates_[i], sizeof(Sector::Light)) == 0;
+
+	++lights_builds_total_;
+
+	uint32_t light_count= 0u;
+	ShadowmapAllocator::LightsForShadowUpdate lights_for_shadow_update;
+	if(lights_build_state_same)
+	{
+		++lights_builds_skipped_;
+		light_count= lights_build_state_.light_count;
+	}
+	else
 	{
-		const bool added=
-			cluster_volume_builder_.AddSphere(
-				test_light_->pos,
-				test_light_->radius,
-				ClusterVolumeBuilder::ElementId(light_count));
-		if(added)
+		lights_build_state_.model= &model;
+		lights_build_state_.flags= lights_build_flags;
+		lights_build_state_.view_matrix= view_matrix.mat;
+		lights_build_state_.z_near= view_matrix.z_near;
+		lights_build_state_.z_far= view_matrix.z_far;
+		lights_build_state_.viewport_size[0]= light_buffer.viewport_size[0];
+		lights_build_state_.viewport_size[1]= light_buffer.viewport_size[1];
+		lights_build_state_.lights.clear();
+		for(const Sector::Light* const light : light_candidates_)
+			lights_build_state_.lights.push_back(*light);
+
+		cluster_volume_builder_.ClearClusters();
+		z_bins_builder_.Clear();
+
+		std::vector<ShadowmapLight> shadowmap_lights;
+		const auto add_light_to_buffer=
+		[&](const Sector::Light& light)
 		{
 			LightBuffer::Light& out_light= light_buffer.lights[light_count];
-			out_light.pos[0]= test_light_->pos.x;
-			out_light.pos[1]= test_light_->pos.y;
-			out_light.pos[2]= test_light_->pos.z;
-			out_light.pos[3]= 1.0f / (test_light_->radius * test_light_->radius); // Fade to zero at radius.
-			out_light.color[0]= test_light_->color.x;
-			out_light.color[1]= test_light_->color.y;
-			out_light.color[2]= test_light_->color.z;
+			out_light.pos[0]= light.pos.x;
+			out_light.pos[1]= light.pos.y;
+			out_light.pos[2]= light.pos.z;
+			out_light.pos[3]= 1.0f / (light.radius * light.radius); // Fade to zero at radius.
+			out_light.color[0]= light.color.x;
+			out_light.color[1]= light.color.y;
+			out_light.color[2]= light.color.z;
 			out_light.color[3]= 0.0f;
-			out_light.data[0]= 1.0f / test_light_->radius;
-			out_light.data[1]= 0.0f;
+			out_light.data[0]= 1.0f / light.radius;
+			out_light.data[1]= light.radius;
 			out_light.shadowmap_index[0]= 0;
 			out_light.shadowmap_index[1]= 0;
 
 			ShadowmapLight shadowmap_light;
-			shadowmap_light.pos= test_light_->pos;
-			shadowmap_light.radius= test_light_->radius;
+			shadowmap_light.pos= light.pos;
+			shadowmap_light.radius= light.radius;
 			shadowmap_lights.push_back(shadowmap_light);
 
 			++light_count;
+		};
+
+		if(use_z_bins)
+		{
+			// Lights in buffer must be in order of depth.
+			z_bins_lights_.clear();
+			for(const Sector::Light* const light : light_candidates_)
+			{
+				if(z_bins_lights_.size() >= z_bins_builder_.GetMaxElements())
+					break;
+				if(z_bins_builder_.AddSphere(light->pos, light->radius))
+					z_bins_lights_.push_back(light);
+			}
+
+			z_bins_builder_.Build();
+			for(const ZBinsBuilder::ElementIndex index : z_bins_builder_.GetSortedElements())
+				add_light_to_buffer(*z_bins_lights_[index]);
 		}
-	}
+		else
+		{
+			const bool add_lights_batched= settings_.GetOrSetInt("r_clusters_batch_add", 1) != 0;
 
-	for(const size_t sector_index : visible_sectors)
-	for(const Sector::Light& sector_light : model.sectors[sector_index].lights)
-	{
-		if(light_count >= LightBuffer::c_max_lights)
-			goto end_fill_lights;
+			// Light id must fit into lights list element.
+			const size_t max_lights= std::min(LightBuffer::c_max_lights, cluster_volume_builder_.GetMaxElements());
 
-		const bool added=
-			cluster_volume_builder_.AddSphere(
-				sector_light.pos,
-				sector_light.radius,
-				ClusterVolumeBuilder::ElementId(light_count));
-		if(!added)
-			continue;
+			// Add lights by batches. Use only lights, which were really added into clusters.
+			for(size_t batch_start= 0u; batch_start < light_candidates_.size() && light_count < max_lights;)
+			{
+				// Batch size must not exceed free space in lights buffer.
+				const size_t batch_size=
+					std::min(
+						std::min(c_lights_batch_size, light_candidates_.size() - batch_start),
+						max_lights - light_count);
+
+				m_Vec3 centers[c_lights_batch_size];
+				float radii[c_lights_batch_size];
+				bool added[c_lights_batch_size];
+				for(size_t i= 0u; i < batch_size; ++i)
+				{
+					centers[i]= light_candidates_[batch_start + i]->pos;
+					radii[i]= light_candidates_[batch_start + i]->radius;
+				}
 
-		LightBuffer::Light& out_light= light_buffer.lights[light_count];
-		out_light.pos[0]= sector_light.pos.x;
-		out_light.pos[1]= sector_light.pos.y;
-		out_light.pos[2]= sector_light.pos.z;
-		out_light.pos[3]= 1.0f / (sector_light.radius * sector_light.radius); // Fade to zero at radius.
-		out_light.color[0]= sector_light.color.x;
-		out_light.color[1]= sector_light.color.y;
-		out_light.color[2]= sector_light.color.z;
-		out_light.color[3]= 0.0f;
-		out_light.data[0]= 1.0f / sector_light.radius;
-		out_light.data[1]= 0.0f;
-		out_light.shadowmap_index[0]= 0;
-		out_light.shadowmap_index[1]= 0;
+				if(add_lights_batched)
+					cluster_volume_builder_.AddSpheres(centers, radii, batch_size, ClusterVolumeBuilder::ElementId(light_count), added);
+				else
+				{
+					// Add lights one by one. Result must be identical to batched adding.
+					for(size_t i= 0u, added_count= 0u; i < batch_size; ++i)
+					{
+						added[i]= cluster_volume_builder_.AddSphere(centers[i], radii[i], ClusterVolumeBuilder::ElementId(light_count + added_count));
+						added_count+= added[i] ? 1u : 0u;
+					}
+				}
 
-		ShadowmapLight shadowmap_light;
-		shadowmap_light.pos= sector_light.pos;
-		shadowmap_light.radius= sector_light.radius;
-		shadowmap_lights.push_back(shadowmap_light);
+				for(size_t i= 0u; i < batch_size; ++i)
+				{
+					if(added[i])
+						add_light_to_buffer(*light_candidates_[batch_start + i]);
+				}
 
-		++light_count;
-	}
-	end_fill_lights:
+				batch_start+= batch_size;
+			}
+		}
 
-	KK_ASSERT(light_count == shadowmap_lights.size());
+		KK_ASSERT(light_count == shadowmap_lights.size());
 
-	// Allocate shadowmaps.
-	const ShadowmapAllocator::LightsForShadowUpdate lights_for_shadow_update=
-		shadowmap_allocator_.UpdateLights(shadowmap_lights, cam_pos);
-	for(uint32_t i= 0u; i < light_count; ++i)
-	{
-		const auto slot= shadowmap_allocator_.GetLightShadowmapSlot(shadowmap_lights[i]);
-		light_buffer.lights[i].shadowmap_index[0]= slot.first;
-		light_buffer.lights[i].shadowmap_index[1]= slot.second;
-	}
+		// In grid mode static lights of visible sectors are not in lights buffer, but they still need shadowmaps.
+		const bool static_lights_sectors_changed= use_static_lights_grid && static_lights_shadowmap_sectors_ != visible_sectors;
+		if(static_lights_sectors_changed)
+		{
+			// Lights of sectors, which are no longer visible, lose shadowmaps.
+			for(const size_t sector_index : static_lights_shadowmap_sectors_)
+			{
+				const Sector& sector= model.sectors[sector_index];
+				for(size_t i= 0u; i < sector.lights.size(); ++i)
+					SetStaticLightShadowmapIndex(sector.first_light_index + i, c_static_light_invisible_sector);
+			}
 
-	const auto& clusters= cluster_volume_builder_.GetClusters();
-	std::vector<ClusterVolumeBuilder::ElementId> ligts_list_buffer;
-	std::vector<uint32_t> offsets_buffer(clusters.size());
-	for(size_t i= 0u; i < clusters.size(); ++i)
-	{
-		offsets_buffer[i]= uint32_t(ligts_list_buffer.size());
-		ligts_list_buffer.push_back(ClusterVolumeBuilder::ElementId(clusters[i].elements.size()));
-		ligts_list_buffer.insert(
-			ligts_list_buffer.end(),
-			clusters[i].elements.begin(), clusters[i].elements.end());
-	}
+			static_lights_shadowmap_sectors_= visible_sectors;
+			static_lights_for_shadowmaps_.clear();
+			for(const size_t sector_index : visible_sectors)
+			for(const Sector::Light& sector_light : model.sectors[sector_index].lights)
+			{
+				ShadowmapLight shadowmap_light;
+				shadowmap_light.pos= sector_light.pos;
+				shadowmap_light.radius= sector_light.radius;
+				static_lights_for_shadowmaps_.push_back(shadowmap_light);
+			}
+		}
+		if(use_static_lights_grid)
+			shadowmap_lights.insert(shadowmap_lights.end(), static_lights_for_shadowmaps_.begin(), static_lights_for_shadowmaps_.end());
 
-	// Vulkan requires multiple of 4 sizes.
-	ligts_list_buffer.resize((ligts_list_buffer.size() + 3u) & ~3u);
+		// Allocate shadowmaps.
+		lights_for_shadow_update= shadowmap_allocator_.UpdateLights(shadowmap_lights, cam_pos);
 
-	command_buffer.updateBuffer(
-		*vk_light_data_buffer_,
-		0u,
-		offsetof(LightBuffer, lights) + sizeof(LightBuffer::Light) * light_count, // Update only visible lights.
-		&light_buffer);
-	command_buffer.updateBuffer(*cluster_offset_buffer_, 0u, uint32_t(offsets_buffer.size() * sizeof(uint32_t)), offsets_buffer.data());
-	command_buffer.updateBuffer(*lights_list_buffer_, 0u, uint32_t(ligts_list_buffer.size() * sizeof(ClusterVolumeBuilder::ElementId)), ligts_list_buffer.data());
+		// Existing shadowmaps may be drawn without geometry of uploaded pages or with geometry of evicted pages.
+		// Redraw only shadowmaps of lights, which spheres intersect bounds of these pages.
+		if(world_geometry_changed)
+		{
+			for(const ShadowmapLight& light : shadowmap_lights)
+			{
+				if(std::find(lights_for_shadow_update.begin(), lights_for_shadow_update.end(), light) != lights_for_shadow_update.end())
+					continue;
+
+				for(const auto& page_bounds : world_model_.streaming->changed_pages_bounds)
+				{
+					if(GetBoxSquareDistance(light.pos, page_bounds.first, page_bounds.second) < light.radius * light.radius)
+					{
+						lights_for_shadow_update.push_back(light);
+						break;
+					}
+				}
+			}
+		}
+
+		for(uint32_t i= 0u; i < light_count; ++i)
+		{
+			const auto slot= shadowmap_allocator_.GetLightShadowmapSlot(shadowmap_lights[i]);
+			light_buffer.lights[i].shadowmap_index[0]= slot.first;
+			light_buffer.lights[i].shadowmap_index[1]= slot.second;
+		}
+
+		// Update shadowmap indices of static lights of visible sectors only if their lights or slots are changed. Lights of invisible sectors have no shadowmaps.
+		if(static_lights_sectors_changed || (use_static_lights_grid && shadowmap_allocator_.SlotsChanged()))
+		{
+			size_t shadowmap_light_index= light_count;
+			for(const size_t sector_index : visible_sectors)
+			{
+				const Sector& sector= model.sectors[sector_index];
+				for(size_t i= 0u; i < sector.lights.size(); ++i, ++shadowmap_light_index)
+					SetStaticLightShadowmapIndex(
+						sector.first_light_index + i,
+						PackShadowmapSlot(shadowmap_allocator_.GetLightShadowmapSlot(shadowmap_lights[shadowmap_light_index])));
+			}
+		}
+		if(use_static_lights_grid)
+			UploadStaticLightsShadowmapIndices(command_buffer);
+
+		if(!use_z_bins && clusters_build_mode != 1)
+		{
+			const int64_t thread_count= std::max(int64_t(1), std::min(settings_.GetInt("r_clusters_build_threads", 1), int64_t(32)));
+			settings_.SetInt("r_clusters_build_threads", thread_count);
+			cluster_volume_builder_.SetThreadCount(size_t(thread_count));
+			cluster_volume_builder_.BuildLists();
+		}
+
+		command_buffer.updateBuffer(
+			*vk_light_data_buffer_,
+			0u,
+			offsetof(LightBuffer, lights) + sizeof(LightBuffer::Light) * light_count, // Update only visible lights.
+			&light_buffer);
+
+		if(use_z_bins)
+		{
+			ZBinsBufferHeader header;
+			header.size[0]= z_bins_builder_.GetTilesX();
+			header.size[1]= z_bins_builder_.GetTilesY();
+			header.size[2]= uint32_t(z_bins_builder_.GetWordsPerTile());
+			header.size[3]= z_bins_builder_.GetBinCount();
+			header.w_convert_values[0]= z_bins_builder_.GetWConvertValues().x;
+			header.w_convert_values[1]= z_bins_builder_.GetWConvertValues().y;
+			header.padding[0]= header.padding[1]= 0.0f;
+
+			const size_t bins_size= sizeof(ZBinsBuilder::BinType) * z_bins_builder_.GetBinCount();
+			command_buffer.updateBuffer(*z_bins_buffer_, 0u, sizeof(ZBinsBufferHeader), &header);
+			command_buffer.updateBuffer(*z_bins_buffer_, sizeof(ZBinsBufferHeader), bins_size, z_bins_builder_.GetBins().data());
+
+			// Update only used words of masks.
+			const size_t masks_size=
+				sizeof(ZBinsBuilder::MaskWord) * z_bins_builder_.GetTilesX() * z_bins_builder_.GetTilesY() * z_bins_builder_.GetWordsPerTile();
+			const auto masks_data= reinterpret_cast<const uint8_t*>(z_bins_builder_.GetTileMasks());
+			for(size_t offset= 0u; offset < masks_size; offset+= c_max_update_buffer_size)
+				command_buffer.updateBuffer(
+					*z_bins_buffer_,
+					sizeof(ZBinsBufferHeader) + bins_size + offset,
+					std::min(c_max_update_buffer_size, masks_size - offset),
+					masks_data + offset);
+		}
+		else if(clusters_build_mode == 0)
+		{
+			command_buffer.updateBuffer(
+				*cluster_offset_buffer_,
+				0u,
+				cluster_volume_builder_.GetOffsets().size() * sizeof(ClusterVolumeBuilder::OffsetType),
+				cluster_volume_builder_.GetOffsets().data());
+			// Lists may be bigger, than "updateBuffer" limit, so, update them by parts.
+			const size_t lights_list_size= cluster_volume_builder_.GetElementsListSize() * cluster_volume_builder_.GetElementSize();
+			const auto lights_list_data= static_cast<const uint8_t*>(cluster_volume_builder_.GetElementsList());
+			for(size_t offset= 0u; offset < lights_list_size; offset+= c_max_update_buffer_size)
+				command_buffer.updateBuffer(
+					*lights_list_buffer_,
+					offset,
+					std::min(c_max_update_buffer_size, lights_list_size - offset),
+					lights_list_data + offset);
+		}
+		else if(!clusters_tiled)
+		{
+			// CPU builder is still used for lights culling, only lists are built on GPU.
+			cluster_volume_builder_gpu_->Build(
+				command_buffer,
+				view_matrix.mat,
+				light_count,
+				clusters_refine);
+
+			if(clusters_build_mode == 2)
+			{
+				cluster_volume_builder_gpu_->ReadBackResults(command_buffer);
+				clusters_gpu_compare_pending_= true;
+			}
+		}
+
+		lights_build_state_.light_count= light_count;
+	}
 
 	// Add barrier for preventing of drawing commands start before all calls to "updateBuffer" finished.
 	// TODO - optimize, use buffer memory barrier.
@@ -598,85 +1600,424 @@ void WorldRenderer::BeginFrame(const vk::CommandBuffer command_buffer)
 			slot,
 			light.pos,
 			light.radius,
+			model.vertex_pos_step,
+			model.first_vertex_pos_box,
 			[&]{ DrawWorldModelToDepthCubemap(command_buffer, model, light.pos, light.radius); } );
 	}
 
+	// Cull triangle groups on GPU. Pass to GPU clip frustums of visible sectors.
+	// Depth pre-pass is culled, using depth of previous frame, main pass - using depth of current frame.
+	if(gpu_culling || occlusion_culling)
+	{
+		if(triangle_groups_culler_model_ != &model)
+		{
+			triangle_groups_culler_model_= &model;
+			triangle_groups_culler_has_all_groups_= false;
+			triangle_groups_culler_->Invalidate();
+		}
+
+		// Planes of invisible sectors reject everything, planes of visible sectors without frustum culling accept everything.
+		TriangleGroupsCullerGPU::SectorDescription invisible_sector{};
+		for(float (&plane)[4] : invisible_sector.planes)
+			plane[3]= -1.0f;
+
+		TriangleGroupsCullerGPU::SectorDescription visible_sector{};
+		for(float (&plane)[4] : visible_sector.planes)
+			plane[3]= 1.0f;
+
+		gpu_culling_sectors_.clear();
+		if(gpu_culling)
+		{
+			if(!triangle_groups_culler_has_all_groups_)
+			{
+				triangle_groups_culler_has_all_groups_= true;
+				triangle_groups_culler_->SetTriangleGroups(command_buffer, model.gpu_triangle_groups.data(), model.gpu_triangle_groups.size());
+			}
+
+			const bool frustum_culling= settings_.GetOrSetInt("r_frustum_culling", 1) != 0;
+
+			gpu_culling_sectors_.resize(model.sectors.size(), invisible_sector);
+			for(const size_t sector_index : visible_sectors)
+			{
+				TriangleGroupsCullerGPU::SectorDescription& out_sector= gpu_culling_sectors_[sector_index];
+				out_sector= visible_sector;
+				if(!frustum_culling)
+					continue;
+
+				const ClipFrustum& clip_frustum= sectors_clip_frustums_[sector_index];
+				for(size_t i= 0u; i < std::size(clip_frustum.planes); ++i)
+				{
+					out_sector.planes[i][0]= clip_frustum.planes[i].normal.x;
+					out_sector.planes[i][1]= clip_frustum.planes[i].normal.y;
+					out_sector.planes[i][2]= clip_frustum.planes[i].normal.z;
+					out_sector.planes[i][3]= clip_frustum.planes[i].dist;
+				}
+			}
+		}
+		else
+		{
+			// Groups of draw list are already culled on CPU. Upload them in order of main pass draw list with selected levels of detail.
+			// All of them use single sector, accepting everything.
+			draw_list_culler_triangle_groups_.clear();
+			draw_list_material_triangle_groups_.clear();
+			for(const DrawListElement& element : main_pass_draw_list_)
+			{
+				const Sector::TriangleGroup& triangle_group= *element.triangle_group;
+
+				if(draw_list_material_triangle_groups_.empty() ||
+					draw_list_material_triangle_groups_.back().material_index != triangle_group.material_index)
+					draw_list_material_triangle_groups_.push_back(
+						MaterialTriangleGroups{ triangle_group.material_index, uint32_t(draw_list_culler_triangle_groups_.size()), 0u });
+				++draw_list_material_triangle_groups_.back().triangle_group_count;
+
+				TriangleGroupsCullerGPU::TriangleGroupDescription out_triangle_group{};
+				out_triangle_group.bb_min[0]= triangle_group.bb_min.x;
+				out_triangle_group.bb_min[1]= triangle_group.bb_min.y;
+				out_triangle_group.bb_min[2]= triangle_group.bb_min.z;
+				out_triangle_group.bb_max[0]= triangle_group.bb_max.x;
+				out_triangle_group.bb_max[1]= triangle_group.bb_max.y;
+				out_triangle_group.bb_max[2]= triangle_group.bb_max.z;
+				out_triangle_group.index_count= element.index_count;
+				out_triangle_group.first_index= element.first_index;
+				out_triangle_group.vertex_offset= int32_t(triangle_group.first_vertex);
+				out_triangle_group.sector_index= 0u;
+				out_triangle_group.instance_count= triangle_group.instance_count;
+				if(instanced_segments_)
+					out_triangle_group.first_instance= triangle_group.first_instance;
+				else if(draw_indirect_first_instance_supported_)
+					out_triangle_group.first_instance= triangle_group.material_index;
+				draw_list_culler_triangle_groups_.push_back(out_triangle_group);
+			}
+
+			triangle_groups_culler_has_all_groups_= false;
+			triangle_groups_culler_->SetTriangleGroups(command_buffer, draw_list_culler_triangle_groups_.data(), draw_list_culler_triangle_groups_.size());
+
+			gpu_culling_sectors_.push_back(visible_sector);
+		}
+
+		triangle_groups_culler_->SetSectors(command_buffer, gpu_culling_sectors_.data(), gpu_culling_sectors_.size());
+		// Levels of detail of draw list groups are already selected.
+		triangle_groups_culler_->SetLodParams(cam_pos, gpu_culling ? lod_max_error : 0.0f);
+		triangle_groups_culler_->CullPrePass(command_buffer, occlusion_culling);
+	}
+	else
+		triangle_groups_culler_->Invalidate();
+
+	const TriangleGroupsCullerGPU* const triangle_groups_culler= (gpu_culling || occlusion_culling) ? &*triangle_groups_culler_ : nullptr;
+
 	// Draw
 	tonemapper_.DeDepthPrePass(
 		command_buffer,
-		[&]{ DrawWorldModelDepthPrePass(command_buffer, model, visible_sectors, view_matrix.mat); });
+		[&]{ DrawWorldModelDepthPrePass(command_buffer, model, depth_pre_pass_draw_list_, view_matrix.mat, triangle_groups_culler, gpu_culling); });
+
+	if(occlusion_culling)
+		triangle_groups_culler_->CullMainPass(command_buffer, view_matrix.mat);
+
+	if(clusters_tiled)
+		cluster_volume_builder_gpu_->BuildTiled(command_buffer, view_matrix, light_count);
 
 	ambient_occlusion_culculator_.DoPass(command_buffer, view_matrix);
 
 	tonemapper_.DoMainPass(
 		command_buffer,
-		[&]{ DrawWorldModelMainPass(command_buffer, model, visible_sectors, view_matrix.mat); });
-}
-
-void WorldRenderer::EndFrame(const vk::CommandBuffer command_buffer)
-{
-	tonemapper_.EndFrame(command_buffer);
+		[&]{ DrawWorldModelMainPass(command_buffer, model, main_pass_draw_list_, view_matrix.mat, triangle_groups_culler, gpu_culling, occlusion_culling); });
 }
 
-WorldRenderer::Pipeline WorldRenderer::CreateDepthPrePassPipeline()
+void WorldRenderer::CalculateVisibleSectors(
+	const WorldModel& world_model,
+	const CameraController::ViewMatrix& view_matrix,
+	const m_Vec3& cam_pos,
+	VisibleSectors& out_visible_sectors,
+	SectorsClipFrustums& out_clip_frustums)
 {
-	Pipeline pipeline;
+	const size_t sector_count= world_model.sectors.size();
 
-	pipeline.shader_vert= CreateShader(vk_device_, ShaderNames::world_depth_only_vert);
+	std::vector<ClipRect> sectors_rects(sector_count, ClipRect{ 0.0f, 0.0f, 0.0f, 0.0f });
+	std::vector<bool> sectors_visible(sector_count, false);
+	std::vector<size_t> sectors_to_process;
 
-	const vk::PushConstantRange vk_push_constant_range(
-		vk::ShaderStageFlagBits::eVertex,
-		0u,
-		sizeof(Uniforms));
+	// Start from all sectors, containing camera. Camera may be at border between sectors.
+	// Sectors bounds in grid include sectors boxes, so, check box of each found sector.
+	world_model.sectors_grid->FindBoxesContainingPoint(cam_pos, sectors_query_result_);
+	for(const SpatialGrid::BoxIndex i : sectors_query_result_)
+	{
+		const Sector& sector= world_model.sectors[i];
+		if(cam_pos.x >= sector.bb_min.x && cam_pos.x <= sector.bb_max.x &&
+			cam_pos.y >= sector.bb_min.y && cam_pos.y <= sector.bb_max.y &&
+			cam_pos.z >= sector.bb_min.z && cam_pos.z <= sector.bb_max.z)
+		{
+			sectors_visible[i]= true;
+			sectors_rects[i]= c_full_clip_rect;
+			sectors_to_process.push_back(i);
+		}
+	}
 
-	pipeline.pipeline_layout=
-		vk_device_.createPipelineLayoutUnique(
-			vk::PipelineLayoutCreateInfo(
-				vk::PipelineLayoutCreateFlags(),
-				0u, nullptr,
-				1u, &vk_push_constant_range));
+	if(sectors_to_process.empty())
+	{
+		// Camera is outside any sector - draw all sectors.
+		for(size_t i= 0u; i < sector_count; ++i)
+		{
+			sectors_visible[i]= true;
+			sectors_rects[i]= c_full_clip_rect;
+		}
+	}
 
-	// Create pipeline.
-	const vk::PipelineShaderStageCreateInfo vk_shader_stage_create_info[]
+	// Portals, which are closer than this distance, may be clipped by near plane, but still visible.
+	const float near_plane_half_width = view_matrix.z_near / view_matrix.m0;
+	const float near_plane_half_height= view_matrix.z_near / view_matrix.m5;
+	const float near_portal_distance=
+		std::sqrt(
+			view_matrix.z_near * view_matrix.z_near +
+			near_plane_half_width * near_plane_half_width +
+			near_plane_half_height * near_plane_half_height);
+
+	// Process sectors until clip rects stop growing. Rect of sector is union of rects of all portals, leading to it.
+	const size_t max_iterations= sector_count * c_max_portals_traversal_iterations_per_sector;
+	for(size_t iteration= 0u; !sectors_to_process.empty() && iteration < max_iterations; ++iteration)
 	{
+		const size_t sector_index= sectors_to_process.back();
+		sectors_to_process.pop_back();
+		const ClipRect sector_rect= sectors_rects[sector_index];
+
+		for(const size_t portal_index : world_model.sectors[sector_index].portals)
 		{
-			vk::PipelineShaderStageCreateFlags(),
-			vk::ShaderStageFlagBits::eVertex,
-			*pipeline.shader_vert,
-			"main"
-		},
-	};
+			const Portal& portal= world_model.portals[portal_index];
 
-	const vk::VertexInputBindingDescription vk_vertex_input_binding_description(
-		0u,
-		sizeof(WorldVertex),
-		vk::VertexInputRate::eVertex);
+			const float dx= std::max(0.0f, std::max(portal.bb_min.x - cam_pos.x, cam_pos.x - portal.bb_max.x));
+			const float dy= std::max(0.0f, std::max(portal.bb_min.y - cam_pos.y, cam_pos.y - portal.bb_max.y));
+			const float dz= std::max(0.0f, std::max(portal.bb_min.z - cam_pos.z, cam_pos.z - portal.bb_max.z));
 
-	const vk::VertexInputAttributeDescription vk_vertex_input_attribute_description[]
-	{
-		{0u, 0u, vk::Format::eR32G32B32Sfloat, offsetof(WorldVertex, pos)},
-	};
+			ClipRect portal_rect;
+			if(dx * dx + dy * dy + dz * dz <= near_portal_distance * near_portal_distance)
+				portal_rect= sector_rect; // Camera is almost inside portal.
+			else
+			{
+				if(!CalculatePolygonClipRect(portal.vertices, std::size(portal.vertices), view_matrix.mat, view_matrix.z_near, portal_rect))
+					continue;
+				portal_rect= IntersectClipRects(sector_rect, portal_rect);
+				if(IsClipRectEmpty(portal_rect))
+					continue;
+			}
 
-	const vk::PipelineVertexInputStateCreateInfo vk_pipiline_vertex_input_state_create_info(
-		vk::PipelineVertexInputStateCreateFlags(),
-		1u, &vk_vertex_input_binding_description,
-		uint32_t(std::size(vk_vertex_input_attribute_description)), vk_vertex_input_attribute_description);
+			for(const size_t next_sector_index : portal.sectors)
+			{
+				if(next_sector_index == sector_index)
+					continue;
 
-	const vk::PipelineInputAssemblyStateCreateInfo vk_pipeline_input_assembly_state_create_info(
-		vk::PipelineInputAssemblyStateCreateFlags(),
-		vk::PrimitiveTopology::eTriangleList);
+				if(!sectors_visible[next_sector_index])
+				{
+					sectors_visible[next_sector_index]= true;
+					sectors_rects[next_sector_index]= portal_rect;
+				}
+				else if(!IsClipRectInside(portal_rect, sectors_rects[next_sector_index]))
+					sectors_rects[next_sector_index]= UniteClipRects(sectors_rects[next_sector_index], portal_rect);
+				else
+					continue;
 
-	const vk::Extent2D framebuffer_size= tonemapper_.GetFramebufferSize();
-	const vk::Viewport vk_viewport(0.0f, 0.0f, float(framebuffer_size.width), float(framebuffer_size.height), 0.0f, 1.0f);
-	const vk::Rect2D vk_scissor(vk::Offset2D(0, 0), framebuffer_size);
+				sectors_to_process.push_back(next_sector_index);
+			}
+		}
+	}
 
-	const vk::PipelineViewportStateCreateInfo vk_pipieline_viewport_state_create_info(
-		vk::PipelineViewportStateCreateFlags(),
-		1u, &vk_viewport,
-		1u, &vk_scissor);
+	out_visible_sectors.clear();
+	out_clip_frustums.resize(sector_count);
+	for(size_t i= 0u; i < sector_count; ++i)
+	{
+		if(!sectors_visible[i])
+			continue;
 
-	const vk::PipelineRasterizationStateCreateInfo vk_pipilane_rasterization_state_create_info(
-		vk::PipelineRasterizationStateCreateFlags(),
+		out_visible_sectors.push_back(i);
+		MakeClipFrustumPlanes(view_matrix.mat, view_matrix.z_near, sectors_rects[i], out_clip_frustums[i].planes);
+	}
+}
+
+void WorldRenderer::CullTriangleGroups(
+	const WorldModel& world_model,
+	const CameraController::ViewMatrix& view_matrix,
+	const VisibleSectors& visible_sectors,
+	const SectorsClipFrustums& clip_frustums,
+	VisibleTriangleGroups& out_triangle_groups)
+{
+	out_triangle_groups.clear();
+	frustum_culled_sectors_= 0u;
+	frustum_culled_triangle_groups_= 0u;
+	frustum_tested_triangle_groups_= 0u;
+
+	if(settings_.GetOrSetInt("r_frustum_culling", 1) == 0)
+	{
+		for(const size_t sector_index : visible_sectors)
+		for(const Sector::TriangleGroup& triangle_group : world_model.sectors[sector_index].triangle_groups)
+			out_triangle_groups.push_back(&triangle_group);
+		return;
+	}
+
+	m_Plane3 view_frustum_planes[5];
+	MakeClipFrustumPlanes(view_matrix.mat, view_matrix.z_near, c_full_clip_rect, view_frustum_planes);
+
+	// Test all sectors against view frustum. Use SoA layout of bounds and no branches in inner loop, in order to vectorize it.
+	const SectorsBounds& bounds= world_model.sectors_bounds;
+	const size_t sector_count= bounds.min_x.size();
+	sectors_in_frustum_.assign(sector_count, 1u);
+	uint8_t* const in_frustum= sectors_in_frustum_.data();
+	for(const m_Plane3& plane : view_frustum_planes)
+	{
+		const float* const xs= (plane.normal.x >= 0.0f ? bounds.max_x : bounds.min_x).data();
+		const float* const ys= (plane.normal.y >= 0.0f ? bounds.max_y : bounds.min_y).data();
+		const float* const zs= (plane.normal.z >= 0.0f ? bounds.max_z : bounds.min_z).data();
+		const float nx= plane.normal.x;
+		const float ny= plane.normal.y;
+		const float nz= plane.normal.z;
+		const float dist= plane.dist;
+		for(size_t i= 0u; i < sector_count; ++i)
+			in_frustum[i]&= uint8_t(xs[i] * nx + ys[i] * ny + zs[i] * nz + dist >= 0.0f);
+	}
+
+	// Test triangle groups of remaining sectors against clip frustum of sector, which is part of view frustum, visible through portals.
+	for(const size_t sector_index : visible_sectors)
+	{
+		const Sector& sector= world_model.sectors[sector_index];
+		if(in_frustum[sector_index] == 0u)
+		{
+			++frustum_culled_sectors_;
+			frustum_culled_triangle_groups_+= sector.triangle_groups.size();
+			continue;
+		}
+
+		const ClipFrustum& clip_frustum= clip_frustums[sector_index];
+		for(const Sector::TriangleGroup& triangle_group : sector.triangle_groups)
+		{
+			++frustum_tested_triangle_groups_;
+			if(IsBoxInsideFrustum(triangle_group.bb_min, triangle_group.bb_max, clip_frustum.planes, std::size(clip_frustum.planes)))
+				out_triangle_groups.push_back(&triangle_group);
+			else
+				++frustum_culled_triangle_groups_;
+		}
+	}
+}
+
+void WorldRenderer::BuildDrawLists(
+	const VisibleTriangleGroups& visible_triangle_groups,
+	const m_Vec3& cam_pos,
+	const float lod_max_error)
+{
+	depth_pre_pass_draw_list_.clear();
+	main_pass_draw_list_.clear();
+
+	for(const Sector::TriangleGroup* const triangle_group : visible_triangle_groups)
+	{
+		const float square_distance= GetBoxSquareDistance(cam_pos, triangle_group->bb_min, triangle_group->bb_max);
+		const uint64_t distance_key= DistanceToSortKey(square_distance);
+		const uint64_t material_key= uint64_t(triangle_group->material_index);
+
+		// Select most simplified level of detail with error, small enough for this distance.
+		uint32_t first_index= triangle_group->first_index;
+		uint32_t index_count= triangle_group->index_count;
+		const float max_error= std::sqrt(square_distance) * lod_max_error;
+		for(uint32_t i= 0u; i < triangle_group->lod_count && triangle_group->lods[i].error <= max_error; ++i)
+		{
+			first_index= triangle_group->lods[i].first_index;
+			index_count= triangle_group->lods[i].index_count;
+		}
+
+		depth_pre_pass_draw_list_.push_back(DrawListElement{ (distance_key << 32u) | material_key, triangle_group, first_index, index_count });
+		main_pass_draw_list_.push_back(DrawListElement{ (material_key << 32u) | distance_key, triangle_group, first_index, index_count });
+	}
+
+	const auto comp=
+	[](const DrawListElement& l, const DrawListElement& r)
+	{
+		return l.sort_key < r.sort_key;
+	};
+	std::sort(depth_pre_pass_draw_list_.begin(), depth_pre_pass_draw_list_.end(), comp);
+	std::sort(main_pass_draw_list_.begin(), main_pass_draw_list_.end(), comp);
+}
+
+void WorldRenderer::EndFrame(const vk::CommandBuffer command_buffer)
+{
+	tonemapper_.EndFrame(command_buffer);
+}
+
+WorldRenderer::Pipeline WorldRenderer::CreateDepthPrePassPipeline()
+{
+	Pipeline pipeline;
+
+	pipeline.shader_vert= CreateShader(vk_device_, instanced_segments_ ? ShaderNames::world_depth_only_instanced_vert : ShaderNames::world_depth_only_vert);
+
+	// Only quantization boxes buffer is needed.
+	const vk::DescriptorSetLayoutBinding descriptor_set_layout_bindings[]
+	{
+		{
+			0u,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eVertex,
+			nullptr,
+		},
+	};
+	pipeline.descriptor_set_layouts[0]=
+		vk_device_.createDescriptorSetLayoutUnique(
+			vk::DescriptorSetLayoutCreateInfo(
+				vk::DescriptorSetLayoutCreateFlags(),
+				uint32_t(std::size(descriptor_set_layout_bindings)), descriptor_set_layout_bindings));
+
+	const vk::PushConstantRange vk_push_constant_range(
+		vk::ShaderStageFlagBits::eVertex,
+		0u,
+		sizeof(Uniforms));
+
+	pipeline.pipeline_layout=
+		vk_device_.createPipelineLayoutUnique(
+			vk::PipelineLayoutCreateInfo(
+				vk::PipelineLayoutCreateFlags(),
+				1u, &*pipeline.descriptor_set_layouts[0],
+				1u, &vk_push_constant_range));
+
+	// Create pipeline.
+	const vk::PipelineShaderStageCreateInfo vk_shader_stage_create_info[]
+	{
+		{
+			vk::PipelineShaderStageCreateFlags(),
+			vk::ShaderStageFlagBits::eVertex,
+			*pipeline.shader_vert,
+			"main"
+		},
+	};
+
+	// Read only positions stream (and instances for instanced segments).
+	const vk::VertexInputBindingDescription vk_vertex_input_binding_descriptions[]
+	{
+		{ 0u, sizeof(WorldVertexPos), vk::VertexInputRate::eVertex },
+		{ 1u, sizeof(WorldInstance), vk::VertexInputRate::eInstance },
+	};
+
+	const vk::VertexInputAttributeDescription vk_vertex_input_attribute_description[]
+	{
+		{0u, 0u, c_world_vertex_pos_format, offsetof(WorldVertexPos, pos)},
+		{1u, 1u, vk::Format::eR32G32B32A32Sfloat, offsetof(WorldInstance, pos_transform[0])},
+		{2u, 1u, vk::Format::eR32G32B32A32Sfloat, offsetof(WorldInstance, pos_transform[1])},
+		{3u, 1u, vk::Format::eR32G32B32A32Sfloat, offsetof(WorldInstance, pos_transform[2])},
+	};
+
+	const vk::PipelineVertexInputStateCreateInfo vk_pipiline_vertex_input_state_create_info(
+		vk::PipelineVertexInputStateCreateFlags(),
+		instanced_segments_ ? 2u : 1u, vk_vertex_input_binding_descriptions,
+		instanced_segments_ ? 4u : 1u, vk_vertex_input_attribute_description);
+
+	const vk::PipelineInputAssemblyStateCreateInfo vk_pipeline_input_assembly_state_create_info(
+		vk::PipelineInputAssemblyStateCreateFlags(),
+		vk::PrimitiveTopology::eTriangleList);
+
+	const vk::Extent2D framebuffer_size= tonemapper_.GetFramebufferSize();
+	const vk::Viewport vk_viewport(0.0f, 0.0f, float(framebuffer_size.width), float(framebuffer_size.height), 0.0f, 1.0f);
+	const vk::Rect2D vk_scissor(vk::Offset2D(0, 0), framebuffer_size);
+
+	const vk::PipelineViewportStateCreateInfo vk_pipieline_viewport_state_create_info(
+		vk::PipelineViewportStateCreateFlags(),
+		1u, &vk_viewport,
+		1u, &vk_scissor);
+
+	const vk::PipelineRasterizationStateCreateInfo vk_pipilane_rasterization_state_create_info(
+		vk::PipelineRasterizationStateCreateFlags(),
 		VK_FALSE,
 		VK_FALSE,
 		vk::PolygonMode::eFill,
@@ -741,8 +2082,13 @@ WorldRenderer::Pipeline WorldRenderer::CreateLightingPassPipeline()
 	Pipeline pipeline;
 
 	// Create shaders
-	pipeline.shader_vert= CreateShader(vk_device_, ShaderNames::world_vert);
-	pipeline.shader_frag= CreateShader(vk_device_, ShaderNames::world_frag);
+	pipeline.shader_vert=
+		CreateShader(
+			vk_device_,
+			instanced_segments_
+				? ShaderNames::world_instanced_vert
+				: (bindless_textures_ ? ShaderNames::world_bindless_vert : ShaderNames::world_vert));
+	pipeline.shader_frag= CreateShader(vk_device_, bindless_textures_ ? ShaderNames::world_bindless_frag : ShaderNames::world_frag);
 
 	// Create image samplers
 
@@ -858,6 +2204,13 @@ WorldRenderer::Pipeline WorldRenderer::CreateLightingPassPipeline()
 			vk::ShaderStageFlagBits::eFragment,
 			nullptr,
 		},
+		{
+			WorldShaderBindings::tile_depth_bounds_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eFragment,
+			nullptr,
+		},
 		{
 			WorldShaderBindings::ssao_image,
 			vk::DescriptorType::eCombinedImageSampler,
@@ -872,6 +2225,41 @@ WorldRenderer::Pipeline WorldRenderer::CreateLightingPassPipeline()
 			vk::ShaderStageFlagBits::eFragment,
 			depth_cubemap_image_samplers.data(),
 		},
+		{
+			WorldShaderBindings::z_bins_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eFragment,
+			nullptr,
+		},
+		{
+			WorldShaderBindings::static_lights_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eFragment,
+			nullptr,
+		},
+		{
+			WorldShaderBindings::static_lights_grid_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eFragment,
+			nullptr,
+		},
+		{
+			WorldShaderBindings::static_lights_shadowmaps_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eFragment,
+			nullptr,
+		},
+		{
+			WorldShaderBindings::vertex_pos_boxes_buffer,
+			vk::DescriptorType::eStorageBuffer,
+			1u,
+			vk::ShaderStageFlagBits::eVertex,
+			nullptr,
+		},
 	};
 
 	const vk::DescriptorSetLayoutBinding descriptor_set_layout_bindings_per_material[]
@@ -905,11 +2293,28 @@ WorldRenderer::Pipeline WorldRenderer::CreateLightingPassPipeline()
 				vk::DescriptorSetLayoutCreateFlags(),
 				uint32_t(std::size(descriptor_set_layout_bindings_global)), descriptor_set_layout_bindings_global));
 
-	pipeline.descriptor_set_layouts[1]=
-		vk_device_.createDescriptorSetLayoutUnique(
-			vk::DescriptorSetLayoutCreateInfo(
-				vk::DescriptorSetLayoutCreateFlags(),
-				uint32_t(std::size(descriptor_set_layout_bindings_per_material)), descriptor_set_layout_bindings_per_material));
+	// Samplers are not immutable here, because albedo and normals use different samplers.
+	const vk::DescriptorSetLayoutBinding descriptor_set_layout_binding_bindless
+	{
+		WorldShaderBindings::material_textures,
+		vk::DescriptorType::eCombinedImageSampler,
+		uint32_t(materials_.size() * 3u),
+		vk::ShaderStageFlagBits::eFragment,
+		nullptr,
+	};
+
+	if(bindless_textures_)
+		pipeline.descriptor_set_layouts[1]=
+			vk_device_.createDescriptorSetLayoutUnique(
+				vk::DescriptorSetLayoutCreateInfo(
+					vk::DescriptorSetLayoutCreateFlags(),
+					1u, &descriptor_set_layout_binding_bindless));
+	else
+		pipeline.descriptor_set_layouts[1]=
+			vk_device_.createDescriptorSetLayoutUnique(
+				vk::DescriptorSetLayoutCreateInfo(
+					vk::DescriptorSetLayoutCreateFlags(),
+					uint32_t(std::size(descriptor_set_layout_bindings_per_material)), descriptor_set_layout_bindings_per_material));
 
 	const vk::DescriptorSetLayout descriptor_set_layouts[]{ *pipeline.descriptor_set_layouts[0], *pipeline.descriptor_set_layouts[1] };
 
@@ -942,24 +2347,29 @@ WorldRenderer::Pipeline WorldRenderer::CreateLightingPassPipeline()
 		},
 	};
 
-	const vk::VertexInputBindingDescription vk_vertex_input_binding_description(
-		0u,
-		sizeof(WorldVertex),
-		vk::VertexInputRate::eVertex);
+	// Read positions and attributes streams (and instances for instanced segments).
+	const vk::VertexInputBindingDescription vk_vertex_input_binding_descriptions[]
+	{
+		{ 0u, sizeof(WorldVertexPos), vk::VertexInputRate::eVertex },
+		{ 1u, sizeof(WorldVertexAttributes), vk::VertexInputRate::eVertex },
+		{ 2u, sizeof(WorldInstance), vk::VertexInputRate::eInstance },
+	};
 
 	const vk::VertexInputAttributeDescription vk_vertex_input_attribute_description[]
 	{
-		{0u, 0u, vk::Format::eR32G32B32Sfloat, offsetof(WorldVertex, pos)},
-		{1u, 0u, vk::Format::eR32G32B32Sfloat, offsetof(WorldVertex, tex_coord)},
-		{2u, 0u, vk::Format::eR8G8B8A8Snorm, offsetof(WorldVertex, normal)},
-		{3u, 0u, vk::Format::eR8G8B8A8Snorm, offsetof(WorldVertex, binormal)},
-		{4u, 0u, vk::Format::eR8G8B8A8Snorm, offsetof(WorldVertex, tangent)},
+		{0u, 0u, c_world_vertex_pos_format, offsetof(WorldVertexPos, pos)}, // Position and binormal sign.
+		{1u, 1u, vk::Format::eR16G16Sscaled, offsetof(WorldVertexAttributes, tex_coord)},
+		{2u, 1u, vk::Format::eR8G8B8A8Snorm, offsetof(WorldVertexAttributes, normal)}, // Normal and tangent.
+		{3u, 2u, vk::Format::eR32G32B32A32Sfloat, offsetof(WorldInstance, pos_transform[0])},
+		{4u, 2u, vk::Format::eR32G32B32A32Sfloat, offsetof(WorldInstance, pos_transform[1])},
+		{5u, 2u, vk::Format::eR32G32B32A32Sfloat, offsetof(WorldInstance, pos_transform[2])},
+		{6u, 2u, vk::Format::eR32G32B32A32Sfloat, offsetof(WorldInstance, normal_transform)},
 	};
 
 	const vk::PipelineVertexInputStateCreateInfo vk_pipiline_vertex_input_state_create_info(
 		vk::PipelineVertexInputStateCreateFlags(),
-		1u, &vk_vertex_input_binding_description,
-		uint32_t(std::size(vk_vertex_input_attribute_description)), vk_vertex_input_attribute_description);
+		instanced_segments_ ? 3u : 2u, vk_vertex_input_binding_descriptions,
+		instanced_segments_ ? 7u : 3u, vk_vertex_input_attribute_description);
 
 	const vk::PipelineInputAssemblyStateCreateInfo vk_pipeline_input_assembly_state_create_info(
 		vk::PipelineInputAssemblyStateCreateFlags(),
@@ -1032,19 +2442,56 @@ WorldRenderer::Pipeline WorldRenderer::CreateLightingPassPipeline()
 				tonemapper_.GetMainRenderPass(),
 				0u));
 
+	// Create pipeline for objects, culled in depth pre-pass, but visible in main pass.
+	const vk::PipelineDepthStencilStateCreateInfo vk_pipeline_depth_write_state_create_info(
+		vk::PipelineDepthStencilStateCreateFlags(),
+		VK_TRUE,
+		VK_TRUE,
+		vk::CompareOp::eLessOrEqual,
+		VK_FALSE,
+		VK_FALSE,
+		vk::StencilOpState(),
+		vk::StencilOpState(),
+		0.0f,
+		1.0f);
+
+	pipeline.pipeline_depth_write=
+		vk_device_.createGraphicsPipelineUnique(
+			nullptr,
+			vk::GraphicsPipelineCreateInfo(
+				vk::PipelineCreateFlags(),
+				uint32_t(std::size(vk_shader_stage_create_info)),
+				vk_shader_stage_create_info,
+				&vk_pipiline_vertex_input_state_create_info,
+				&vk_pipeline_input_assembly_state_create_info,
+				nullptr,
+				&vk_pipieline_viewport_state_create_info,
+				&vk_pipilane_rasterization_state_create_info,
+				&vk_pipeline_multisample_state_create_info,
+				&vk_pipeline_depth_write_state_create_info,
+				&vk_pipeline_color_blend_state_create_info,
+				nullptr,
+				*pipeline.pipeline_layout,
+				tonemapper_.GetMainRenderPass(),
+				0u));
+
 	return pipeline;
 }
 
 void WorldRenderer::DrawWorldModelDepthPrePass(
 	const vk::CommandBuffer command_buffer,
 	const WorldModel& world_model,
-	const VisibleSectors& visible_setors,
-	const m_Mat4& view_matrix)
+	const DrawList& draw_list,
+	const m_Mat4& view_matrix,
+	const TriangleGroupsCullerGPU* const triangle_groups_culler,
+	const bool gpu_culling)
 {
 	command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *depth_pre_pass_pipeline_.pipeline);
 
 	Uniforms uniforms;
 	uniforms.view_matrix= view_matrix;
+	uniforms.vertex_pos_step= world_model.vertex_pos_step;
+	uniforms.vertex_pos_first_box= world_model.first_vertex_pos_box;
 	command_buffer.pushConstants(
 		*depth_pre_pass_pipeline_.pipeline_layout,
 		vk::ShaderStageFlagBits::eVertex,
@@ -1052,25 +2499,54 @@ void WorldRenderer::DrawWorldModelDepthPrePass(
 		sizeof(uniforms),
 		&uniforms);
 
-	const vk::DeviceSize offsets= 0u;
-	command_buffer.bindVertexBuffers(0u, 1u, &*world_model.vertex_buffer, &offsets);
-	command_buffer.bindIndexBuffer(*world_model.index_buffer, 0u, vk::IndexType::eUint16);
+	command_buffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eGraphics,
+		*depth_pre_pass_pipeline_.pipeline_layout,
+		0u,
+		1u, &*depth_pre_pass_descriptor_set_,
+		0u, nullptr);
+
+	const vk::Buffer vertex_buffers[]{ *world_model.vertex_pos_buffer, *world_model.instance_buffer };
+	const vk::DeviceSize offsets[]{ 0u, 0u };
+	command_buffer.bindVertexBuffers(0u, instanced_segments_ ? 2u : 1u, vertex_buffers, offsets);
+	command_buffer.bindIndexBuffer(*world_model.index_buffer, 0u, world_model.index_type);
+
+	if(triangle_groups_culler != nullptr)
+	{
+		// Material is not needed here, so, draw all groups at once.
+		// Commands for draw list are placed in main pass order, so, front-to-back order is lost here.
+		DrawIndexedIndirect(
+			command_buffer,
+			triangle_groups_culler->GetCommandsBuffer(),
+			triangle_groups_culler->GetCommandOffset(TriangleGroupsCullerGPU::CommandsList::PrePass, 0u),
+			gpu_culling ? world_model.gpu_triangle_groups.size() : draw_list.size());
+		return;
+	}
 
-	for(const size_t sector_index : visible_setors)
-	for(const Sector::TriangleGroup& triangle_group : world_model.sectors[sector_index].triangle_groups)
-		command_buffer.drawIndexed(triangle_group.index_count, 1u, triangle_group.first_index, triangle_group.first_vertex, 0u);
+	for(const DrawListElement& element : draw_list)
+	{
+		const Sector::TriangleGroup& triangle_group= *element.triangle_group;
+		command_buffer.drawIndexed(element.index_count, triangle_group.instance_count, element.first_index, triangle_group.first_vertex, triangle_group.first_instance);
+	}
 }
 
 void WorldRenderer::DrawWorldModelMainPass(
 	const vk::CommandBuffer command_buffer,
 	const WorldModel& world_model,
-	const VisibleSectors& visible_setors,
-	const m_Mat4& view_matrix)
+	const DrawList& draw_list,
+	const m_Mat4& view_matrix,
+	const TriangleGroupsCullerGPU* const triangle_groups_culler,
+	const bool gpu_culling,
+	const bool occlusion_culling)
 {
+	main_pass_material_binds_= 0u;
+
 	command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *lighting_pass_pipeline_.pipeline);
 
 	Uniforms uniforms;
 	uniforms.view_matrix= view_matrix;
+	uniforms.vertex_pos_step= world_model.vertex_pos_step;
+	uniforms.vertex_pos_first_box= world_model.first_vertex_pos_box;
 	command_buffer.pushConstants(
 		*lighting_pass_pipeline_.pipeline_layout,
 		vk::ShaderStageFlagBits::eVertex,
@@ -1085,14 +2561,113 @@ void WorldRenderer::DrawWorldModelMainPass(
 		1u, &*global_descriptors_set_,
 		0u, nullptr);
 
-	const vk::DeviceSize offsets= 0u;
-	command_buffer.bindVertexBuffers(0u, 1u, &*world_model.vertex_buffer, &offsets);
-	command_buffer.bindIndexBuffer(*world_model.index_buffer, 0u, vk::IndexType::eUint16);
+	const vk::Buffer vertex_buffers[]{ *world_model.vertex_pos_buffer, *world_model.vertex_attributes_buffer, *world_model.instance_buffer };
+	const vk::DeviceSize offsets[]{ 0u, 0u, 0u };
+	command_buffer.bindVertexBuffers(0u, instanced_segments_ ? 3u : 2u, vertex_buffers, offsets);
+	command_buffer.bindIndexBuffer(*world_model.index_buffer, 0u, world_model.index_type);
+
+	if(bindless_textures_)
+	{
+		command_buffer.bindDescriptorSets(
+			vk::PipelineBindPoint::eGraphics,
+			*lighting_pass_pipeline_.pipeline_layout,
+			1u,
+			1u, &*bindless_textures_descriptor_set_,
+			0u, nullptr);
+		++main_pass_material_binds_;
+
+		if(triangle_groups_culler == nullptr)
+		{
+			for(const DrawListElement& element : draw_list)
+			{
+				const Sector::TriangleGroup& triangle_group= *element.triangle_group;
+				command_buffer.drawIndexed(element.index_count, 1u, element.first_index, triangle_group.first_vertex, triangle_group.material_index);
+			}
+			return;
+		}
+
+		// Material index is stored in commands, so, draw all groups at once.
+		const size_t command_count= gpu_culling ? world_model.gpu_triangle_groups.size() : draw_list.size();
+		DrawIndexedIndirect(
+			command_buffer,
+			triangle_groups_culler->GetCommandsBuffer(),
+			triangle_groups_culler->GetCommandOffset(
+				occlusion_culling ? TriangleGroupsCullerGPU::CommandsList::MainPass : TriangleGroupsCullerGPU::CommandsList::PrePass,
+				0u),
+			command_count);
+
+		if(occlusion_culling)
+		{
+			command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *lighting_pass_pipeline_.pipeline_depth_write);
+			DrawIndexedIndirect(
+				command_buffer,
+				triangle_groups_culler->GetCommandsBuffer(),
+				triangle_groups_culler->GetCommandOffset(TriangleGroupsCullerGPU::CommandsList::LatePass, 0u),
+				command_count);
+		}
+		return;
+	}
+
+	if(triangle_groups_culler == nullptr)
+	{
+		// List is sorted by material, so, bind material only for first group of each material.
+		// Draws are not merged - sector has single group for each material and indices of each group are relative to own first vertex,
+		// so, consecutive groups of same material never share vertex offset and contiguous indices range.
+		MaterialIndex current_material_index= std::numeric_limits<MaterialIndex>::max();
+		for(const DrawListElement& element : draw_list)
+		{
+			const Sector::TriangleGroup& triangle_group= *element.triangle_group;
+			if(triangle_group.material_index != current_material_index)
+			{
+				current_material_index= triangle_group.material_index;
+				command_buffer.bindDescriptorSets(
+					vk::PipelineBindPoint::eGraphics,
+					*lighting_pass_pipeline_.pipeline_layout,
+					1u,
+					1u, &*materials_[current_material_index].descriptor_set,
+					0u, nullptr);
+				++main_pass_material_binds_;
+			}
+
+			command_buffer.drawIndexed(element.index_count, triangle_group.instance_count, element.first_index, triangle_group.first_vertex, triangle_group.first_instance);
+		}
+		return;
+	}
+
+	// Draw groups of each material via single call.
+	// Without occlusion culling commands of depth pre-pass are used.
+	const TriangleGroupsCullerGPU::CommandsList commands_list=
+		occlusion_culling ? TriangleGroupsCullerGPU::CommandsList::MainPass : TriangleGroupsCullerGPU::CommandsList::PrePass;
+	const std::vector<MaterialTriangleGroups>& materials_triangle_groups=
+		gpu_culling ? world_model.material_triangle_groups : draw_list_material_triangle_groups_;
+	for(const MaterialTriangleGroups& material_triangle_groups : materials_triangle_groups)
+	{
+		const Material& material= materials_[material_triangle_groups.material_index];
+
+		command_buffer.bindDescriptorSets(
+			vk::PipelineBindPoint::eGraphics,
+			*lighting_pass_pipeline_.pipeline_layout,
+			1u,
+			1u, &*material.descriptor_set,
+			0u, nullptr);
+		++main_pass_material_binds_;
 
-	for(const size_t sector_index : visible_setors)
-	for(const Sector::TriangleGroup& triangle_group : world_model.sectors[sector_index].triangle_groups)
+		DrawIndexedIndirect(
+			command_buffer,
+			triangle_groups_culler->GetCommandsBuffer(),
+			triangle_groups_culler->GetCommandOffset(commands_list, material_triangle_groups.first_triangle_group),
+			material_triangle_groups.triangle_group_count);
+	}
+
+	if(!occlusion_culling)
+		return;
+
+	// Draw groups, visible now, but missing in depth pre-pass. They are drawn with depth write, in order to preserve correct order.
+	command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *lighting_pass_pipeline_.pipeline_depth_write);
+
+	for(const MaterialTriangleGroups& material_triangle_groups : materials_triangle_groups)
 	{
-		const Material& material= materials_.find(triangle_group.material_id)->second;
+		const Material& material= materials_[material_triangle_groups.material_index];
 
 		command_buffer.bindDescriptorSets(
 			vk::PipelineBindPoint::eGraphics,
@@ -1100,52 +2675,760 @@ void WorldRenderer::DrawWorldModelMainPass(
 			1u,
 			1u, &*material.descriptor_set,
 			0u, nullptr);
+		++main_pass_material_binds_;
+
+		DrawIndexedIndirect(
+			command_buffer,
+			triangle_groups_culler->GetCommandsBuffer(),
+			triangle_groups_culler->GetCommandOffset(TriangleGroupsCullerGPU::CommandsList::LatePass, material_triangle_groups.first_triangle_group),
+			material_triangle_groups.triangle_group_count);
+	}
+}
+
+void WorldRenderer::DrawWorldModelToDepthCubemap(
+	const vk::CommandBuffer command_buffer,
+	const WorldModel& world_model,
+	const m_Vec3& light_pos,
+	const float light_radius)
+{
+	const vk::Buffer vertex_buffers[]{ *world_model.vertex_pos_buffer, *world_model.instance_buffer };
+	const vk::DeviceSize offsets[]{ 0u, 0u };
+	command_buffer.bindVertexBuffers(0u, instanced_segments_ ? 2u : 1u, vertex_buffers, offsets);
+	command_buffer.bindIndexBuffer(*world_model.index_buffer, 0u, world_model.index_type);
+
+	// Sort sectors front-to-back relative to light.
+	world_model.sectors_grid->FindBoxesIntersectingSphere(light_pos, light_radius, sectors_query_result_);
+	shadow_sectors_sort_keys_.clear();
+	for(const SpatialGrid::BoxIndex sector_index : sectors_query_result_)
+	{
+		const Sector& sector= world_model.sectors[sector_index];
+		shadow_sectors_sort_keys_.push_back((DistanceToSortKey(GetBoxSquareDistance(light_pos, sector.bb_min, sector.bb_max)) << 32u) | uint64_t(sector_index));
+	}
+	std::sort(shadow_sectors_sort_keys_.begin(), shadow_sectors_sort_keys_.end());
+
+	// Shadows allow bigger errors, than main view.
+	const float lod_max_error=
+		settings_.GetOrSetInt("r_lod", 1) != 0
+			? float(settings_.GetOrSetReal("r_lod_max_error", 0.002) * settings_.GetOrSetReal("r_lod_shadow_bias", 4.0))
+			: 0.0f;
+
+	// Draw all triangle groups of each sector via single call. Select level of detail by distance from light to sector.
+	for(const uint64_t sort_key : shadow_sectors_sort_keys_)
+	{
+		const Sector& sector= world_model.sectors[size_t(sort_key & 0xFFFFFFFFu)];
+
+		const float max_error= std::sqrt(GetBoxSquareDistance(light_pos, sector.bb_min, sector.bb_max)) * lod_max_error;
+		size_t lod= 0u;
+		while(lod < std::size(c_lod_cell_sizes) && c_lod_cell_sizes[lod] <= max_error)
+			++lod;
+
+		DrawIndexedIndirect(
+			command_buffer,
+			*world_model.draw_commands_buffer,
+			sizeof(vk::DrawIndexedIndirectCommand) * (sector.first_draw_command + lod * sector.triangle_groups.size()),
+			sector.triangle_groups.size());
+	}
+}
+
+void WorldRenderer::DrawIndexedIndirect(
+	const vk::CommandBuffer command_buffer,
+	const vk::Buffer buffer,
+	const vk::DeviceSize offset,
+	const size_t command_count)
+{
+	if(command_count == 0u)
+		return;
+
+	const uint32_t stride= uint32_t(sizeof(vk::DrawIndexedIndirectCommand));
+	if(multi_draw_indirect_supported_)
+		command_buffer.drawIndexedIndirect(buffer, offset, uint32_t(command_count), stride);
+	else
+	{
+		for(size_t i= 0u; i < command_count; ++i)
+			command_buffer.drawIndexedIndirect(buffer, offset + vk::DeviceSize(i * stride), 1u, stride);
+	}
+}
+
+bool WorldRenderer::UpdateWorldStreaming(const vk::CommandBuffer command_buffer, WorldModel& world_model, const m_Vec3& cam_pos)
+{
+	WorldStreaming& streaming= *world_model.streaming;
+	++streaming.frame_number;
+	streaming.changed_pages_bounds.clear();
+
+	const uint32_t load_distance= uint32_t(std::max(int64_t(0), std::min(settings_.GetOrSetInt("r_world_streaming_load_distance", 4), int64_t(1024))));
+	const uint32_t unload_distance=
+		std::max(load_distance + 1u, uint32_t(std::max(int64_t(0), std::min(settings_.GetOrSetInt("r_world_streaming_unload_distance", 8), int64_t(1024)))));
+
+	// Slots of evicted pages are free now, if frames, which used them, are finished.
+	for(size_t i= 0u; i < streaming.released_slots.size();)
+	{
+		if(streaming.released_slots[i].second + c_streaming_slot_reuse_delay_frames <= streaming.frame_number)
+		{
+			streaming.free_slots.push_back(streaming.released_slots[i].first);
+			streaming.released_slots[i]= streaming.released_slots.back();
+			streaming.released_slots.pop_back();
+		}
+		else
+			++i;
+	}
+
+	// Start from all sectors, containing camera. If camera is outside any sector, start from nearest sector.
+	streaming.sectors_queue.clear();
+	world_model.sectors_grid->FindBoxesContainingPoint(cam_pos, sectors_query_result_);
+	for(const SpatialGrid::BoxIndex i : sectors_query_result_)
+	{
+		const Sector& sector= world_model.sectors[i];
+		if(cam_pos.x >= sector.bb_min.x && cam_pos.x <= sector.bb_max.x &&
+			cam_pos.y >= sector.bb_min.y && cam_pos.y <= sector.bb_max.y &&
+			cam_pos.z >= sector.bb_min.z && cam_pos.z <= sector.bb_max.z)
+			streaming.sectors_queue.push_back(i);
+	}
+	if(streaming.sectors_queue.empty() && !world_model.sectors.empty())
+	{
+		size_t nearest_sector_index= 0u;
+		float nearest_square_distance= std::numeric_limits<float>::max();
+		for(size_t i= 0u; i < world_model.sectors.size(); ++i)
+		{
+			const Sector& sector= world_model.sectors[i];
+			const float square_distance= GetBoxSquareDistance(cam_pos, sector.bb_min, sector.bb_max);
+			if(square_distance < nearest_square_distance)
+			{
+				nearest_square_distance= square_distance;
+				nearest_sector_index= i;
+			}
+		}
+		streaming.sectors_queue.push_back(nearest_sector_index);
+	}
+
+	// Calculate distances in portals via breadth-first search. Sectors farther, than unload distance, are not needed.
+	std::fill(streaming.sectors_distances.begin(), streaming.sectors_distances.end(), c_streaming_infinite_distance);
+	for(const size_t sector_index : streaming.sectors_queue)
+		streaming.sectors_distances[sector_index]= 0u;
+	for(size_t i= 0u; i < streaming.sectors_queue.size(); ++i)
+	{
+		const size_t sector_index= streaming.sectors_queue[i];
+		const uint32_t next_distance= streaming.sectors_distances[sector_index] + 1u;
+		if(next_distance > unload_distance)
+			continue;
+
+		for(const size_t portal_index : world_model.sectors[sector_index].portals)
+		for(const size_t next_sector_index : world_model.portals[portal_index].sectors)
+		{
+			if(streaming.sectors_distances[next_sector_index] <= next_distance)
+				continue;
+			streaming.sectors_distances[next_sector_index]= next_distance;
+			streaming.sectors_queue.push_back(next_sector_index);
+		}
+	}
+
+	for(StreamingPage& page : streaming.pages)
+		page.distance= c_streaming_infinite_distance;
+	for(const size_t sector_index : streaming.sectors_queue)
+	{
+		StreamingPage& page= streaming.pages[streaming.sectors_pages[sector_index]];
+		page.distance= std::min(page.distance, streaming.sectors_distances[sector_index]);
+	}
+
+	bool geometry_changed= false;
+
+	// Evict far pages. Building of far pages is cancelled - background thread finishes it, but result is discarded.
+	for(StreamingPage& page : streaming.pages)
+	{
+		if(page.distance <= unload_distance)
+			continue;
+
+		page.build_result= nullptr;
+		if(page.slot != std::nullopt)
+		{
+			EvictStreamingPage(world_model, page);
+			geometry_changed= true;
+		}
+	}
+
+	const auto distance_comp=
+	[&](const uint32_t l, const uint32_t r)
+	{
+		return streaming.pages[l].distance < streaming.pages[r].distance;
+	};
+
+	// Upload built pages, closer pages first.
+	streaming.pages_queue.clear();
+	for(size_t i= 0u; i < streaming.pages.size(); ++i)
+	{
+		const StreamingPage& page= streaming.pages[i];
+		if(page.build_result != nullptr && page.build_result->ready)
+			streaming.pages_queue.push_back(uint32_t(i));
+	}
+	std::sort(streaming.pages_queue.begin(), streaming.pages_queue.end(), distance_comp);
+
+	size_t uploads= 0u;
+	for(const uint32_t page_index : streaming.pages_queue)
+	{
+		if(uploads == c_streaming_max_uploads_per_frame)
+			break;
+
+		StreamingPage& page= streaming.pages[page_index];
+		if(streaming.free_slots.empty())
+		{
+			// Evict farthest page, if it is farther, than this page. Its slot will be available after some frames.
+			StreamingPage* farthest_page= nullptr;
+			for(StreamingPage& other_page : streaming.pages)
+			{
+				if(other_page.slot != std::nullopt && other_page.distance > page.distance &&
+					(farthest_page == nullptr || other_page.distance > farthest_page->distance))
+					farthest_page= &other_page;
+			}
+			if(farthest_page != nullptr)
+			{
+				EvictStreamingPage(world_model, *farthest_page);
+				geometry_changed= true;
+			}
+			break;
+		}
+
+		const uint32_t slot= streaming.free_slots.back();
+		streaming.free_slots.pop_back();
+		UploadStreamingPage(world_model, page, slot);
+		geometry_changed= true;
+		++uploads;
+	}
+
+	if(uploads > 0u)
+	{
+		// Copy commands are submitted before commands of this frame. Wait for them before reading of geometry.
+		gpu_data_uploader_.Flush();
+		command_buffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput,
+			vk::DependencyFlagBits(),
+			{
+				{
+					vk::AccessFlagBits::eTransferWrite,
+					vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eVertexAttributeRead
+				}
+			},
+			{},
+			{});
+	}
+
+	// Start building of pages near camera, closer pages first.
+	// Limit number of pages in queue in order to react faster on camera movement.
+	size_t pages_building= 0u;
+	streaming.pages_queue.clear();
+	for(size_t i= 0u; i < streaming.pages.size(); ++i)
+	{
+		const StreamingPage& page= streaming.pages[i];
+		if(page.build_result != nullptr)
+		{
+			if(!page.build_result->ready)
+				++pages_building;
+		}
+		else if(page.slot == std::nullopt && page.distance <= load_distance)
+			streaming.pages_queue.push_back(uint32_t(i));
+	}
+	std::sort(streaming.pages_queue.begin(), streaming.pages_queue.end(), distance_comp);
+
+	const size_t max_pages_building= streaming_task_queue_->GetThreadCount() * 2u;
+	for(const uint32_t page_index : streaming.pages_queue)
+	{
+		if(pages_building >= max_pages_building)
+			break;
+
+		StreamingPage& page= streaming.pages[page_index];
+		page.build_result= std::make_shared<StreamingPageBuildResult>();
+		++pages_building;
+
+		// Pages, sources and models are not changed after loading and live longer, than tasks queue.
+		streaming_task_queue_->Push(
+			[
+				result= page.build_result,
+				&page_sectors= page.sectors,
+				&world_sectors= streaming.world_sectors,
+				&segment_models= segment_models_,
+				&pos_boxes= world_model.vertex_pos_boxes,
+				pos_box_sectors_log2= world_model.vertex_pos_box_sectors_log2,
+				pos_step= world_model.vertex_pos_step
+			]
+			{
+				SectorsGeometry& geometry= result->geometry;
+				for(const size_t sector_index : page_sectors)
+				{
+					const size_t first_vertex= geometry.vertices_pos.size();
+					result->sectors_triangle_groups.emplace_back();
+					BuildSectorGeometry(world_sectors[sector_index], segment_models, geometry, result->sectors_triangle_groups.back());
+
+					const size_t box_index= sector_index >> pos_box_sectors_log2;
+					QuantizeVerticesPositions(
+						geometry.vertices_pos.data() + first_vertex,
+						geometry.vertices_pos.size() - first_vertex,
+						pos_boxes[box_index],
+						pos_step,
+						uint32_t(box_index),
+						geometry.vertices_pos_packed.data() + first_vertex);
+				}
+
+				result->ready= true;
+			});
+	}
+
+	return geometry_changed;
+}
+
+void WorldRenderer::UploadStreamingPage(WorldModel& world_model, StreamingPage& page, const uint32_t slot)
+{
+	WorldStreaming& streaming= *world_model.streaming;
+	StreamingPageBuildResult& result= *page.build_result;
+	const SectorsGeometry& geometry= result.geometry;
+	KK_ASSERT(geometry.vertices_pos_packed.size() <= streaming.slot_vertices);
+	KK_ASSERT(geometry.indices.size() <= streaming.slot_indices);
+
+	const uint32_t first_vertex= uint32_t(slot * streaming.slot_vertices);
+	const uint32_t first_index= uint32_t(slot * streaming.slot_indices);
+	const uint32_t first_draw_command= uint32_t(slot * streaming.slot_draw_commands);
+
+	// Move triangle groups into sectors, make their offsets absolute.
+	std::vector<vk::DrawIndexedIndirectCommand> draw_commands;
+	for(size_t i= 0u; i < page.sectors.size(); ++i)
+	{
+		Sector& sector= world_model.sectors[page.sectors[i]];
+		sector.triangle_groups= std::move(result.sectors_triangle_groups[i]);
+		for(Sector::TriangleGroup& triangle_group : sector.triangle_groups)
+		{
+			triangle_group.first_vertex+= first_vertex;
+			triangle_group.first_index+= first_index;
+			for(uint32_t l= 0u; l < triangle_group.lod_count; ++l)
+				triangle_group.lods[l].first_index+= first_index;
+		}
+
+		BuildSectorDrawCommands(sector, first_draw_command, draw_commands);
+	}
+	KK_ASSERT(draw_commands.size() <= streaming.slot_draw_commands);
+
+	UploadBufferData(
+		*world_model.vertex_pos_buffer,
+		vk::DeviceSize(first_vertex) * sizeof(WorldVertexPos),
+		geometry.vertices_pos_packed.data(),
+		geometry.vertices_pos_packed.size() * sizeof(WorldVertexPos));
+	UploadBufferData(
+		*world_model.vertex_attributes_buffer,
+		vk::DeviceSize(first_vertex) * sizeof(WorldVertexAttributes),
+		geometry.vertices_attributes.data(),
+		geometry.vertices_attributes.size() * sizeof(WorldVertexAttributes));
+
+	if(world_model.index_type == vk::IndexType::eUint16)
+	{
+		const std::vector<uint16_t> indices_16(geometry.indices.begin(), geometry.indices.end());
+		UploadBufferData(
+			*world_model.index_buffer,
+			vk::DeviceSize(first_index) * sizeof(uint16_t),
+			indices_16.data(),
+			indices_16.size() * sizeof(uint16_t));
+	}
+	else
+		UploadBufferData(
+			*world_model.index_buffer,
+			vk::DeviceSize(first_index) * sizeof(uint32_t),
+			geometry.indices.data(),
+			geometry.indices.size() * sizeof(uint32_t));
+
+	UploadBufferData(
+		*world_model.draw_commands_buffer,
+		vk::DeviceSize(first_draw_command) * sizeof(vk::DrawIndexedIndirectCommand),
+		draw_commands.data(),
+		draw_commands.size() * sizeof(vk::DrawIndexedIndirectCommand));
+
+	page.slot= slot;
+	page.build_result= nullptr;
+	streaming.changed_pages_bounds.emplace_back(page.bb_min, page.bb_max);
+	++streaming.pages_uploaded_total;
+}
+
+void WorldRenderer::EvictStreamingPage(WorldModel& world_model, StreamingPage& page)
+{
+	WorldStreaming& streaming= *world_model.streaming;
+
+	for(const size_t sector_index : page.sectors)
+	{
+		std::vector<Sector::TriangleGroup>& triangle_groups= world_model.sectors[sector_index].triangle_groups;
+		triangle_groups.clear();
+		triangle_groups.shrink_to_fit();
+	}
+
+	// Slot may be still used by previous frames, so, free it later.
+	streaming.released_slots.emplace_back(*page.slot, streaming.frame_number);
+	page.slot= std::nullopt;
+	streaming.changed_pages_bounds.emplace_back(page.bb_min, page.bb_max);
+	++streaming.pages_evicted_total;
+}
+
+void WorldRenderer::UploadBufferData(const vk::Buffer dst_buffer, const vk::DeviceSize dst_offset, const void* const data, const size_t size)
+{
+	size_t offset= 0u;
+	const size_t block_size= gpu_data_uploader_.GetMaxMemoryBlockSize();
+	while(offset < size)
+	{
+		const size_t request_size= std::min(block_size, size - offset);
+		const auto staging_buffer= gpu_data_uploader_.RequestMemory(request_size);
+
+		std::memcpy(
+			reinterpret_cast<char*>(staging_buffer.buffer_data) + staging_buffer.buffer_offset,
+			reinterpret_cast<const char*>(data) + offset,
+			request_size);
+
+		staging_buffer.command_buffer.copyBuffer(
+			staging_buffer.buffer,
+			dst_buffer,
+			{ vk::BufferCopy(staging_buffer.buffer_offset, dst_offset + offset, request_size) });
+		offset+= request_size;
+	}
+}
+
+void WorldRenderer::BuildSectorGeometry(
+	const WorldData::Sector& in_sector,
+	const SegmentModels& segment_models,
+	SectorsGeometry& geometry,
+	std::vector<Sector::TriangleGroup>& out_triangle_groups)
+{
+	// Combine triangle groups with same material into single triangle groups.
+	struct SectorTriangleGroup
+	{
+		std::vector<uint32_t> indices; // Relative to first vertex of group.
+		std::vector<m_Vec3> vertices_pos; // Not quantized yet.
+		std::vector<WorldVertexPos> vertices_pos_packed; // Only binormal sign is set.
+		std::vector<WorldVertexAttributes> vertices_attributes;
+		std::unordered_map<WorldVertexWeldKey, uint32_t, WorldVertexWeldKeyHasher> vertices_map; // For welding.
+	};
+
+	std::unordered_map< MaterialIndex, SectorTriangleGroup > sector_triangle_groups;
+	std::vector<uint32_t> vertex_remap;
+
+	for(const WorldData::Segment& segment : in_sector.segments)
+	{
+		const auto model_it= segment_models.find(segment.type);
+		if(model_it == segment_models.end())
+			continue;
+
+		const SegmentModel& model = model_it->second;
+
+		m_Mat4 segment_mat, rotate_mat;
+		CalculateSegmentMatrices(segment, model.header, segment_mat, rotate_mat);
+
+		for(size_t i= 0u; i < size_t(model.header.triangle_group_count); ++i)
+		{
+			const SegmentModelFormat::TriangleGroup& in_triangle_group= model.triangle_groups[i];
+			SectorTriangleGroup& out_triangle_group= sector_triangle_groups[ model.local_to_global_material_index[in_triangle_group.material_id] ];
+
+			// Weld identical vertices of all segments of this group.
+			vertex_remap.resize(size_t(in_triangle_group.vertex_count));
+			for(size_t j= 0u; j < size_t(in_triangle_group.vertex_count); ++j)
+			{
+				const SegmentModelFormat::Vertex& in_v= model.vetices[in_triangle_group.first_vertex + j];
+				const m_Vec3 pos(float(in_v.pos[0]), float(in_v.pos[1]), float(in_v.pos[2]));
+				const m_Vec3 pos_transformed= pos * segment_mat;
+
+				WorldVertexPos out_v_pos{};
+				WorldVertexAttributes out_v;
+				PackSegmentModelVertex(in_v, rotate_mat, out_v_pos, out_v);
+
+				WorldVertexWeldKey weld_key;
+				weld_key.pos[0]= int32_t(std::round(pos_transformed.x * c_weld_grid_scale));
+				weld_key.pos[1]= int32_t(std::round(pos_transformed.y * c_weld_grid_scale));
+				weld_key.pos[2]= int32_t(std::round(pos_transformed.z * c_weld_grid_scale));
+				weld_key.binormal_sign= out_v_pos.binormal_sign_and_box;
+				weld_key.attributes= out_v;
+
+				const auto insert_result= out_triangle_group.vertices_map.emplace(weld_key, uint32_t(out_triangle_group.vertices_pos.size()));
+				if(insert_result.second)
+				{
+					out_triangle_group.vertices_pos.push_back(pos_transformed);
+					out_triangle_group.vertices_pos_packed.push_back(out_v_pos);
+					out_triangle_group.vertices_attributes.push_back(out_v);
+				}
+				vertex_remap[j]= insert_result.first->second;
+				++geometry.vertices_before_weld;
+			}
+
+			for(size_t j= 0u; j < in_triangle_group.index_count; ++j)
+			{
+				const uint32_t index= vertex_remap[ model.indices[ in_triangle_group.first_index + j ] ];
+				out_triangle_group.indices.push_back(index);
+				geometry.max_index= std::max(geometry.max_index, index);
+			}
+		}
+	}
+
+	for(auto& triangle_group_pair : sector_triangle_groups)
+	{
+		SectorTriangleGroup& triangle_group= triangle_group_pair.second;
+
+		{ // Reorder triangles for vertex cache and vertices for fetch locality.
+			const size_t vertex_count= triangle_group.vertices_pos.size();
+			geometry.cache_misses_before+= CountVertexCacheMisses(triangle_group.indices.data(), triangle_group.indices.size(), vertex_count, c_stats_vertex_cache_size);
+			OptimizeTrianglesOrder(triangle_group.indices.data(), triangle_group.indices.size(), vertex_count);
+			const std::vector<uint32_t> remap= OptimizeVerticesOrder(triangle_group.indices.data(), triangle_group.indices.size(), vertex_count);
+			geometry.cache_misses_after+= CountVertexCacheMisses(triangle_group.indices.data(), triangle_group.indices.size(), vertex_count, c_stats_vertex_cache_size);
+
+			SectorTriangleGroup reordered;
+			reordered.vertices_pos.resize(vertex_count);
+			reordered.vertices_pos_packed.resize(vertex_count);
+			reordered.vertices_attributes.resize(vertex_count);
+			for(size_t v= 0u; v < vertex_count; ++v)
+			{
+				reordered.vertices_pos[remap[v]]= triangle_group.vertices_pos[v];
+				reordered.vertices_pos_packed[remap[v]]= triangle_group.vertices_pos_packed[v];
+				reordered.vertices_attributes[remap[v]]= triangle_group.vertices_attributes[v];
+			}
+			triangle_group.vertices_pos.swap(reordered.vertices_pos);
+			triangle_group.vertices_pos_packed.swap(reordered.vertices_pos_packed);
+			triangle_group.vertices_attributes.swap(reordered.vertices_attributes);
+		}
+
+		Sector::TriangleGroup out_triangle_group;
+		out_triangle_group.material_index= triangle_group_pair.first;
+		out_triangle_group.first_vertex= uint32_t(geometry.vertices_pos.size());
+		out_triangle_group.first_index= uint32_t(geometry.indices.size());
+		out_triangle_group.index_count= uint32_t(triangle_group.indices.size());
+
+		out_triangle_group.bb_min= m_Vec3(+1e24f, +1e24f, +1e24f);
+		out_triangle_group.bb_max= m_Vec3(-1e24f, -1e24f, -1e24f);
+		for(const m_Vec3& pos : triangle_group.vertices_pos)
+		{
+			out_triangle_group.bb_min.x= std::min(out_triangle_group.bb_min.x, pos.x);
+			out_triangle_group.bb_min.y= std::min(out_triangle_group.bb_min.y, pos.y);
+			out_triangle_group.bb_min.z= std::min(out_triangle_group.bb_min.z, pos.z);
+			out_triangle_group.bb_max.x= std::max(out_triangle_group.bb_max.x, pos.x);
+			out_triangle_group.bb_max.y= std::max(out_triangle_group.bb_max.y, pos.y);
+			out_triangle_group.bb_max.z= std::max(out_triangle_group.bb_max.z, pos.z);
+		}
+
+		geometry.vertices_pos.insert(geometry.vertices_pos.end(), triangle_group.vertices_pos.begin(), triangle_group.vertices_pos.end());
+		geometry.vertices_pos_packed.insert(geometry.vertices_pos_packed.end(), triangle_group.vertices_pos_packed.begin(), triangle_group.vertices_pos_packed.end());
+		geometry.vertices_attributes.insert(geometry.vertices_attributes.end(), triangle_group.vertices_attributes.begin(), triangle_group.vertices_attributes.end());
+		geometry.indices.insert(geometry.indices.end(), triangle_group.indices.begin(), triangle_group.indices.end());
+
+		BuildTriangleGroupLods(
+			triangle_group.indices.data(),
+			triangle_group.indices.size(),
+			triangle_group.vertices_pos.data(),
+			triangle_group.vertices_pos.size(),
+			out_triangle_group.first_vertex,
+			geometry,
+			out_triangle_group);
+
+		out_triangle_groups.push_back(std::move(out_triangle_group));
+	}
+}
+
+void WorldRenderer::BuildTriangleGroupLods(
+	const uint32_t* const indices,
+	const size_t index_count,
+	const m_Vec3* const vertices_pos,
+	const size_t vertex_count,
+	const size_t first_vertex,
+	SectorsGeometry& geometry,
+	Sector::TriangleGroup& out_triangle_group)
+{
+	static_assert(std::size(c_lod_cell_sizes) == Sector::TriangleGroup::c_max_lods, "Invalid size");
+	static_assert(TriangleGroupsCullerGPU::c_max_lods == Sector::TriangleGroup::c_max_lods, "Invalid size");
+
+	// Vertices with different tangent frame or texture coordinates must not be merged, in order to preserve hard edges and texture seams.
+	std::unordered_map<WorldVertexWeldKey, uint32_t, WorldVertexWeldKeyHasher> attributes_ids_map;
+	std::vector<uint32_t> vertices_attributes_ids(vertex_count);
+	for(size_t v= 0u; v < vertex_count; ++v)
+	{
+		WorldVertexWeldKey key{}; // Position is not used.
+		key.binormal_sign= geometry.vertices_pos_packed[first_vertex + v].binormal_sign_and_box;
+		key.attributes= geometry.vertices_attributes[first_vertex + v];
+		vertices_attributes_ids[v]= attributes_ids_map.emplace(key, uint32_t(attributes_ids_map.size())).first->second;
+	}
+
+	for(const float cell_size : c_lod_cell_sizes)
+	{
+		std::vector<uint32_t> lod_indices=
+			SimplifyMeshVertexClustering(indices, index_count, vertices_pos, vertices_attributes_ids.data(), vertex_count, cell_size);
+
+		// Skip levels, which are empty or not simple enough.
+		const size_t prev_index_count=
+			out_triangle_group.lod_count == 0u ? index_count : out_triangle_group.lods[out_triangle_group.lod_count - 1u].index_count;
+		if(lod_indices.empty() || lod_indices.size() * 4u > prev_index_count * 3u)
+			continue;
+
+		OptimizeTrianglesOrder(lod_indices.data(), lod_indices.size(), vertex_count);
+
+		Sector::TriangleGroup::Lod& lod= out_triangle_group.lods[out_triangle_group.lod_count];
+		++out_triangle_group.lod_count;
+		lod.first_index= uint32_t(geometry.indices.size());
+		lod.index_count= uint32_t(lod_indices.size());
+		lod.error= cell_size;
+		geometry.indices.insert(geometry.indices.end(), lod_indices.begin(), lod_indices.end());
+		geometry.lods_triangle_count+= lod_indices.size() / 3u;
+	}
+}
+
+void WorldRenderer::BuildSectorDrawCommands(Sector& sector, const uint32_t first_command, std::vector<vk::DrawIndexedIndirectCommand>& draw_commands)
+{
+	sector.first_draw_command= first_command + uint32_t(draw_commands.size());
+	for(size_t lod= 0u; lod <= std::size(c_lod_cell_sizes); ++lod)
+	for(const Sector::TriangleGroup& triangle_group : sector.triangle_groups)
+	{
+		// Use most simplified level of detail of group with error not greater, than error of global level.
+		uint32_t first_index= triangle_group.first_index;
+		uint32_t index_count= triangle_group.index_count;
+		for(uint32_t i= 0u; lod > 0u && i < triangle_group.lod_count && triangle_group.lods[i].error <= c_lod_cell_sizes[lod - 1u]; ++i)
+		{
+			first_index= triangle_group.lods[i].first_index;
+			index_count= triangle_group.lods[i].index_count;
+		}
+
+		draw_commands.emplace_back(
+			index_count,
+			triangle_group.instance_count,
+			first_index,
+			int32_t(triangle_group.first_vertex),
+			triangle_group.first_instance);
+	}
+}
+
+WorldRenderer::WorldModel WorldRenderer::LoadWorld(const WorldData::World& world, const SegmentModels& segment_models, const bool streaming)
+{
+	// Each sector has own set of triangle groups.
+	// In streaming mode only description of sectors is built here, geometry is built later by pages.
+
+	WorldModel world_model;
+	SectorsGeometry geometry;
+
+	// In instanced segments mode upload each segment model once.
+	// Positions are shifted into unsigned range, shift is combined with transformation of each instance.
+	struct InstancedModel
+	{
+		uint32_t first_vertex;
+		uint32_t first_index;
+		m_Mat4 dequantization_mat; // From shifted position into coordinates of model file.
+		std::vector< std::pair<m_Vec3, m_Vec3> > triangle_groups_boxes; // In coordinates of model file.
+		std::vector<Sector::TriangleGroup> triangle_groups_lods; // Only levels of detail are filled.
+	};
+	std::unordered_map<WorldData::SegmentType, InstancedModel> instanced_models;
+	std::vector<WorldInstance> world_instances;
+	if(instanced_segments_)
+	{
+		m_Mat4 identity_mat;
+		identity_mat.MakeIdentity();
+
+		for(const auto& model_pair : segment_models)
+		{
+			const SegmentModel& model= model_pair.second;
+			InstancedModel& instanced_model= instanced_models[model_pair.first];
+			instanced_model.first_vertex= uint32_t(geometry.vertices_pos_packed.size());
+			instanced_model.first_index= uint32_t(geometry.indices.size());
+
+			// Positions in file are 16-bit integers, so, shift them into unsigned range without precision loss.
+			int32_t bb_min[3]{ 0, 0, 0 };
+			for(size_t v= 0u; v < model.header.vertex_count; ++v)
+			for(size_t k= 0u; k < 3u; ++k)
+				bb_min[k]= v == 0u ? int32_t(model.vetices[v].pos[k]) : std::min(bb_min[k], int32_t(model.vetices[v].pos[k]));
+
+			instanced_model.dequantization_mat.Translate(m_Vec3(float(bb_min[0]), float(bb_min[1]), float(bb_min[2])));
+
+			for(size_t v= 0u; v < model.header.vertex_count; ++v)
+			{
+				const SegmentModelFormat::Vertex& in_v= model.vetices[v];
+
+				WorldVertexPos out_v_pos{};
+				WorldVertexAttributes out_v;
+				PackSegmentModelVertex(in_v, identity_mat, out_v_pos, out_v);
+				for(size_t k= 0u; k < 3u; ++k)
+					out_v_pos.pos[k]= uint16_t(int32_t(in_v.pos[k]) - bb_min[k]);
+
+				geometry.vertices_pos_packed.push_back(out_v_pos);
+				geometry.vertices_attributes.push_back(out_v);
+			}
 
-		command_buffer.drawIndexed(triangle_group.index_count, 1u, triangle_group.first_index, triangle_group.first_vertex, 0u);
-	}
-}
+			for(size_t i= 0u; i < model.header.index_count; ++i)
+			{
+				geometry.indices.push_back(model.indices[i]);
+				geometry.max_index= std::max(geometry.max_index, uint32_t(model.indices[i]));
+			}
 
-void WorldRenderer::DrawWorldModelToDepthCubemap(
-	const vk::CommandBuffer command_buffer,
-	const WorldModel& world_model,
-	const m_Vec3& light_pos,
-	const float light_radius)
-{
-	const vk::DeviceSize offsets= 0u;
-	command_buffer.bindVertexBuffers(0u, 1u, &*world_model.vertex_buffer, &offsets);
-	command_buffer.bindIndexBuffer(*world_model.index_buffer, 0u, vk::IndexType::eUint16);
-
-	for(const Sector& sector : world_model.sectors)
-	{
-		if( light_pos.x + light_radius < sector.bb_min.x ||
-			light_pos.x - light_radius > sector.bb_max.x ||
-			light_pos.y + light_radius < sector.bb_min.y ||
-			light_pos.y - light_radius > sector.bb_max.y ||
-			light_pos.z + light_radius < sector.bb_min.z ||
-			light_pos.z - light_radius > sector.bb_max.z)
-			continue;
+			for(size_t i= 0u; i < size_t(model.header.triangle_group_count); ++i)
+			{
+				const SegmentModelFormat::TriangleGroup& in_triangle_group= model.triangle_groups[i];
+				m_Vec3 box_min(+1e24f, +1e24f, +1e24f);
+				m_Vec3 box_max(-1e24f, -1e24f, -1e24f);
+				for(size_t j= 0u; j < size_t(in_triangle_group.vertex_count); ++j)
+				{
+					const SegmentModelFormat::Vertex& in_v= model.vetices[in_triangle_group.first_vertex + j];
+					const m_Vec3 pos(float(in_v.pos[0]), float(in_v.pos[1]), float(in_v.pos[2]));
+					box_min.x= std::min(box_min.x, pos.x);
+					box_min.y= std::min(box_min.y, pos.y);
+					box_min.z= std::min(box_min.z, pos.z);
+					box_max.x= std::max(box_max.x, pos.x);
+					box_max.y= std::max(box_max.y, pos.y);
+					box_max.z= std::max(box_max.z, pos.z);
+				}
+				instanced_model.triangle_groups_boxes.emplace_back(box_min, box_max);
+			}
 
-		for(const Sector::TriangleGroup& triangle_group : sector.triangle_groups)
-			command_buffer.drawIndexed(triangle_group.index_count, 1u, triangle_group.first_index, triangle_group.first_vertex, 0u);
-	}
-}
+			// Build levels of detail, using scaled positions, because errors are in world space.
+			std::vector<m_Vec3> vertices_pos;
+			std::vector<uint32_t> indices;
+			for(size_t i= 0u; i < size_t(model.header.triangle_group_count); ++i)
+			{
+				const SegmentModelFormat::TriangleGroup& in_triangle_group= model.triangle_groups[i];
 
-WorldRenderer::WorldModel WorldRenderer::LoadWorld(const WorldData::World& world, const SegmentModels& segment_models)
-{
-	// Combine triangle groups with same material into single triangle groups.
-	// Each sector has own set of triangle groups.
+				vertices_pos.clear();
+				for(size_t j= 0u; j < size_t(in_triangle_group.vertex_count); ++j)
+				{
+					const SegmentModelFormat::Vertex& in_v= model.vetices[in_triangle_group.first_vertex + j];
+					vertices_pos.emplace_back(
+						float(in_v.pos[0]) * model.header.scale[0] + model.header.shift[0],
+						float(in_v.pos[1]) * model.header.scale[1] + model.header.shift[1],
+						float(in_v.pos[2]) * model.header.scale[2] + model.header.shift[2]);
+				}
+				indices.assign(model.indices + in_triangle_group.first_index, model.indices + in_triangle_group.first_index + in_triangle_group.index_count);
+
+				Sector::TriangleGroup triangle_group_lods{};
+				BuildTriangleGroupLods(
+					indices.data(),
+					indices.size(),
+					vertices_pos.data(),
+					vertices_pos.size(),
+					instanced_model.first_vertex + in_triangle_group.first_vertex,
+					geometry,
+					triangle_group_lods);
+				instanced_model.triangle_groups_lods.push_back(triangle_group_lods);
+			}
+		}
+	}
 
-	struct SectorTriangleGroup
+	// Boxes of models in coordinates of model file. In streaming mode they are used for estimation of bounds of sectors geometry.
+	std::unordered_map< WorldData::SegmentType, std::pair<m_Vec3, m_Vec3> > models_boxes;
+	if(streaming)
 	{
-		std::vector<uint16_t> indices;
-		std::vector<WorldVertex> vertcies;
-	};
-
-	WorldModel world_model;
+		for(const auto& model_pair : segment_models)
+		{
+			const SegmentModel& model= model_pair.second;
+			m_Vec3 box_min(+1e24f, +1e24f, +1e24f);
+			m_Vec3 box_max(-1e24f, -1e24f, -1e24f);
+			for(size_t v= 0u; v < model.header.vertex_count; ++v)
+			{
+				const m_Vec3 pos(float(model.vetices[v].pos[0]), float(model.vetices[v].pos[1]), float(model.vetices[v].pos[2]));
+				box_min.x= std::min(box_min.x, pos.x);
+				box_min.y= std::min(box_min.y, pos.y);
+				box_min.z= std::min(box_min.z, pos.z);
+				box_max.x= std::max(box_max.x, pos.x);
+				box_max.y= std::max(box_max.y, pos.y);
+				box_max.z= std::max(box_max.z, pos.z);
+			}
+			models_boxes.emplace(model_pair.first, std::make_pair(box_min, box_max));
+		}
+	}
 
-	// Create vertex buffer.
-	std::vector<WorldVertex> world_vertices;
-	std::vector<uint16_t> world_indeces;
+	// Upper bounds of geometry size of each sector, used for building of streaming pages.
+	std::vector<size_t> sectors_max_vertices;
+	std::vector<size_t> sectors_max_indices;
+	std::vector<size_t> sectors_max_draw_commands;
+	// Ranges of vertices of baked sectors, used for quantization.
+	std::vector< std::pair<size_t, size_t> > sectors_vertices;
 
 	world_model.sectors.resize(world.sectors.size());
 	for(size_t s= 0u; s < world_model.sectors.size(); ++s)
@@ -1160,7 +3443,14 @@ WorldRenderer::WorldModel WorldRenderer::LoadWorld(const WorldData::World& world
 		out_sector.bb_max.y= float(in_sector.bb_max[1]);
 		out_sector.bb_max.z= float(in_sector.bb_max[2]);
 
-		std::unordered_map< std::string, SectorTriangleGroup > sector_triangle_groups;
+		// Geometry of sector may be outside sector box. Use both of them for culling.
+		m_Vec3 bounds_min= out_sector.bb_min;
+		m_Vec3 bounds_max= out_sector.bb_max;
+
+		std::unordered_map< WorldData::SegmentType, std::vector< std::pair<WorldInstance, m_Mat4> > > sector_instances; // Instance, segment transformation.
+		size_t max_vertices= 0u;
+		size_t max_indices= 0u;
+		size_t max_triangle_groups= 0u;
 
 		for(const WorldData::Segment& segment : in_sector.segments)
 		{
@@ -1170,67 +3460,49 @@ WorldRenderer::WorldModel WorldRenderer::LoadWorld(const WorldData::World& world
 
 			const SegmentModel& model = model_it->second;
 
-			m_Mat4 base_transform_mat, to_center_mat, rotate_mat, from_center_mat, translate_mat, segment_mat;
-			base_transform_mat.MakeIdentity();
-			base_transform_mat.value[ 0]= model.header.scale[0];
-			base_transform_mat.value[ 5]= model.header.scale[1];
-			base_transform_mat.value[10]= model.header.scale[2];
-			base_transform_mat.value[12]= model.header.shift[0];
-			base_transform_mat.value[13]= model.header.shift[1];
-			base_transform_mat.value[14]= model.header.shift[2];
-
-			to_center_mat.Translate(m_Vec3(-0.5f, -0.5f, 0.0f));
-			rotate_mat.RotateZ(float(segment.angle) * MathConstants::half_pi);
-			from_center_mat.Translate(m_Vec3(+0.5f, +0.5f, 0.0f));
-			translate_mat.Translate(m_Vec3(float(segment.pos[0]), float(segment.pos[1]), float(segment.pos[2])));
-			segment_mat= base_transform_mat * to_center_mat * rotate_mat * from_center_mat * translate_mat;
+			m_Mat4 segment_mat, rotate_mat;
+			CalculateSegmentMatrices(segment, model.header, segment_mat, rotate_mat);
 
-			for(size_t i= 0u; i < size_t(model.header.triangle_group_count); ++i)
+			if(instanced_segments_)
 			{
-				const SegmentModelFormat::TriangleGroup& in_triangle_group= model.triangle_groups[i];
-				SectorTriangleGroup& out_triangle_group= sector_triangle_groups[ model.local_to_global_material_id[in_triangle_group.material_id] ];
-
-				// TODO - maybe also remove duplicated vertices?
-				const size_t first_vertex= out_triangle_group.vertcies.size();
-				for(size_t j= 0u; j < size_t(in_triangle_group.vertex_count); ++j)
+				// Combine dequantization of model positions with transformation of segment.
+				const m_Mat4 instance_mat= instanced_models.at(segment.type).dequantization_mat * segment_mat;
+
+				WorldInstance instance;
+				for(size_t j= 0u; j < 3u; ++j)
+				for(size_t k= 0u; k < 4u; ++k)
+					instance.pos_transform[j][k]= instance_mat.value[k * 4u + j];
+				instance.normal_transform[0]= rotate_mat.value[0];
+				instance.normal_transform[1]= rotate_mat.value[4];
+				instance.normal_transform[2]= rotate_mat.value[1];
+				instance.normal_transform[3]= rotate_mat.value[5];
+
+				sector_instances[segment.type].emplace_back(instance, segment_mat);
+			}
+			else if(streaming)
+			{
+				// Welding and simplification may only reduce these values.
+				for(size_t i= 0u; i < size_t(model.header.triangle_group_count); ++i)
 				{
-					const SegmentModelFormat::Vertex& in_v= model.vetices[in_triangle_group.first_vertex + j];
-					const m_Vec3 pos(float(in_v.pos[0]), float(in_v.pos[1]), float(in_v.pos[2]));
-					const m_Vec3 pos_transformed= pos * segment_mat;
-
-					WorldVertex out_v;
-					out_v.pos[0]= pos_transformed.x;
-					out_v.pos[1]= pos_transformed.y;
-					out_v.pos[2]= pos_transformed.z;
-
-					const m_Vec3 normal(float(in_v.normal[0]), float(in_v.normal[1]), float(in_v.normal[2]));
-					const m_Vec3 binormal(float(in_v.binormal[0]), float(in_v.binormal[1]), float(in_v.binormal[2]));
-					const m_Vec3 tangent(float(in_v.tangent[0]), float(in_v.tangent[1]), float(in_v.tangent[2]));
-					const m_Vec3 normal_transformed= normal * rotate_mat;
-					const m_Vec3 binormal_transformed= binormal * rotate_mat;
-					const m_Vec3 tangent_transformed= tangent * rotate_mat;
-
-					out_v.normal[0]= int8_t(normal_transformed.x);
-					out_v.normal[1]= int8_t(normal_transformed.y);
-					out_v.normal[2]= int8_t(normal_transformed.z);
-					out_v.binormal[0]= int8_t(binormal_transformed.x);
-					out_v.binormal[1]= int8_t(binormal_transformed.y);
-					out_v.binormal[2]= int8_t(binormal_transformed.z);
-					out_v.tangent[0]= int8_t(tangent_transformed.x);
-					out_v.tangent[1]= int8_t(tangent_transformed.y);
-					out_v.tangent[2]= int8_t(tangent_transformed.z);
-
-					for(size_t j= 0u; j < 2u; ++j)
-						out_v.tex_coord[j]= float(in_v.tex_coord[j]) / float(SegmentModelFormat::c_tex_coord_scale);
-
-					out_triangle_group.vertcies.push_back(out_v);
+					max_vertices+= size_t(model.triangle_groups[i].vertex_count);
+					max_indices+= size_t(model.triangle_groups[i].index_count);
 				}
+				max_triangle_groups+= size_t(model.header.triangle_group_count);
 
-				for(size_t j= 0u; j < in_triangle_group.index_count; ++j)
+				const std::pair<m_Vec3, m_Vec3>& box= models_boxes.at(segment.type);
+				for(size_t c= 0u; c < 8u; ++c)
 				{
-					const size_t index= model.indices[ in_triangle_group.first_index + j ] + first_vertex;
-					KK_ASSERT(index < 65535u);
-					out_triangle_group.indices.push_back(uint16_t(index));
+					const m_Vec3 corner(
+						(c & 1u) != 0u ? box.second.x : box.first.x,
+						(c & 2u) != 0u ? box.second.y : box.first.y,
+						(c & 4u) != 0u ? box.second.z : box.first.z);
+					const m_Vec3 pos= corner * segment_mat;
+					bounds_min.x= std::min(bounds_min.x, pos.x);
+					bounds_min.y= std::min(bounds_min.y, pos.y);
+					bounds_min.z= std::min(bounds_min.z, pos.z);
+					bounds_max.x= std::max(bounds_max.x, pos.x);
+					bounds_max.y= std::max(bounds_max.y, pos.y);
+					bounds_max.z= std::max(bounds_max.z, pos.z);
 				}
 			}
 
@@ -1248,66 +3520,387 @@ WorldRenderer::WorldModel WorldRenderer::LoadWorld(const WorldData::World& world
 			}
 		} // for sector segments
 
-		for(const auto& triangle_group_pair : sector_triangle_groups)
+		// Create triangle group for each triangle group of each instanced model. Draw all instances of model in sector via single call.
+		for(const auto& instances_pair : sector_instances)
 		{
-			const SectorTriangleGroup& triangle_group= triangle_group_pair.second;
+			const SegmentModel& model= segment_models.at(instances_pair.first);
+			const InstancedModel& instanced_model= instanced_models.at(instances_pair.first);
+
+			const uint32_t first_instance= uint32_t(world_instances.size());
+			for(const auto& instance : instances_pair.second)
+				world_instances.push_back(instance.first);
+
+			for(size_t i= 0u; i < size_t(model.header.triangle_group_count); ++i)
+			{
+				const SegmentModelFormat::TriangleGroup& in_triangle_group= model.triangle_groups[i];
+
+				Sector::TriangleGroup out_triangle_group;
+				out_triangle_group.material_index= model.local_to_global_material_index[in_triangle_group.material_id];
+				out_triangle_group.first_vertex= instanced_model.first_vertex + in_triangle_group.first_vertex;
+				out_triangle_group.first_index= instanced_model.first_index + in_triangle_group.first_index;
+				out_triangle_group.index_count= in_triangle_group.index_count;
+				out_triangle_group.first_instance= first_instance;
+				out_triangle_group.instance_count= uint32_t(instances_pair.second.size());
+				out_triangle_group.lod_count= instanced_model.triangle_groups_lods[i].lod_count;
+				for(uint32_t l= 0u; l < out_triangle_group.lod_count; ++l)
+					out_triangle_group.lods[l]= instanced_model.triangle_groups_lods[i].lods[l];
+
+				// Box of group is union of boxes of all instances.
+				out_triangle_group.bb_min= m_Vec3(+1e24f, +1e24f, +1e24f);
+				out_triangle_group.bb_max= m_Vec3(-1e24f, -1e24f, -1e24f);
+				const std::pair<m_Vec3, m_Vec3>& box= instanced_model.triangle_groups_boxes[i];
+				for(const auto& instance : instances_pair.second)
+				for(size_t c= 0u; c < 8u; ++c)
+				{
+					const m_Vec3 corner(
+						(c & 1u) != 0u ? box.second.x : box.first.x,
+						(c & 2u) != 0u ? box.second.y : box.first.y,
+						(c & 4u) != 0u ? box.second.z : box.first.z);
+					const m_Vec3 pos= corner * instance.second;
+					out_triangle_group.bb_min.x= std::min(out_triangle_group.bb_min.x, pos.x);
+					out_triangle_group.bb_min.y= std::min(out_triangle_group.bb_min.y, pos.y);
+					out_triangle_group.bb_min.z= std::min(out_triangle_group.bb_min.z, pos.z);
+					out_triangle_group.bb_max.x= std::max(out_triangle_group.bb_max.x, pos.x);
+					out_triangle_group.bb_max.y= std::max(out_triangle_group.bb_max.y, pos.y);
+					out_triangle_group.bb_max.z= std::max(out_triangle_group.bb_max.z, pos.z);
+				}
 
-			Sector::TriangleGroup out_triangle_group;
-			out_triangle_group.material_id= triangle_group_pair.first;
-			out_triangle_group.first_vertex= uint32_t(world_vertices.size());
-			out_triangle_group.first_index= uint32_t(world_indeces.size());
-			out_triangle_group.index_count= uint32_t(triangle_group.indices.size());
+				out_sector.triangle_groups.push_back(std::move(out_triangle_group));
+			}
+		}
 
-			world_vertices.insert(world_vertices.end(), triangle_group.vertcies.begin(), triangle_group.vertcies.end());
-			world_indeces.insert(world_indeces.end(), triangle_group.indices.begin(), triangle_group.indices.end());
+		if(!instanced_segments_ && !streaming)
+		{
+			const size_t first_vertex= geometry.vertices_pos.size();
+			BuildSectorGeometry(in_sector, segment_models, geometry, out_sector.triangle_groups);
+			sectors_vertices.emplace_back(first_vertex, geometry.vertices_pos.size());
+		}
 
-			out_sector.triangle_groups.push_back(std::move(out_triangle_group));
+		for(const Sector::TriangleGroup& triangle_group : out_sector.triangle_groups)
+		{
+			bounds_min.x= std::min(bounds_min.x, triangle_group.bb_min.x);
+			bounds_min.y= std::min(bounds_min.y, triangle_group.bb_min.y);
+			bounds_min.z= std::min(bounds_min.z, triangle_group.bb_min.z);
+			bounds_max.x= std::max(bounds_max.x, triangle_group.bb_max.x);
+			bounds_max.y= std::max(bounds_max.y, triangle_group.bb_max.y);
+			bounds_max.z= std::max(bounds_max.z, triangle_group.bb_max.z);
+		}
+		world_model.sectors_bounds.min_x.push_back(bounds_min.x);
+		world_model.sectors_bounds.min_y.push_back(bounds_min.y);
+		world_model.sectors_bounds.min_z.push_back(bounds_min.z);
+		world_model.sectors_bounds.max_x.push_back(bounds_max.x);
+		world_model.sectors_bounds.max_y.push_back(bounds_max.y);
+		world_model.sectors_bounds.max_z.push_back(bounds_max.z);
+
+		if(streaming)
+		{
+			sectors_max_vertices.push_back(max_vertices);
+			// Each level of detail has no more, than 3/4 of indices of previous level.
+			sectors_max_indices.push_back(max_indices + max_indices * 3u / 4u + max_indices * 9u / 16u);
+			sectors_max_draw_commands.push_back(max_triangle_groups * (std::size(c_lod_cell_sizes) + 1u));
 		}
 	} // for sectors
 
-	Log::Info("World sectors: ", world_model.sectors.size());
-	Log::Info("World vertices: ", world_vertices.size(), " (", world_vertices.size() * sizeof(WorldVertex) / 1024u / 1024u, "MB)");
-	Log::Info("Worl triangles: ", world_indeces.size() / 3u, " (", world_indeces.size() * sizeof(uint16_t) / 1024u / 1024u, "MB)");
+	// Link portals with sectors. Skip degenerate portals.
+	for(const WorldData::Portal& in_portal : world.portals)
+	{
+		size_t flat_axis= 3u;
+		size_t flat_axis_count= 0u;
+		for(size_t i= 0u; i < 3u; ++i)
+		{
+			if(in_portal.bb_min[i] == in_portal.bb_max[i])
+			{
+				flat_axis= i;
+				++flat_axis_count;
+			}
+		}
+		if(flat_axis_count != 1u)
+			continue;
+
+		Portal out_portal;
+		out_portal.bb_min= m_Vec3(float(in_portal.bb_min[0]), float(in_portal.bb_min[1]), float(in_portal.bb_min[2]));
+		out_portal.bb_max= m_Vec3(float(in_portal.bb_max[0]), float(in_portal.bb_max[1]), float(in_portal.bb_max[2]));
+
+		const size_t axis_a= (flat_axis + 1u) % 3u;
+		const size_t axis_b= (flat_axis + 2u) % 3u;
+		for(size_t i= 0u; i < 4u; ++i)
+		{
+			float coord[3];
+			coord[flat_axis]= float(in_portal.bb_min[flat_axis]);
+			coord[axis_a]= float(i == 1u || i == 2u ? in_portal.bb_max[axis_a] : in_portal.bb_min[axis_a]);
+			coord[axis_b]= float(i >= 2u ? in_portal.bb_max[axis_b] : in_portal.bb_min[axis_b]);
+			out_portal.vertices[i]= m_Vec3(coord[0], coord[1], coord[2]);
+		}
 
-	// Create world vertex and index buffers.
-	const auto gpu_buffer_upload=
-	[&](const void* const buffer_data, const size_t buffer_size, const vk::Buffer dst_buffer)
+		const size_t portal_index= world_model.portals.size();
+		for(size_t s= 0u; s < world.sectors.size(); ++s)
+		{
+			const WorldData::Sector& sector= world.sectors[s];
+			if( in_portal.bb_min[0] >= sector.bb_min[0] && in_portal.bb_max[0] <= sector.bb_max[0] &&
+				in_portal.bb_min[1] >= sector.bb_min[1] && in_portal.bb_max[1] <= sector.bb_max[1] &&
+				in_portal.bb_min[2] >= sector.bb_min[2] && in_portal.bb_max[2] <= sector.bb_max[2])
+			{
+				out_portal.sectors.push_back(s);
+				world_model.sectors[s].portals.push_back(portal_index);
+			}
+		}
+
+		world_model.portals.push_back(std::move(out_portal));
+	}
+
+	// Group sectors into streaming pages. Grow each page from its first sector through portals (breadth-first), until page limits are reached.
+	size_t streaming_slot_count= 0u;
+	if(streaming)
 	{
-		size_t offset= 0u;
-		const size_t block_size= gpu_data_uploader_.GetMaxMemoryBlockSize();
-		while(offset < buffer_size)
+		WorldStreaming& out_streaming= world_model.streaming.emplace();
+		out_streaming.world_sectors= world.sectors;
+
+		const uint32_t no_page= std::numeric_limits<uint32_t>::max();
+		out_streaming.sectors_pages.resize(world_model.sectors.size(), no_page);
+		out_streaming.sectors_distances.resize(world_model.sectors.size(), c_streaming_infinite_distance);
+
+		std::vector<size_t> sectors_queue;
+		for(size_t s= 0u; s < world_model.sectors.size(); ++s)
 		{
-			const size_t request_size= std::min(block_size, buffer_size - offset);
-			const auto staging_buffer= gpu_data_uploader_.RequestMemory(request_size);
+			if(out_streaming.sectors_pages[s] != no_page)
+				continue;
 
-			std::memcpy(
-				reinterpret_cast<char*>(staging_buffer.buffer_data) + staging_buffer.buffer_offset,
-				reinterpret_cast<const char*>(buffer_data) + offset,
-				request_size);
+			const uint32_t page_index= uint32_t(out_streaming.pages.size());
+			out_streaming.pages.emplace_back();
+			StreamingPage& page= out_streaming.pages.back();
+			page.distance= c_streaming_infinite_distance;
 
-			staging_buffer.command_buffer.copyBuffer(
-				staging_buffer.buffer,
-				dst_buffer,
-				{ vk::BufferCopy(staging_buffer.buffer_offset, offset, request_size) });
-			offset+= request_size;
+			sectors_queue.clear();
+			sectors_queue.push_back(s);
+			for(size_t i= 0u; i < sectors_queue.size() && page.sectors.size() < c_streaming_page_max_sectors; ++i)
+			{
+				const size_t sector_index= sectors_queue[i];
+				if(out_streaming.sectors_pages[sector_index] != no_page ||
+					(!page.sectors.empty() && page.max_vertices + sectors_max_vertices[sector_index] > c_streaming_page_max_vertices))
+					continue;
+
+				out_streaming.sectors_pages[sector_index]= page_index;
+				page.sectors.push_back(sector_index);
+				page.max_vertices+= sectors_max_vertices[sector_index];
+				page.max_indices+= sectors_max_indices[sector_index];
+				page.max_draw_commands+= sectors_max_draw_commands[sector_index];
+
+				const SectorsBounds& bounds= world_model.sectors_bounds;
+				page.bb_min.x= std::min(page.bb_min.x, bounds.min_x[sector_index]);
+				page.bb_min.y= std::min(page.bb_min.y, bounds.min_y[sector_index]);
+				page.bb_min.z= std::min(page.bb_min.z, bounds.min_z[sector_index]);
+				page.bb_max.x= std::max(page.bb_max.x, bounds.max_x[sector_index]);
+				page.bb_max.y= std::max(page.bb_max.y, bounds.max_y[sector_index]);
+				page.bb_max.z= std::max(page.bb_max.z, bounds.max_z[sector_index]);
+
+				for(const size_t portal_index : world_model.sectors[sector_index].portals)
+				for(const size_t next_sector_index : world_model.portals[portal_index].sectors)
+				{
+					if(out_streaming.sectors_pages[next_sector_index] == no_page)
+						sectors_queue.push_back(next_sector_index);
+				}
+			}
+
+			out_streaming.slot_vertices= std::max(out_streaming.slot_vertices, page.max_vertices);
+			out_streaming.slot_indices= std::max(out_streaming.slot_indices, page.max_indices);
+			out_streaming.slot_draw_commands= std::max(out_streaming.slot_draw_commands, page.max_draw_commands);
 		}
-	};
+
+		// Vulkan requires sizes greater, than 0.
+		out_streaming.slot_vertices= std::max(out_streaming.slot_vertices, size_t(1u));
+		out_streaming.slot_indices= std::max(out_streaming.slot_indices, size_t(1u));
+		out_streaming.slot_draw_commands= std::max(out_streaming.slot_draw_commands, size_t(1u));
+
+		const int64_t max_slots= std::max(int64_t(1), settings_.GetOrSetInt("r_world_streaming_slots", 64));
+		streaming_slot_count= std::max(size_t(1u), std::min(out_streaming.pages.size(), size_t(max_slots)));
+		out_streaming.slot_count= streaming_slot_count;
+		for(size_t i= 0u; i < streaming_slot_count; ++i)
+			out_streaming.free_slots.push_back(uint32_t(streaming_slot_count - 1u - i)); // Allocate from back.
+
+		Log::Info(
+			"World streaming pages: ", out_streaming.pages.size(),
+			", slots: ", streaming_slot_count,
+			", slot size: ", out_streaming.slot_vertices, " vertices, ", out_streaming.slot_indices, " indices");
+	}
+
+	// Quantize positions relative to boxes of sectors. Consecutive sectors share box, if there are too many sectors.
+	// All boxes use same step, which is power of two, and offsets of boxes are multiples of it.
+	// So, all positions are snapped to same lattice, and there are no cracks between sectors.
+	if(instanced_segments_)
+	{
+		// Positions are already quantized, transformations of instances produce world space positions.
+		world_model.vertex_pos_step= 1.0f;
+		world_model.vertex_pos_boxes.emplace_back(0.0f, 0.0f, 0.0f);
+	}
+	else
+	{
+		const size_t sector_count= world_model.sectors.size();
+		while(((sector_count + (size_t(1u) << world_model.vertex_pos_box_sectors_log2) - 1u) >> world_model.vertex_pos_box_sectors_log2) > c_max_vertex_pos_boxes)
+			++world_model.vertex_pos_box_sectors_log2;
+		const size_t box_count= std::max(size_t(1u), (sector_count + (size_t(1u) << world_model.vertex_pos_box_sectors_log2) - 1u) >> world_model.vertex_pos_box_sectors_log2);
+
+		// In streaming mode geometry is not built yet, so, estimated bounds of sectors are used.
+		std::vector<m_Vec3>& boxes_min= world_model.vertex_pos_boxes;
+		std::vector<m_Vec3> boxes_max;
+		boxes_min.resize(box_count, m_Vec3(+1e24f, +1e24f, +1e24f));
+		boxes_max.resize(box_count, m_Vec3(-1e24f, -1e24f, -1e24f));
+		const SectorsBounds& bounds= world_model.sectors_bounds;
+		for(size_t s= 0u; s < sector_count; ++s)
+		{
+			const size_t box_index= s >> world_model.vertex_pos_box_sectors_log2;
+			boxes_min[box_index].x= std::min(boxes_min[box_index].x, bounds.min_x[s]);
+			boxes_min[box_index].y= std::min(boxes_min[box_index].y, bounds.min_y[s]);
+			boxes_min[box_index].z= std::min(boxes_min[box_index].z, bounds.min_z[s]);
+			boxes_max[box_index].x= std::max(boxes_max[box_index].x, bounds.max_x[s]);
+			boxes_max[box_index].y= std::max(boxes_max[box_index].y, bounds.max_y[s]);
+			boxes_max[box_index].z= std::max(boxes_max[box_index].z, bounds.max_z[s]);
+		}
+
+		float max_box_size= 0.0f;
+		float max_abs_coord= 0.0f;
+		for(size_t b= 0u; b < box_count; ++b)
+		{
+			if(boxes_min[b].x > boxes_max[b].x)
+				boxes_min[b]= boxes_max[b]= m_Vec3(0.0f, 0.0f, 0.0f);
+
+			max_box_size= std::max(max_box_size, std::max(boxes_max[b].x - boxes_min[b].x, std::max(boxes_max[b].y - boxes_min[b].y, boxes_max[b].z - boxes_min[b].z)));
+			max_abs_coord= std::max(max_abs_coord, std::max(std::abs(boxes_min[b].x), std::abs(boxes_max[b].x)));
+			max_abs_coord= std::max(max_abs_coord, std::max(std::abs(boxes_min[b].y), std::abs(boxes_max[b].y)));
+			max_abs_coord= std::max(max_abs_coord, std::max(std::abs(boxes_min[b].z), std::abs(boxes_max[b].z)));
+		}
+
+		// Select minimal step, with which largest box fits into quantized range (with one step reserved for rounding of box offset),
+		// and dequantized positions are exact in float.
+		float step= 1.0f / 65536.0f;
+		while(step * (c_max_quantized_pos - 1.0f) < max_box_size || step * (c_max_exact_vertex_pos_steps - c_max_quantized_pos - 1.0f) <= max_abs_coord)
+			step*= 2.0f;
+		world_model.vertex_pos_step= step;
+
+		for(m_Vec3& box_offset : boxes_min)
+		{
+			box_offset.x= std::floor(box_offset.x / step) * step;
+			box_offset.y= std::floor(box_offset.y / step) * step;
+			box_offset.z= std::floor(box_offset.z / step) * step;
+		}
+
+		Log::Info("World vertex positions quantization step: ", step, ", boxes: ", box_count, " (", size_t(1u) << world_model.vertex_pos_box_sectors_log2, " sectors per box)");
+		if(step > c_max_vertex_pos_step)
+			Log::FatalError("World vertex positions quantization step ", step, " exceeds limit ", c_max_vertex_pos_step, ", sectors are too large");
+
+		for(size_t s= 0u; s < sectors_vertices.size(); ++s)
+		{
+			const size_t box_index= s >> world_model.vertex_pos_box_sectors_log2;
+			QuantizeVerticesPositions(
+				geometry.vertices_pos.data() + sectors_vertices[s].first,
+				sectors_vertices[s].second - sectors_vertices[s].first,
+				world_model.vertex_pos_boxes[box_index],
+				step,
+				uint32_t(box_index),
+				geometry.vertices_pos_packed.data() + sectors_vertices[s].first);
+		}
+	}
+
+	Log::Info("World sectors: ", world_model.sectors.size());
+	if(!streaming)
+	{
+		const size_t world_triangle_count= std::max(geometry.indices.size() / 3u, size_t(1u));
+		Log::Info("World LOD triangles: ", geometry.lods_triangle_count);
+		if(instanced_segments_)
+			Log::Info("World segment instances: ", world_instances.size(), " (", world_instances.size() * sizeof(WorldInstance) / 1024u, "KB)");
+		else
+		{
+			Log::Info("World vertices welded: ", geometry.vertices_before_weld, " -> ", geometry.vertices_pos.size());
+			Log::Info("World ACMR (cache size ", c_stats_vertex_cache_size, "): ", float(geometry.cache_misses_before) / float(world_triangle_count), " -> ", float(geometry.cache_misses_after) / float(world_triangle_count));
+		}
+		Log::Info("World vertices: ", geometry.vertices_pos_packed.size(), " (", geometry.vertices_pos_packed.size() * (sizeof(WorldVertexPos) + sizeof(WorldVertexAttributes)) / 1024u / 1024u, "MB)");
+	}
+
+	// Use 16-bit indices if possible, switch to 32-bit indices only for models with large triangle groups.
+	// Indices are relative to first vertex of triangle group, so total model size doesn't matter.
+	// In streaming mode triangle group can't be larger, than slot.
+	// Vulkan guarantees support of index values up to 2^24 - 1 without "fullDrawIndexUint32" feature.
+	if(streaming)
+		geometry.max_index= uint32_t(world_model.streaming->slot_vertices - 1u);
+	KK_ASSERT(geometry.max_index < (1u << 24u) - 1u);
+	const size_t index_size= geometry.max_index < 65535u ? sizeof(uint16_t) : sizeof(uint32_t);
+	world_model.index_type= index_size == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+
+	if(!streaming)
+		Log::Info("Worl triangles: ", geometry.indices.size() / 3u, " (", geometry.indices.size() * index_size / 1024u / 1024u, "MB, ", index_size * 8u, "-bit indices)");
 
 	// Vulkan requires sizes greater, than 0.
-	if(world_vertices.empty())
-		world_vertices.emplace_back();
-	if(world_indeces.empty())
-		world_indeces.emplace_back();
+	if(geometry.vertices_pos_packed.empty())
+		geometry.vertices_pos_packed.emplace_back();
+	if(geometry.vertices_attributes.empty())
+		geometry.vertices_attributes.emplace_back();
+	if(instanced_segments_ && world_instances.empty())
+		world_instances.emplace_back();
+	if(geometry.indices.empty())
+		geometry.indices.emplace_back();
+
+	std::vector<uint16_t> world_indeces_16;
+	if(world_model.index_type == vk::IndexType::eUint16 && !streaming)
+		world_indeces_16.assign(geometry.indices.begin(), geometry.indices.end());
+
+	// In streaming mode buffers are only allocated. They are filled later by pages.
+	const size_t vertex_count= streaming ? streaming_slot_count * world_model.streaming->slot_vertices : geometry.vertices_pos_packed.size();
+	const size_t index_count= streaming ? streaming_slot_count * world_model.streaming->slot_indices : geometry.indices.size();
+
+	{ // Create vertex buffers - one for each stream, and instances buffer.
+		const std::pair<vk::UniqueBuffer*, vk::UniqueDeviceMemory*> buffers[]
+		{
+			{ &world_model.vertex_pos_buffer, &world_model.vertex_pos_buffer_memory },
+			{ &world_model.vertex_attributes_buffer, &world_model.vertex_attributes_buffer_memory },
+			{ &world_model.instance_buffer, &world_model.instance_buffer_memory },
+		};
+		const std::pair<const void*, size_t> buffers_data[]
+		{
+			{ streaming ? nullptr : geometry.vertices_pos_packed.data(), vertex_count * sizeof(WorldVertexPos) },
+			{ streaming ? nullptr : geometry.vertices_attributes.data(), vertex_count * sizeof(WorldVertexAttributes) },
+			{ world_instances.data(), world_instances.size() * sizeof(WorldInstance) },
+		};
+
+		for(size_t b= 0u; b < std::size(buffers); ++b)
+		{
+			if(buffers_data[b].second == 0u)
+				continue; // Instances buffer is not needed for baked segments.
+
+			vk::UniqueBuffer& buffer= *buffers[b].first;
+			buffer=
+				vk_device_.createBufferUnique(
+					vk::BufferCreateInfo(
+						vk::BufferCreateFlags(),
+						buffers_data[b].second,
+						vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst));
+
+			const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*buffer);
+
+			vk::MemoryAllocateInfo vk_memory_allocate_info(buffer_memory_requirements.size);
+			for(uint32_t i= 0u; i < memory_properties_.memoryTypeCount; ++i)
+			{
+				if((buffer_memory_requirements.memoryTypeBits & (1u << i)) != 0 &&
+					(memory_properties_.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal) != vk::MemoryPropertyFlags())
+					vk_memory_allocate_info.memoryTypeIndex= i;
+			}
+
+			vk::UniqueDeviceMemory& memory= *buffers[b].second;
+			memory= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
+			vk_device_.bindBufferMemory(*buffer, *memory, 0u);
+
+			if(buffers_data[b].first != nullptr)
+				UploadBufferData(*buffer, 0u, buffers_data[b].first, buffers_data[b].second);
+		}
+	}
 
 	{
-		world_model.vertex_buffer=
+		world_model.index_buffer=
 			vk_device_.createBufferUnique(
 				vk::BufferCreateInfo(
 					vk::BufferCreateFlags(),
-					world_vertices.size() * sizeof(WorldVertex),
-					vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst));
+					index_count * index_size,
+					vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst));
 
-		const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*world_model.vertex_buffer);
+		const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*world_model.index_buffer);
 
 		vk::MemoryAllocateInfo vk_memory_allocate_info(buffer_memory_requirements.size);
 		for(uint32_t i= 0u; i < memory_properties_.memoryTypeCount; ++i)
@@ -1317,21 +3910,39 @@ WorldRenderer::WorldModel WorldRenderer::LoadWorld(const WorldData::World& world
 				vk_memory_allocate_info.memoryTypeIndex= i;
 		}
 
-		world_model.vertex_buffer_memory= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
-		vk_device_.bindBufferMemory(*world_model.vertex_buffer, *world_model.vertex_buffer_memory, 0u);
+		world_model.index_buffer_memory= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
+		vk_device_.bindBufferMemory(*world_model.index_buffer, *world_model.index_buffer_memory, 0u);
 
-		gpu_buffer_upload(world_vertices.data(), world_vertices.size() * sizeof(WorldVertex), *world_model.vertex_buffer);
+		if(!streaming)
+		{
+			if(world_model.index_type == vk::IndexType::eUint16)
+				UploadBufferData(*world_model.index_buffer, 0u, world_indeces_16.data(), world_indeces_16.size() * sizeof(uint16_t));
+			else
+				UploadBufferData(*world_model.index_buffer, 0u, geometry.indices.data(), geometry.indices.size() * sizeof(uint32_t));
+		}
 	}
 
+	// Create draw commands buffer. Commands of each sector are contiguous, sector has commands list for each global level of detail.
 	{
-		world_model.index_buffer=
+		std::vector<vk::DrawIndexedIndirectCommand> draw_commands;
+		if(!streaming)
+		{
+			for(Sector& sector : world_model.sectors)
+				BuildSectorDrawCommands(sector, 0u, draw_commands);
+		}
+		if(draw_commands.empty())
+			draw_commands.emplace_back();
+
+		const size_t command_count= streaming ? streaming_slot_count * world_model.streaming->slot_draw_commands : draw_commands.size();
+
+		world_model.draw_commands_buffer=
 			vk_device_.createBufferUnique(
 				vk::BufferCreateInfo(
 					vk::BufferCreateFlags(),
-					world_indeces.size() * sizeof(uint16_t),
-					vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst));
+					command_count * sizeof(vk::DrawIndexedIndirectCommand),
+					vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst));
 
-		const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*world_model.index_buffer);
+		const vk::MemoryRequirements buffer_memory_requirements= vk_device_.getBufferMemoryRequirements(*world_model.draw_commands_buffer);
 
 		vk::MemoryAllocateInfo vk_memory_allocate_info(buffer_memory_requirements.size);
 		for(uint32_t i= 0u; i < memory_properties_.memoryTypeCount; ++i)
@@ -1341,15 +3952,220 @@ WorldRenderer::WorldModel WorldRenderer::LoadWorld(const WorldData::World& world
 				vk_memory_allocate_info.memoryTypeIndex= i;
 		}
 
-		world_model.index_buffer_memory= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
-		vk_device_.bindBufferMemory(*world_model.index_buffer, *world_model.index_buffer_memory, 0u);
+		world_model.draw_commands_buffer_memory= vk_device_.allocateMemoryUnique(vk_memory_allocate_info);
+		vk_device_.bindBufferMemory(*world_model.draw_commands_buffer, *world_model.draw_commands_buffer_memory, 0u);
+
+		if(!streaming)
+			UploadBufferData(*world_model.draw_commands_buffer, 0u, draw_commands.data(), draw_commands.size() * sizeof(vk::DrawIndexedIndirectCommand));
+	}
+
+	// Prepare triangle groups for GPU culling. Sort them by material, in order to draw all groups of same material via single call.
+	{
+		std::vector<std::pair<const Sector::TriangleGroup*, uint32_t>> triangle_groups; // Group, sector index.
+		for(size_t s= 0u; s < world_model.sectors.size(); ++s)
+		for(const Sector::TriangleGroup& triangle_group : world_model.sectors[s].triangle_groups)
+			triangle_groups.emplace_back(&triangle_group, uint32_t(s));
+
+		std::stable_sort(
+			triangle_groups.begin(),
+			triangle_groups.end(),
+			[](const auto& l, const auto& r)
+			{
+				return l.first->material_index < r.first->material_index;
+			});
+
+		for(const auto& triangle_group_pair : triangle_groups)
+		{
+			const Sector::TriangleGroup& triangle_group= *triangle_group_pair.first;
+
+			if(world_model.material_triangle_groups.empty() ||
+				world_model.material_triangle_groups.back().material_index != triangle_group.material_index)
+				world_model.material_triangle_groups.push_back(
+					MaterialTriangleGroups{ triangle_group.material_index, uint32_t(world_model.gpu_triangle_groups.size()), 0u });
+			++world_model.material_triangle_groups.back().triangle_group_count;
+
+			TriangleGroupsCullerGPU::TriangleGroupDescription out_triangle_group{};
+			out_triangle_group.bb_min[0]= triangle_group.bb_min.x;
+			out_triangle_group.bb_min[1]= triangle_group.bb_min.y;
+			out_triangle_group.bb_min[2]= triangle_group.bb_min.z;
+			out_triangle_group.bb_max[0]= triangle_group.bb_max.x;
+			out_triangle_group.bb_max[1]= triangle_group.bb_max.y;
+			out_triangle_group.bb_max[2]= triangle_group.bb_max.z;
+			out_triangle_group.index_count= triangle_group.index_count;
+			out_triangle_group.first_index= triangle_group.first_index;
+			out_triangle_group.vertex_offset= int32_t(triangle_group.first_vertex);
+			out_triangle_group.sector_index= triangle_group_pair.second;
+			out_triangle_group.instance_count= triangle_group.instance_count;
+			for(uint32_t i= 0u; i < triangle_group.lod_count; ++i)
+			{
+				out_triangle_group.lods_first_index[i]= triangle_group.lods[i].first_index;
+				out_triangle_group.lods_index_count[i]= triangle_group.lods[i].index_count;
+				out_triangle_group.lods_error[i]= triangle_group.lods[i].error;
+			}
+			out_triangle_group.lod_count= triangle_group.lod_count;
+			// Pass material index for bindless textures. Non-zero first instance is allowed only if feature is enabled.
+			if(instanced_segments_)
+				out_triangle_group.first_instance= triangle_group.first_instance;
+			else if(draw_indirect_first_instance_supported_)
+				out_triangle_group.first_instance= triangle_group.material_index;
+			world_model.gpu_triangle_groups.push_back(out_triangle_group);
+		}
+	}
+
+	// Build spatial index of sectors.
+	{
+		const SectorsBounds& bounds= world_model.sectors_bounds;
+		std::vector<m_Vec3> boxes_min, boxes_max;
+		for(size_t i= 0u; i < bounds.min_x.size(); ++i)
+		{
+			boxes_min.emplace_back(bounds.min_x[i], bounds.min_y[i], bounds.min_z[i]);
+			boxes_max.emplace_back(bounds.max_x[i], bounds.max_y[i], bounds.max_z[i]);
+		}
+		world_model.sectors_grid.emplace(boxes_min.data(), boxes_max.data(), boxes_min.size());
+
+		const SpatialGrid& grid= *world_model.sectors_grid;
+		Log::Info(
+			"Sectors grid: ", grid.GetSize()[0], "x", grid.GetSize()[1], "x", grid.GetSize()[2],
+			", cell size ", grid.GetCellSize(),
+			", cells elements ", grid.GetCellsElementsCount());
+	}
 
-		gpu_buffer_upload(world_indeces.data(), world_indeces.size() * sizeof(uint16_t), *world_model.index_buffer);
+	// Build grid of static lights.
+	{
+		std::vector<m_Vec3> lights_centers;
+		std::vector<float> lights_radii;
+		m_Vec3 bb_min(+1e24f, +1e24f, +1e24f);
+		m_Vec3 bb_max(-1e24f, -1e24f, -1e24f);
+		for(Sector& sector : world_model.sectors)
+		{
+			sector.first_light_index= uint32_t(lights_centers.size());
+			for(const Sector::Light& light : sector.lights)
+			{
+				lights_centers.push_back(light.pos);
+				lights_radii.push_back(light.radius);
+			}
+
+			bb_min.x= std::min(bb_min.x, sector.bb_min.x);
+			bb_min.y= std::min(bb_min.y, sector.bb_min.y);
+			bb_min.z= std::min(bb_min.z, sector.bb_min.z);
+			bb_max.x= std::max(bb_max.x, sector.bb_max.x);
+			bb_max.y= std::max(bb_max.y, sector.bb_max.y);
+			bb_max.z= std::max(bb_max.z, sector.bb_max.z);
+		}
+		if(world_model.sectors.empty())
+			bb_min= bb_max= m_Vec3(0.0f, 0.0f, 0.0f);
+
+		world_model.static_lights_grid.emplace(bb_min, bb_max, lights_centers.data(), lights_radii.data(), lights_centers.size());
+
+		const StaticLightsGrid& grid= *world_model.static_lights_grid;
+		Log::Info(
+			"Static lights grid: ", grid.GetSize()[0], "x", grid.GetSize()[1], "x", grid.GetSize()[2],
+			", cell size ", grid.GetCellSize(),
+			", lights ", grid.GetLightCount(),
+			", lists elements ", grid.GetListsElementsCount());
 	}
 
 	return world_model;
 }
 
+void WorldRenderer::UploadStaticLights(const vk::CommandBuffer command_buffer, const WorldModel& model)
+{
+	const StaticLightsGrid& grid= *model.static_lights_grid;
+
+	// Light parameters are same, as in lights buffer. Shadowmap indices are stored separately.
+	std::vector<LightBuffer::Light> lights;
+	lights.reserve(grid.GetLightCount());
+	for(const Sector& sector : model.sectors)
+	for(const Sector::Light& light : sector.lights)
+	{
+		LightBuffer::Light out_light;
+		out_light.pos[0]= light.pos.x;
+		out_light.pos[1]= light.pos.y;
+		out_light.pos[2]= light.pos.z;
+		out_light.pos[3]= 1.0f / (light.radius * light.radius); // Fade to zero at radius.
+		out_light.color[0]= light.color.x;
+		out_light.color[1]= light.color.y;
+		out_light.color[2]= light.color.z;
+		out_light.color[3]= 0.0f;
+		out_light.data[0]= 1.0f / light.radius;
+		out_light.data[1]= light.radius;
+		out_light.shadowmap_index[0]= 0;
+		out_light.shadowmap_index[1]= 0;
+		lights.push_back(out_light);
+	}
+	KK_ASSERT(lights.size() == grid.GetLightCount());
+
+	StaticLightsGridBufferHeader header;
+	header.size[0]= grid.GetSize()[0];
+	header.size[1]= grid.GetSize()[1];
+	header.size[2]= grid.GetSize()[2];
+	header.size[3]= 0u;
+	header.start[0]= grid.GetStart().x;
+	header.start[1]= grid.GetStart().y;
+	header.start[2]= grid.GetStart().z;
+	header.inverse_cell_size= 1.0f / grid.GetCellSize();
+
+	const auto update_buffer=
+	[&](const vk::Buffer buffer, const size_t buffer_offset, const void* const data, const size_t size)
+	{
+		for(size_t offset= 0u; offset < size; offset+= c_max_update_buffer_size)
+			command_buffer.updateBuffer(
+				buffer,
+				buffer_offset + offset,
+				std::min(c_max_update_buffer_size, size - offset),
+				static_cast<const uint8_t*>(data) + offset);
+	};
+
+	update_buffer(*static_lights_buffer_, 0u, lights.data(), lights.size() * sizeof(LightBuffer::Light));
+	update_buffer(*static_lights_grid_buffer_, 0u, &header, sizeof(header));
+	update_buffer(*static_lights_grid_buffer_, sizeof(header), grid.GetData().data(), grid.GetData().size() * sizeof(StaticLightsGrid::DataWord));
+
+	// Initially no sectors are visible.
+	static_lights_shadowmap_indices_.clear();
+	static_lights_shadowmap_indices_.resize(lights.size(), c_static_light_invisible_sector);
+	static_lights_shadowmap_indices_changed_.clear();
+	static_lights_shadowmap_sectors_.clear();
+	static_lights_for_shadowmaps_.clear();
+	update_buffer(*static_lights_shadowmaps_buffer_, 0u, static_lights_shadowmap_indices_.data(), static_lights_shadowmap_indices_.size() * sizeof(uint32_t));
+}
+
+void WorldRenderer::SetStaticLightShadowmapIndex(const size_t light_index, const uint32_t shadowmap_index)
+{
+	if(static_lights_shadowmap_indices_[light_index] == shadowmap_index)
+		return;
+
+	static_lights_shadowmap_indices_[light_index]= shadowmap_index;
+	static_lights_shadowmap_indices_changed_.push_back(uint32_t(light_index));
+}
+
+void WorldRenderer::UploadStaticLightsShadowmapIndices(const vk::CommandBuffer command_buffer)
+{
+	std::sort(static_lights_shadowmap_indices_changed_.begin(), static_lights_shadowmap_indices_changed_.end());
+
+	// Upload ranges of consecutive changed indices.
+	for(size_t range_start= 0u; range_start < static_lights_shadowmap_indices_changed_.size();)
+	{
+		const uint32_t first_index= static_lights_shadowmap_indices_changed_[range_start];
+		size_t range_end= range_start + 1u;
+		while(
+			range_end < static_lights_shadowmap_indices_changed_.size() &&
+			static_lights_shadowmap_indices_changed_[range_end] <= static_lights_shadowmap_indices_changed_[range_end - 1u] + 1u &&
+			(static_lights_shadowmap_indices_changed_[range_end] - first_index + 1u) * sizeof(uint32_t) <= c_max_update_buffer_size)
+			++range_end;
+
+		const uint32_t last_index= static_lights_shadowmap_indices_changed_[range_end - 1u];
+		command_buffer.updateBuffer(
+			*static_lights_shadowmaps_buffer_,
+			first_index * sizeof(uint32_t),
+			(last_index - first_index + 1u) * sizeof(uint32_t),
+			static_lights_shadowmap_indices_.data() + first_index);
+
+		range_start= range_end;
+	}
+
+	static_lights_shadowmap_indices_changed_.clear();
+}
+
 std::optional<WorldRenderer::SegmentModel> WorldRenderer::LoadSegmentModel(const std::string_view file_name)
 {
 	MemoryMappedFilePtr file_mapped= MemoryMappedFile::Create(file_name);
@@ -1372,13 +4188,10 @@ std::optional<WorldRenderer::SegmentModel> WorldRenderer::LoadSegmentModel(const
 	const auto* const in_materials= reinterpret_cast<const SegmentModelFormat::Material*>(file_data + header.materials_offset);
 	const auto* const in_lights= reinterpret_cast<const SegmentModelFormat::Light*>(file_data + header.lights_offset);
 
-	std::vector<std::string> local_to_global_material_id;
-	local_to_global_material_id.resize(header.material_count);
-	for(size_t i= 0u; i < local_to_global_material_id.size(); ++i)
-	{
-		local_to_global_material_id[i]= in_materials[i].name;
-		LoadMaterial(local_to_global_material_id[i]);
-	}
+	std::vector<MaterialIndex> local_to_global_material_index;
+	local_to_global_material_index.resize(header.material_count);
+	for(size_t i= 0u; i < local_to_global_material_index.size(); ++i)
+		local_to_global_material_index[i]= LoadMaterial(in_materials[i].name);
 
 	return
 		SegmentModel
@@ -1389,31 +4202,32 @@ std::optional<WorldRenderer::SegmentModel> WorldRenderer::LoadSegmentModel(const
 			in_indices,
 			in_triangle_groups,
 			in_lights,
-			std::move(local_to_global_material_id)
+			std::move(local_to_global_material_index)
 		};
 }
 
-void WorldRenderer::LoadMaterial(const std::string& material_name)
+WorldRenderer::MaterialIndex WorldRenderer::LoadMaterial(const std::string& material_name)
 {
-	if(materials_.count(material_name) > 0)
-		return;
-
-	Material& out_material= materials_[material_name];
-
-	out_material.albedo_image_id= material_name + "_albedo";
-	LoadImage(out_material.albedo_image_id);
+	const auto it= materials_indices_.find(material_name);
+	if(it != materials_indices_.end())
+		return it->second;
 
-	out_material.normals_image_id= material_name + "_normal";
-	LoadImage(out_material.normals_image_id);
+	Material out_material;
+	out_material.albedo_image= LoadImage(material_name + "_albedo").value_or(stub_albedo_image_);
+	out_material.normals_image= LoadImage(material_name + "_normal").value_or(stub_normal_map_image_);
+	out_material.occlusion_image= LoadImage(material_name + "_orm").value_or(stub_occlusion_image_);
 
-	out_material.occlusion_image_id= material_name + "_orm";
-	LoadImage(out_material.occlusion_image_id);
+	const MaterialIndex material_index= MaterialIndex(materials_.size());
+	materials_.push_back(std::move(out_material));
+	materials_indices_.emplace(material_name, material_index);
+	return material_index;
 }
 
-void WorldRenderer::LoadImage(const std::string& image_name)
+std::optional<WorldRenderer::ImageIndex> WorldRenderer::LoadImage(const std::string& image_name)
 {
-	if(materials_.count(image_name) > 0)
-		return;
+	const auto it= images_indices_.find(image_name);
+	if(it != images_indices_.end())
+		return it->second;
 
 	ImageGPU out_image;
 
@@ -1422,7 +4236,7 @@ void WorldRenderer::LoadImage(const std::string& image_name)
 		const DDSImage& image= *dds_image_opt;
 		const std::vector<DDSImage::MipLevel>& mip_levels= image.GetMipLevels();
 		if(mip_levels.empty())
-			return;
+			return std::nullopt;
 
 		KK_ASSERT((mip_levels[0].size[0] & (mip_levels[0].size[0] - 1u)) == 0u);
 		KK_ASSERT((mip_levels[0].size[1] & (mip_levels[0].size[1] - 1u)) == 0u);
@@ -1704,36 +4518,12 @@ void WorldRenderer::LoadImage(const std::string& image_name)
 				vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0u, mip_levels, 0u, 1u)));
 	}
 	else
-		return;
-
-	images_[image_name]= std::move(out_image);
-}
-
-const WorldRenderer::ImageGPU& WorldRenderer::GetMaterialAlbedoImage(const Material& material)
-{
-	const auto it= images_.find(material.albedo_image_id);
-	if(it != images_.end())
-		return it->second;
-
-	return images_.find(stub_albedo_image_id_)->second;
-}
-
-const WorldRenderer::ImageGPU& WorldRenderer::GetMaterialNormalsImage(const Material& material)
-{
-	const auto it= images_.find(material.normals_image_id);
-	if(it != images_.end())
-		return it->second;
-
-	return images_.find(stub_normal_map_image_id_)->second;
-}
-
-const WorldRenderer::ImageGPU& WorldRenderer::GetMaterialOcclusionImage(const Material& material)
-{
-	const auto it= images_.find(material.occlusion_image_id);
-	if(it != images_.end())
-		return it->second;
+		return std::nullopt;
 
-	return images_.find(stub_occlusion_image_id_)->second;
+	const ImageIndex image_index= ImageIndex(images_.size());
+	images_.push_back(std::move(out_image));
+	images_indices_.emplace(image_name, image_index);
+	return image_index;
 }
 
 void WorldRenderer::ComandTestLightAdd(const CommandsArguments& args)
@@ -1757,4 +4547,54 @@ void WorldRenderer::CommandTestLightRemove()
 	test_light_= std::nullopt;
 }
 
+void WorldRenderer::CommandCullingStats()
+{
+	Log::Info("Frustum culled sectors: ", frustum_culled_sectors_);
+	if(settings_.GetInt("r_gpu_culling", 0) != 0 && triangle_groups_culler_has_all_groups_)
+		Log::Info("Triangle groups are culled on GPU");
+	else
+		Log::Info("Frustum culled triangle groups: ", frustum_culled_triangle_groups_, ", tested: ", frustum_tested_triangle_groups_, ", drawn: ", visible_triangle_groups_.size());
+	Log::Info("Material binds in main pass: ", main_pass_material_binds_);
+}
+
+void WorldRenderer::CommandWorldStreamingStats()
+{
+	if(world_model_.streaming == std::nullopt)
+	{
+		Log::Info("World streaming is disabled");
+		return;
+	}
+
+	const WorldStreaming& streaming= *world_model_.streaming;
+	size_t pages_loaded= 0u;
+	size_t pages_building= 0u;
+	for(const StreamingPage& page : streaming.pages)
+	{
+		if(page.slot != std::nullopt)
+			++pages_loaded;
+		else if(page.build_result != nullptr)
+			++pages_building;
+	}
+
+	Log::Info("Streaming pages loaded: ", pages_loaded, ", building: ", pages_building, ", total: ", streaming.pages.size());
+	Log::Info("Free slots: ", streaming.free_slots.size(), ", released slots: ", streaming.released_slots.size());
+	Log::Info("Pages uploaded: ", streaming.pages_uploaded_total, ", evicted: ", streaming.pages_evicted_total);
+}
+
+void WorldRenderer::CommandClustersStats()
+{
+	Log::Info("Clusters: ", cluster_volume_builder_.GetOffsets().size());
+	Log::Info("Lights list element size: ", cluster_volume_builder_.GetElementSize(), ", max lights: ", std::min(LightBuffer::c_max_lights, cluster_volume_builder_.GetMaxElements()));
+
+	// Lists are built on CPU only in CPU and comparison modes.
+	if(settings_.GetInt("r_clusters_gpu", 1) == 1 || settings_.GetInt("r_lights_z_binning", 0) != 0)
+		Log::Info("Lights list size and refinement stats are not available - lists are not built on CPU in current mode");
+	else
+	{
+		Log::Info("Lights list size: ", cluster_volume_builder_.GetElementsListSize(), " of ", cluster_volume_builder_.GetElementsListCapacity());
+		Log::Info("Light-cluster pairs, removed by refinement: ", cluster_volume_builder_.GetRefinementRemovedElementsCount());
+	}
+	Log::Info("Lights builds skipped (view and lights unchanged): ", lights_builds_skipped_, " of ", lights_builds_total_, " frames");
+}
+
 } // namespace KK
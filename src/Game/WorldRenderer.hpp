@@ -2,16 +2,24 @@
 #include "../Common/MemoryMappedFile.hpp"
 #include "../Common/SegmentModelFormat.hpp"
 #include "../MathLib/Mat.hpp"
+#include "../MathLib/Plane.hpp"
 #include "AmbientOcclusionCalculator.hpp"
+#include "BackgroundTaskQueue.hpp"
 #include "CameraController.hpp"
 #include "CommandsProcessor.hpp"
 #include "ClusterVolumeBuilder.hpp"
+#include "ClusterVolumeBuilderGPU.hpp"
 #include "GPUDataUploader.hpp"
 #include "Shadowmapper.hpp"
 #include "ShadowmapAllocator.hpp"
+#include "SpatialGrid.hpp"
+#include "StaticLightsGrid.hpp"
 #include "Tonemapper.hpp"
+#include "TriangleGroupsCullerGPU.hpp"
 #include "WindowVulkan.hpp"
 #include "WorldGenerator.hpp"
+#include "ZBinsBuilder.hpp"
+#include <memory>
 #include <optional>
 #include <string>
 
@@ -43,13 +51,18 @@ private:
 		vk::UniqueDeviceMemory image_memory;
 	};
 
+	// Materials and images are identified by indices in arrays of registry. Names are used only during loading.
+	using ImageIndex= uint32_t;
+	using MaterialIndex= uint32_t;
+
 	struct Material
 	{
-		std::string albedo_image_id;
-		std::string normals_image_id;
-		std::string occlusion_image_id;
+		// Stub images are used instead of missing images.
+		ImageIndex albedo_image;
+		ImageIndex normals_image;
+		ImageIndex occlusion_image;
 
-		vk::UniqueDescriptorSet descriptor_set;
+		vk::UniqueDescriptorSet descriptor_set; // Null in bindless mode.
 	};
 
 	struct SegmentModel
@@ -60,7 +73,7 @@ private:
 		const SegmentModelFormat::IndexType* indices;
 		const SegmentModelFormat::TriangleGroup* triangle_groups;
 		const SegmentModelFormat::Light* lights;
-		std::vector<std::string> local_to_global_material_id;
+		std::vector<MaterialIndex> local_to_global_material_index;
 	};
 
 	using SegmentModels= std::unordered_map<WorldData::SegmentType, SegmentModel>;
@@ -69,10 +82,27 @@ private:
 	{
 		struct TriangleGroup
 		{
+			// Simplified version of group. Uses same vertices, but own indices.
+			struct Lod
+			{
+				uint32_t first_index;
+				uint32_t index_count;
+				float error; // Max distance of vertex movement.
+			};
+			static constexpr size_t c_max_lods= 2u;
+
 			uint32_t first_vertex;
 			uint32_t first_index;
 			uint32_t index_count;
-			std::string material_id;
+			MaterialIndex material_index;
+			m_Vec3 bb_min;
+			m_Vec3 bb_max;
+			// Range in instances buffer of model. For non-instanced geometry it is single instance with zero index.
+			uint32_t first_instance= 0u;
+			uint32_t instance_count= 1u;
+			// Levels of detail in order of error increasing. Full detail level is not included.
+			Lod lods[c_max_lods]{};
+			uint32_t lod_count= 0u;
 		};
 
 		struct Light
@@ -86,47 +116,195 @@ private:
 		m_Vec3 bb_max;
 		std::vector<TriangleGroup> triangle_groups;
 		std::vector<Light> lights;
+		uint32_t first_light_index= 0u; // In list of all lights of world.
+		// In draw commands buffer of model. Commands of all triangle groups of sector are contiguous.
+		// Sector has commands list for each global level of detail - full detail list, followed by lists for each LOD error.
+		uint32_t first_draw_command= 0u;
+		std::vector<size_t> portals;
 	};
 
 	using WorldSectors= std::vector<Sector>;
 
+	struct Portal
+	{
+		m_Vec3 vertices[4]; // Rectangle, vertices in order of rotation.
+		m_Vec3 bb_min;
+		m_Vec3 bb_max;
+		std::vector<size_t> sectors; // All sectors, which contain this portal. Usually two.
+	};
+
+	// Bounds of geometry of sectors, in SoA layout for fast culling.
+	struct SectorsBounds
+	{
+		std::vector<float> min_x, min_y, min_z;
+		std::vector<float> max_x, max_y, max_z;
+	};
+
+	// Range of triangle groups with same material.
+	struct MaterialTriangleGroups
+	{
+		MaterialIndex material_index;
+		uint32_t first_triangle_group;
+		uint32_t triangle_group_count;
+	};
+
+	// Geometry of baked sectors or instanced models. Defined in implementation file, because it contains GPU vertices.
+	struct SectorsGeometry;
+
+	// Result of page build in background thread. Defined in implementation file.
+	struct StreamingPageBuildResult;
+
+	// Group of sectors, connected via portals. Geometry of page is built and uploaded at once.
+	struct StreamingPage
+	{
+		std::vector<size_t> sectors;
+		// Upper bounds of geometry size, calculated from segment models.
+		size_t max_vertices= 0u;
+		size_t max_indices= 0u;
+		size_t max_draw_commands= 0u;
+		uint32_t distance= 0u; // Minimal distance from camera sector to sectors of page, in portals.
+		// Estimated bounds of geometry of sectors.
+		m_Vec3 bb_min{ +1e24f, +1e24f, +1e24f };
+		m_Vec3 bb_max{ -1e24f, -1e24f, -1e24f };
+		std::shared_ptr<StreamingPageBuildResult> build_result; // Non-null while page is building or built, but not uploaded yet.
+		std::optional<uint32_t> slot; // Slot in buffers of model for uploaded page.
+	};
+
+	// In streaming mode buffers of model are splitted into slots of equal size.
+	// Pages near camera are built in background and uploaded into free slots, far pages are evicted.
+	struct WorldStreaming
+	{
+		std::vector<WorldData::Sector> world_sectors; // Source data, used by background threads.
+		std::vector<StreamingPage> pages;
+		std::vector<uint32_t> sectors_pages; // Page of each sector.
+		std::vector<uint32_t> sectors_distances; // Distance from camera sector, in portals.
+		size_t slot_count= 0u;
+		// Slot capacity. Enough for largest page.
+		size_t slot_vertices= 0u;
+		size_t slot_indices= 0u;
+		size_t slot_draw_commands= 0u;
+		std::vector<uint32_t> free_slots;
+		// Slot of evicted page may be still used by previous frames. Reuse it only after some frames.
+		std::vector<std::pair<uint32_t, uint64_t>> released_slots; // Slot, frame of release.
+		uint64_t frame_number= 0u;
+		// Bounds of pages, uploaded or evicted during last update. Shadowmaps of lights, intersecting them, are redrawn.
+		std::vector< std::pair<m_Vec3, m_Vec3> > changed_pages_bounds;
+		// Cache containers.
+		std::vector<size_t> sectors_queue;
+		std::vector<uint32_t> pages_queue;
+		// Stats.
+		size_t pages_uploaded_total= 0u;
+		size_t pages_evicted_total= 0u;
+	};
+
 	struct WorldModel
 	{
 		WorldSectors world_sectors_;
-		vk::UniqueBuffer vertex_buffer;
-		vk::UniqueDeviceMemory vertex_buffer_memory;
+		// Vertices are splitted into two streams - positions and other attributes.
+		vk::UniqueBuffer vertex_pos_buffer;
+		vk::UniqueDeviceMemory vertex_pos_buffer_memory;
+		vk::UniqueBuffer vertex_attributes_buffer;
+		vk::UniqueDeviceMemory vertex_attributes_buffer_memory;
+		vk::UniqueBuffer instance_buffer; // Transformations of segments for instanced segments mode.
+		vk::UniqueDeviceMemory instance_buffer_memory;
+		// Vertex positions are quantized relative to boxes of sectors. World space position= pos * step + offset of box.
+		// Box of sector has index "sector_index >> vertex_pos_box_sectors_log2".
+		float vertex_pos_step= 1.0f;
+		std::vector<m_Vec3> vertex_pos_boxes; // Offsets of boxes.
+		uint32_t vertex_pos_box_sectors_log2= 0u;
+		uint32_t first_vertex_pos_box= 0u; // In boxes buffer of renderer.
 		vk::UniqueBuffer index_buffer;
 		vk::UniqueDeviceMemory index_buffer_memory;
+		vk::IndexType index_type= vk::IndexType::eUint16; // 32-bit indices are used only for large triangle groups.
+		vk::UniqueBuffer draw_commands_buffer; // Commands for all triangle groups, in order of sectors.
+		vk::UniqueDeviceMemory draw_commands_buffer_memory;
 		WorldSectors sectors;
+		SectorsBounds sectors_bounds;
+		std::optional<SpatialGrid> sectors_grid; // Over sectors bounds.
+		std::vector<Portal> portals;
+		std::optional<StaticLightsGrid> static_lights_grid; // For all lights of all sectors.
+		std::vector<TriangleGroupsCullerGPU::TriangleGroupDescription> gpu_triangle_groups; // All triangle groups, sorted by material.
+		std::vector<MaterialTriangleGroups> material_triangle_groups; // Ranges in "gpu_triangle_groups".
+		// Exists only for streamed model. Triangle groups of sectors are filled only for uploaded pages.
+		// GPU culling is not supported for streamed model.
+		std::optional<WorldStreaming> streaming;
 	};
 
 	using VisibleSectors= std::vector<size_t>;
 
+	// Part of view frustum, through which sector is visible. Planes are in world space, inner side is positive.
+	struct ClipFrustum
+	{
+		m_Plane3 planes[5]; // Left, right, bottom, top, near.
+	};
+
+	using SectorsClipFrustums= std::vector<ClipFrustum>; // For each sector of model. Valid only for visible sectors.
+
+	using VisibleTriangleGroups= std::vector<const Sector::TriangleGroup*>;
+
+	// Triangle groups, prepared for drawing and sorted by key.
+	struct DrawListElement
+	{
+		uint64_t sort_key;
+		const Sector::TriangleGroup* triangle_group;
+		// Indices of selected level of detail.
+		uint32_t first_index;
+		uint32_t index_count;
+	};
+
+	using DrawList= std::vector<DrawListElement>;
+
 	struct Pipeline
 	{
 		vk::UniqueShaderModule shader_vert;
 		vk::UniqueShaderModule shader_frag;
 		std::vector<vk::UniqueSampler> samplers;
-		vk::UniqueDescriptorSetLayout descriptor_set_layouts[2]; // 0 - globals, 1 - per-material
+		vk::UniqueDescriptorSetLayout descriptor_set_layouts[2]; // 0 - globals, 1 - per-material or bindless textures
 		vk::UniquePipelineLayout pipeline_layout;
 		vk::UniquePipeline pipeline;
+		vk::UniquePipeline pipeline_depth_write; // Optional. Same pipeline, but with depth write, for objects, missing in depth pre-pass.
 	};
 
 private:
+	// Traverse sectors graph through portals, starting from camera sector, and clip view by each portal.
+	void CalculateVisibleSectors(
+		const WorldModel& world_model,
+		const CameraController::ViewMatrix& view_matrix,
+		const m_Vec3& cam_pos,
+		VisibleSectors& out_visible_sectors,
+		SectorsClipFrustums& out_clip_frustums);
+
+	// Cull sectors by view frustum, after that cull triangle groups by clip frustums of sectors.
+	void CullTriangleGroups(
+		const WorldModel& world_model,
+		const CameraController::ViewMatrix& view_matrix,
+		const VisibleSectors& visible_sectors,
+		const SectorsClipFrustums& clip_frustums,
+		VisibleTriangleGroups& out_triangle_groups);
+
+	// Build draw lists from visible triangle groups.
+	// Depth pre-pass list is sorted front-to-back, main pass list is sorted by material, than front-to-back.
+	void BuildDrawLists(const VisibleTriangleGroups& visible_triangle_groups, const m_Vec3& cam_pos, float lod_max_error);
+
 	Pipeline CreateDepthPrePassPipeline();
 	Pipeline CreateLightingPassPipeline();
 
 	void DrawWorldModelDepthPrePass(
 		vk::CommandBuffer command_buffer,
 		const WorldModel& world_model,
-		const VisibleSectors& visible_sectors,
-		const m_Mat4& view_matrix);
+		const DrawList& draw_list,
+		const m_Mat4& view_matrix,
+		const TriangleGroupsCullerGPU* triangle_groups_culler, // If non-null, draw using culling result.
+		bool gpu_culling); // If true, culling result contains all groups of model, else - elements of main pass draw list.
 
 	void DrawWorldModelMainPass(
 		vk::CommandBuffer command_buffer,
 		const WorldModel& world_model,
-		const VisibleSectors& visible_sectors,
-		const m_Mat4& view_matrix);
+		const DrawList& draw_list,
+		const m_Mat4& view_matrix,
+		const TriangleGroupsCullerGPU* triangle_groups_culler, // If non-null, draw using culling result.
+		bool gpu_culling, // If true, culling result contains all groups of model, else - elements of main pass draw list.
+		bool occlusion_culling);
 
 	void DrawWorldModelToDepthCubemap(
 		vk::CommandBuffer command_buffer,
@@ -134,18 +312,53 @@ private:
 		const m_Vec3& light_pos,
 		float light_radius);
 
-	WorldModel LoadWorld(const WorldData::World& world, const SegmentModels& segment_models);
+	// Draw contiguous range of indirect commands. Uses single call, if possible.
+	void DrawIndexedIndirect(vk::CommandBuffer command_buffer, vk::Buffer buffer, vk::DeviceSize offset, size_t command_count);
+
+	// Evict far pages, upload built pages and start building of pages near camera. Returns true if geometry is changed.
+	bool UpdateWorldStreaming(vk::CommandBuffer command_buffer, WorldModel& world_model, const m_Vec3& cam_pos);
+	void UploadStreamingPage(WorldModel& world_model, StreamingPage& page, uint32_t slot);
+	void EvictStreamingPage(WorldModel& world_model, StreamingPage& page);
+
+	// Copy data into buffer via staging buffers of uploader.
+	void UploadBufferData(vk::Buffer dst_buffer, vk::DeviceSize dst_offset, const void* data, size_t size);
+
+	// Build geometry of baked segments of sector - weld vertices, optimize them for vertex cache, build levels of detail.
+	// Called from background threads in streaming mode.
+	static void BuildSectorGeometry(
+		const WorldData::Sector& in_sector,
+		const SegmentModels& segment_models,
+		SectorsGeometry& geometry,
+		std::vector<Sector::TriangleGroup>& out_triangle_groups);
+
+	// Build simplified versions of triangle group and append their indices into geometry.
+	// Indices and positions are relative to first vertex of group. Packed vertices of group must be already in geometry, starting from "first_vertex".
+	static void BuildTriangleGroupLods(
+		const uint32_t* indices,
+		size_t index_count,
+		const m_Vec3* vertices_pos,
+		size_t vertex_count,
+		size_t first_vertex,
+		SectorsGeometry& geometry,
+		Sector::TriangleGroup& out_triangle_group);
+
+	// Append commands lists of sector for each global level of detail.
+	static void BuildSectorDrawCommands(Sector& sector, uint32_t first_command, std::vector<vk::DrawIndexedIndirectCommand>& draw_commands);
+
+	WorldModel LoadWorld(const WorldData::World& world, const SegmentModels& segment_models, bool streaming);
+	void UploadStaticLights(vk::CommandBuffer command_buffer, const WorldModel& model);
+	void SetStaticLightShadowmapIndex(size_t light_index, uint32_t shadowmap_index);
+	void UploadStaticLightsShadowmapIndices(vk::CommandBuffer command_buffer);
 	std::optional<SegmentModel> LoadSegmentModel(std::string_view file_name);
 
-	void LoadMaterial(const std::string& material_name);
-	void LoadImage(const std::string& image_name);
-
-	const ImageGPU& GetMaterialAlbedoImage(const Material& material);
-	const ImageGPU& GetMaterialNormalsImage(const Material& material);
-	const ImageGPU& GetMaterialOcclusionImage(const Material& material);
+	MaterialIndex LoadMaterial(const std::string& material_name);
+	std::optional<ImageIndex> LoadImage(const std::string& image_name);
 
 	void ComandTestLightAdd(const CommandsArguments& args);
 	void CommandTestLightRemove();
+	void CommandClustersStats();
+	void CommandCullingStats();
+	void CommandWorldStreamingStats();
 
 private:
 	Settings& settings_;
@@ -155,6 +368,15 @@ private:
 	const vk::Extent2D viewport_size_;
 	const vk::PhysicalDeviceMemoryProperties memory_properties_;
 	const uint32_t queue_family_index_;
+	const bool multi_draw_indirect_supported_;
+	const bool draw_indirect_first_instance_supported_;
+
+	// In instanced segments mode each segment model is stored once and sectors contain instances of models.
+	// Otherwise all segments are baked into world geometry.
+	const bool instanced_segments_;
+
+	// In bindless mode textures of all materials are placed into single descriptor set, index of material is passed via instance index.
+	bool bindless_textures_= false;
 
 	CommandsMapConstPtr commands_map_;
 
@@ -162,7 +384,11 @@ private:
 	AmbientOcclusionCalculator ambient_occlusion_culculator_;
 	Shadowmapper shadowmapper_;
 	ClusterVolumeBuilder cluster_volume_builder_;
+	ZBinsBuilder z_bins_builder_;
+	std::optional<ClusterVolumeBuilderGPU> cluster_volume_builder_gpu_; // Created after buffers creation.
+	bool clusters_gpu_compare_pending_= false;
 	ShadowmapAllocator shadowmap_allocator_;
+	std::optional<TriangleGroupsCullerGPU> triangle_groups_culler_; // Created after models loading.
 
 	Pipeline depth_pre_pass_pipeline_;
 	Pipeline lighting_pass_pipeline_;
@@ -180,21 +406,97 @@ private:
 	vk::UniqueBuffer lights_list_buffer_;
 	vk::UniqueDeviceMemory lights_list_buffer_memory_;
 
+	// Depth bins and tiles masks, used in Z-binning mode.
+	vk::UniqueBuffer z_bins_buffer_;
+	vk::UniqueDeviceMemory z_bins_buffer_memory_;
+
+	// Static lights, grid of static lights lists and static lights shadowmap indices. Uploaded when model is changed.
+	vk::UniqueBuffer static_lights_buffer_;
+	vk::UniqueDeviceMemory static_lights_buffer_memory_;
+	vk::UniqueBuffer static_lights_grid_buffer_;
+	vk::UniqueDeviceMemory static_lights_grid_buffer_memory_;
+	vk::UniqueBuffer static_lights_shadowmaps_buffer_;
+	vk::UniqueDeviceMemory static_lights_shadowmaps_buffer_memory_;
+	const WorldModel* static_lights_uploaded_model_= nullptr;
+	// Uploaded shadowmap indices of static lights. Only changed indices are uploaded.
+	std::vector<uint32_t> static_lights_shadowmap_indices_;
+	std::vector<uint32_t> static_lights_shadowmap_indices_changed_;
+	// Sectors, which static lights have shadowmaps, and list of these lights. Rebuilt only if visible sectors are changed.
+	VisibleSectors static_lights_shadowmap_sectors_;
+	std::vector<ShadowmapLight> static_lights_for_shadowmaps_;
+
+	// Offsets of vertex positions quantization boxes of all models.
+	vk::UniqueBuffer vertex_pos_boxes_buffer_;
+	vk::UniqueDeviceMemory vertex_pos_boxes_buffer_memory_;
+
 	vk::UniqueDescriptorPool vk_descriptor_pool_;
 
+	// Vertex positions quantization boxes for depth pre-pass.
+	vk::UniqueDescriptorSet depth_pre_pass_descriptor_set_;
+
 	// All material-independent descriptors goes here.
 	vk::UniqueDescriptorSet global_descriptors_set_;
 
+	// Textures of all materials, used in bindless mode.
+	vk::UniqueDescriptorSet bindless_textures_descriptor_set_;
+
+	SegmentModels segment_models_; // Used by streaming after loading.
 	WorldModel world_model_;
 	WorldModel test_world_model_;
 
-	std::unordered_map<std::string, ImageGPU> images_;
-	std::unordered_map<std::string, Material> materials_;
-	std::string stub_albedo_image_id_;
-	std::string stub_normal_map_image_id_;
-	std::string stub_occlusion_image_id_;
+	// Assets registry.
+	std::vector<ImageGPU> images_;
+	std::vector<Material> materials_;
+	std::unordered_map<std::string, ImageIndex> images_indices_;
+	std::unordered_map<std::string, MaterialIndex> materials_indices_;
+	ImageIndex stub_albedo_image_= 0u;
+	ImageIndex stub_normal_map_image_= 0u;
+	ImageIndex stub_occlusion_image_= 0u;
 
 	std::optional<Sector::Light> test_light_;
+
+	// Cache lights container.
+	std::vector<const Sector::Light*> light_candidates_;
+	std::vector<const Sector::Light*> z_bins_lights_;
+
+	SectorsClipFrustums sectors_clip_frustums_;
+	std::vector<SpatialGrid::BoxIndex> sectors_query_result_;
+	VisibleTriangleGroups visible_triangle_groups_;
+	DrawList depth_pre_pass_draw_list_;
+	DrawList main_pass_draw_list_;
+	std::vector<uint64_t> shadow_sectors_sort_keys_;
+	std::vector<uint8_t> sectors_in_frustum_; // Flag for each sector.
+	std::vector<TriangleGroupsCullerGPU::SectorDescription> gpu_culling_sectors_;
+	const WorldModel* triangle_groups_culler_model_= nullptr; // Model, used for culling in previous frame.
+	bool triangle_groups_culler_has_all_groups_= false; // All groups of model are uploaded, not only draw list.
+	// Elements of main pass draw list, uploaded into culler for occlusion culling without GPU culling.
+	std::vector<TriangleGroupsCullerGPU::TriangleGroupDescription> draw_list_culler_triangle_groups_;
+	std::vector<MaterialTriangleGroups> draw_list_material_triangle_groups_; // Ranges in main pass draw list.
+
+	// Culling stats of last frame.
+	size_t frustum_culled_sectors_= 0u;
+	size_t frustum_culled_triangle_groups_= 0u;
+	size_t frustum_tested_triangle_groups_= 0u;
+	size_t main_pass_material_binds_= 0u;
+
+	// Parameters of last lights build. If they are unchanged, clusters and lights buffers on GPU are reused.
+	struct LightsBuildState
+	{
+		const WorldModel* model= nullptr;
+		m_Mat4 view_matrix;
+		float z_near= 0.0f;
+		float z_far= 0.0f;
+		float viewport_size[2]{ 0.0f, 0.0f };
+		uint32_t flags= 0u;
+		std::vector<Sector::Light> lights; // Copy of light candidates.
+		uint32_t light_count= 0u; // Number of lights in lights buffer.
+	};
+	LightsBuildState lights_build_state_;
+	uint64_t lights_builds_total_= 0u;
+	uint64_t lights_builds_skipped_= 0u;
+
+	// Builds pages of streamed world. Declared last in order to be destroyed first - tasks reference models.
+	std::optional<BackgroundTaskQueue> streaming_task_queue_;
 };
 
 } // namespace KK
@@ -0,0 +1,218 @@
+#include "ZBinsBuilder.hpp"
+#include "Assert.hpp"
+#include <algorithm>
+#include <limits>
+
+
+namespace KK
+{
+
+namespace
+{
+
+// If this changed, it must be changed in shader code too!
+float WMappingFunction(const m_Vec2& w_convert_values, const float w)
+{
+	return w_convert_values.x * std::log2(w_convert_values.y / w);
+}
+
+} // namespace
+
+ZBinsBuilder::ZBinsBuilder(
+	const uint32_t tiles_x,
+	const uint32_t tiles_y,
+	const uint32_t bin_count,
+	const size_t max_elements)
+	: tiles_x_(tiles_x)
+	, tiles_y_(tiles_y)
+	, bin_count_(bin_count)
+	, max_elements_(max_elements)
+	, bins_(bin_count, c_empty_bin)
+	, tile_masks_(tiles_x * tiles_y * ((max_elements + c_bits_in_mask_word - 1u) / c_bits_in_mask_word), 0u)
+{
+	KK_ASSERT(tiles_x <= std::numeric_limits<uint16_t>::max());
+	KK_ASSERT(tiles_y <= std::numeric_limits<uint16_t>::max());
+	// Indices are packed into 16 bits of bin.
+	KK_ASSERT(max_elements <= size_t(std::numeric_limits<ElementIndex>::max()));
+
+	elements_.reserve(max_elements);
+	sorted_elements_.reserve(max_elements);
+}
+
+void ZBinsBuilder::SetMatrix(const m_Mat4& mat, const float z_near, const float z_far)
+{
+	matrix_= mat;
+	z_near_= z_near;
+	z_far_= z_far;
+
+	// Use same logarithmical distribution, as in clusters volume.
+	w_convert_values_.x= float(bin_count_) / std::log2(z_near / z_far);
+	w_convert_values_.y= z_near;
+}
+
+void ZBinsBuilder::Clear()
+{
+	elements_.clear();
+	sorted_elements_.clear();
+}
+
+bool ZBinsBuilder::AddSphere(const m_Vec3& center, const float radius)
+{
+	if(elements_.size() >= max_elements_)
+		return false;
+
+	// Project bounding box of sphere, same as in clusters volume.
+	m_Vec2 bb_min(+1e24f, +1e24f);
+	m_Vec2 bb_max(-1e24f, -1e24f);
+	float w_min= +1e24f;
+	float w_max= -1e24f;
+	for(size_t i= 0u; i < 8u; ++i)
+	{
+		const m_Vec3 corner(
+			center.x + ((i & 4u) == 0u ? radius : -radius),
+			center.y + ((i & 2u) == 0u ? radius : -radius),
+			center.z + ((i & 1u) == 0u ? radius : -radius));
+
+		const m_Vec3 proj= corner * matrix_;
+		const float w=
+			matrix_.value[ 3] * corner.x +
+			matrix_.value[ 7] * corner.y +
+			matrix_.value[11] * corner.z +
+			matrix_.value[15];
+
+		bb_min.x= std::min(bb_min.x, proj.x);
+		bb_min.y= std::min(bb_min.y, proj.y);
+		bb_max.x= std::max(bb_max.x, proj.x);
+		bb_max.y= std::max(bb_max.y, proj.y);
+		w_min= std::min(w_min, w);
+		w_max= std::max(w_max, w);
+	}
+
+	// Clamp values - logarith function exists only for positive numbers.
+	w_min= std::max(w_min, 0.0001f);
+	w_max= std::max(w_max, 0.0001f);
+	if(w_max < z_near_ || w_min > z_far_)
+		return false;
+
+	const float screen_min_x= std::max(std::min(bb_min.x / w_min, bb_min.x / w_max), -0.99f);
+	const float screen_max_x= std::min(std::max(bb_max.x / w_min, bb_max.x / w_max), +0.99f);
+	const float screen_min_y= std::max(std::min(bb_min.y / w_min, bb_min.y / w_max), -0.99f);
+	const float screen_max_y= std::min(std::max(bb_max.y / w_min, bb_max.y / w_max), +0.99f);
+	if(screen_min_x > screen_max_x || screen_min_y > screen_max_y)
+		return false;
+
+	Element element;
+	element.w_center=
+		matrix_.value[ 3] * center.x +
+		matrix_.value[ 7] * center.y +
+		matrix_.value[11] * center.z +
+		matrix_.value[15];
+	element.w_min= w_min;
+	element.w_max= w_max;
+	element.tile_min_x= uint16_t((screen_min_x * 0.5f + 0.5f) * float(tiles_x_));
+	element.tile_max_x= uint16_t((screen_max_x * 0.5f + 0.5f) * float(tiles_x_));
+	element.tile_min_y= uint16_t((screen_min_y * 0.5f + 0.5f) * float(tiles_y_));
+	element.tile_max_y= uint16_t((screen_max_y * 0.5f + 0.5f) * float(tiles_y_));
+	KK_ASSERT(element.tile_max_x < tiles_x_);
+	KK_ASSERT(element.tile_max_y < tiles_y_);
+
+	elements_.push_back(element);
+	return true;
+}
+
+void ZBinsBuilder::Build()
+{
+	// Sort by depth of center. Use index for ordering of elements with same depth, in order to get stable result.
+	sorted_elements_.clear();
+	for(size_t i= 0u; i < elements_.size(); ++i)
+		sorted_elements_.push_back(ElementIndex(i));
+
+	std::sort(
+		sorted_elements_.begin(),
+		sorted_elements_.end(),
+		[&](const ElementIndex l, const ElementIndex r)
+		{
+			if(elements_[l].w_center != elements_[r].w_center)
+				return elements_[l].w_center < elements_[r].w_center;
+			return l < r;
+		});
+
+	words_per_tile_= (elements_.size() + c_bits_in_mask_word - 1u) / c_bits_in_mask_word;
+	std::fill(bins_.begin(), bins_.end(), c_empty_bin);
+	std::fill(tile_masks_.begin(), tile_masks_.begin() + ptrdiff_t(tiles_x_ * tiles_y_ * words_per_tile_), 0u);
+
+	for(size_t i= 0u; i < sorted_elements_.size(); ++i)
+	{
+		const Element& element= elements_[sorted_elements_[i]];
+
+		// Extend range of indices of each bin, touched by element.
+		const int32_t bin_min= std::max(int32_t(WMappingFunction(w_convert_values_, element.w_min)), 0);
+		const int32_t bin_max= std::min(int32_t(WMappingFunction(w_convert_values_, element.w_max)), int32_t(bin_count_) - 1);
+		for(int32_t bin= bin_min; bin <= bin_max; ++bin)
+		{
+			BinType& bin_value= bins_[size_t(bin)];
+			const BinType index_min= std::min(bin_value & 0xFFFFu, BinType(i));
+			const BinType index_max= std::max(bin_value >> 16u, BinType(i));
+			bin_value= index_min | (index_max << 16u);
+		}
+
+		// Set bit of element in masks of tiles.
+		const size_t word_index= i / c_bits_in_mask_word;
+		const MaskWord bit= MaskWord(1u) << (i % c_bits_in_mask_word);
+		for(uint32_t y= element.tile_min_y; y <= element.tile_max_y; ++y)
+		for(uint32_t x= element.tile_min_x; x <= element.tile_max_x; ++x)
+			tile_masks_[(x + y * tiles_x_) * words_per_tile_ + word_index]|= bit;
+	}
+}
+
+uint32_t ZBinsBuilder::GetTilesX() const
+{
+	return tiles_x_;
+}
+
+uint32_t ZBinsBuilder::GetTilesY() const
+{
+	return tiles_y_;
+}
+
+uint32_t ZBinsBuilder::GetBinCount() const
+{
+	return bin_count_;
+}
+
+size_t ZBinsBuilder::GetMaxElements() const
+{
+	return max_elements_;
+}
+
+size_t ZBinsBuilder::GetElementCount() const
+{
+	return elements_.size();
+}
+
+m_Vec2 ZBinsBuilder::GetWConvertValues() const
+{
+	return w_convert_values_;
+}
+
+const std::vector<ZBinsBuilder::ElementIndex>& ZBinsBuilder::GetSortedElements() const
+{
+	return sorted_elements_;
+}
+
+const std::vector<ZBinsBuilder::BinType>& ZBinsBuilder::GetBins() const
+{
+	return bins_;
+}
+
+const ZBinsBuilder::MaskWord* ZBinsBuilder::GetTileMasks() const
+{
+	return tile_masks_.data();
+}
+
+size_t ZBinsBuilder::GetWordsPerTile() const
+{
+	return words_per_tile_;
+}
+
+} // namespace KK
@@ -0,0 +1,80 @@
+#pragma once
+#include "../MathLib/Mat.hpp"
+#include <cstdint>
+#include <vector>
+
+
+namespace KK
+{
+
+// Alternative to clusters volume.
+// Elements are sorted by depth, after that range of indices of elements is calculated for each depth bin
+// and bit mask of elements is calculated for each screen tile. Shader intersects range of bin with mask of tile.
+// Memory is proportional to number of tiles + number of bins, instead of number of clusters * lists size.
+// All storage is preallocated, so, no dynamic allocations are needed for each frame.
+class ZBinsBuilder final
+{
+public:
+	// Packed min (low 16 bits) and max (high 16 bits) index of elements in sorted order. Min is greater, than max for empty bins.
+	using BinType= uint32_t;
+	using MaskWord= uint32_t;
+	using ElementIndex= uint16_t;
+
+	static constexpr BinType c_empty_bin= 0x0000FFFFu;
+	static constexpr size_t c_bits_in_mask_word= 32u;
+
+public:
+	ZBinsBuilder(uint32_t tiles_x, uint32_t tiles_y, uint32_t bin_count, size_t max_elements);
+
+	// Matrix must be rigid view transformation, multiplied by perspective projection.
+	void SetMatrix(const m_Mat4& mat, float z_near, float z_far);
+	void Clear();
+
+	// Returns true, if added. Source index of element is number of previously added elements.
+	bool AddSphere(const m_Vec3& center, float radius);
+
+	// Sort elements and fill bins and masks. Call this after all elements are added.
+	void Build();
+
+	uint32_t GetTilesX() const;
+	uint32_t GetTilesY() const;
+	uint32_t GetBinCount() const;
+	size_t GetMaxElements() const;
+	size_t GetElementCount() const;
+	m_Vec2 GetWConvertValues() const; // Same mapping, as in clusters volume, but for bins.
+
+	// Results of "Build".
+	const std::vector<ElementIndex>& GetSortedElements() const; // Source indices of elements in sorted order.
+	const std::vector<BinType>& GetBins() const;
+	const MaskWord* GetTileMasks() const;
+	size_t GetWordsPerTile() const; // Depends on number of elements.
+
+private:
+	struct Element
+	{
+		float w_center;
+		float w_min;
+		float w_max;
+		uint16_t tile_min_x, tile_max_x;
+		uint16_t tile_min_y, tile_max_y;
+	};
+
+private:
+	const uint32_t tiles_x_;
+	const uint32_t tiles_y_;
+	const uint32_t bin_count_;
+	const size_t max_elements_;
+
+	m_Mat4 matrix_;
+	float z_near_= 1.0f;
+	float z_far_= 1.0f;
+	m_Vec2 w_convert_values_;
+
+	std::vector<Element> elements_; // In order of addition.
+	std::vector<ElementIndex> sorted_elements_;
+	std::vector<BinType> bins_;
+	std::vector<MaskWord> tile_masks_; // For each tile "words_per_tile_" words.
+	size_t words_per_tile_= 0u;
+};
+
+} // namespace KK
@@ -0,0 +1,245 @@
+#version 450
+
+// Each invocation builds lights list for one cluster.
+// Light projections are calculated once per workgroup and stored in shared memory.
+// In regular mode all calculations must match calculations in "ClusterVolumeBuilder" class.
+// In tiled mode slices of each tile are placed between min and max depth of this tile.
+
+layout(local_size_x= 64) in; // Must match size in C++ code.
+
+struct Light
+{
+	vec4 pos;
+	vec4 color;
+	vec2 data; // .y contains radius
+	ivec2 shadowmap_index;
+};
+
+layout(set= 0, binding= 0, std430) buffer readonly light_buffer_block
+{
+	vec4 ambient_color;
+	ivec4 cluster_volume_size;
+	vec2 viewport_size;
+	vec2 w_convert_values;
+	ivec4 lights_options; // .x - 0 for 8-bit ids, 1 for 16-bit ids; .y - 1 if static lights grid is used
+	Light lights[];
+};
+
+layout(set= 0, binding= 1, std430) buffer writeonly cluster_offset_buffer_block
+{
+	int light_offsets[];
+};
+
+// Lists of bytes or shorts, packed into words.
+layout(set= 0, binding= 2, std430) buffer lights_list_buffer_block
+{
+	uint light_list_words[];
+};
+
+layout(set= 0, binding= 3, std430) buffer counter_buffer_block
+{
+	uint lights_list_allocated;
+};
+
+layout(set= 0, binding= 4, std430) buffer readonly tile_depth_bounds_buffer_block
+{
+	vec2 tile_depth_bounds[]; // .x - min W, .y - max W
+};
+
+layout(push_constant) uniform uniforms_block
+{
+	mat4 view_matrix;
+	vec2 projection_scale;
+	int light_count;
+	int refinement_enabled;
+	int tiled_mode;
+};
+
+
+shared vec4 shared_light_bb[gl_WorkGroupSize.x]; // xy - min, zw - max
+shared vec2 shared_light_w[gl_WorkGroupSize.x]; // x - min, y - max
+shared vec4 shared_light_sphere[gl_WorkGroupSize.x]; // xyz - view space center, w - radius
+
+float GetSliceW(int slice)
+{
+	return w_convert_values.y / exp2(float(slice) / w_convert_values.x);
+}
+
+void LoadLights(int first_light)
+{
+	int light_index= first_light + int(gl_LocalInvocationID.x);
+	if(light_index < light_count)
+	{
+		vec3 center= lights[light_index].pos.xyz;
+		float radius= lights[light_index].data.y;
+
+		vec2 bb_min= vec2(+1.0e24, +1.0e24);
+		vec2 bb_max= vec2(-1.0e24, -1.0e24);
+		float w_min= +1.0e24;
+		float w_max= -1.0e24;
+		for(int i= 0; i < 8; ++i)
+		{
+			vec3 corner=
+				center + vec3(
+					((i & 4) == 0) ? radius : -radius,
+					((i & 2) == 0) ? radius : -radius,
+					((i & 1) == 0) ? radius : -radius);
+			vec4 proj= view_matrix * vec4(corner, 1.0);
+			bb_min= min(bb_min, proj.xy);
+			bb_max= max(bb_max, proj.xy);
+			w_min= min(w_min, proj.w);
+			w_max= max(w_max, proj.w);
+		}
+
+		vec4 center_proj= view_matrix * vec4(center, 1.0);
+
+		shared_light_bb[gl_LocalInvocationID.x]= vec4(bb_min, bb_max);
+		shared_light_w[gl_LocalInvocationID.x]= vec2(max(w_min, 0.0001), max(w_max, 0.0001));
+		shared_light_sphere[gl_LocalInvocationID.x]= vec4(center_proj.xy / projection_scale, center_proj.w, radius);
+	}
+
+	barrier();
+}
+
+// Check distance from sphere center to view space bounding box of cluster.
+bool IsLightIntersectsClusterBox(uint light_local_index, ivec3 cluster, float slice_border_w_min, float slice_border_w_max)
+{
+	vec2 ndc_min= vec2(cluster.xy    ) / vec2(cluster_volume_size.xy) * 2.0 - vec2(1.0, 1.0);
+	vec2 ndc_max= vec2(cluster.xy + 1) / vec2(cluster_volume_size.xy) * 2.0 - vec2(1.0, 1.0);
+	vec3 view_min= vec3(min(ndc_min * slice_border_w_min, ndc_min * slice_border_w_max) / projection_scale, slice_border_w_min);
+	vec3 view_max= vec3(max(ndc_max * slice_border_w_min, ndc_max * slice_border_w_max) / projection_scale, slice_border_w_max);
+
+	vec4 sphere= shared_light_sphere[light_local_index];
+	vec3 d= max(vec3(0.0, 0.0, 0.0), max(view_min - sphere.xyz, sphere.xyz - view_max));
+	return dot(d, d) <= sphere.w * sphere.w;
+}
+
+// Slices borders for tiled mode. Use logarithmic distribution inside tile.
+vec2 GetTileSliceBorders(ivec3 cluster)
+{
+	vec2 bounds= tile_depth_bounds[cluster.x + cluster.y * cluster_volume_size.x];
+	float ratio= bounds.y / bounds.x;
+	return
+		bounds.x * vec2(
+			pow(ratio, float(cluster.z    ) / float(cluster_volume_size.z)),
+			pow(ratio, float(cluster.z + 1) / float(cluster_volume_size.z)));
+}
+
+bool IsLightInCluster(uint light_local_index, ivec3 cluster)
+{
+	if(tiled_mode != 0)
+	{
+		vec2 bounds= tile_depth_bounds[cluster.x + cluster.y * cluster_volume_size.x];
+		if(bounds.x > bounds.y) // Tile without geometry.
+			return false;
+
+		vec2 slice_borders= GetTileSliceBorders(cluster);
+		return IsLightIntersectsClusterBox(light_local_index, cluster, slice_borders.x, slice_borders.y);
+	}
+
+	vec2 w= shared_light_w[light_local_index];
+	int slice_min= int(w_convert_values.x * log2(w_convert_values.y / w.x));
+	int slice_max= int(w_convert_values.x * log2(w_convert_values.y / w.y));
+	if(cluster.z < slice_min || cluster.z > slice_max)
+		return false;
+
+	float slice_border_w_min= GetSliceW(cluster.z);
+	float slice_border_w_max= GetSliceW(cluster.z + 1);
+	float slice_w_min= max(w.x, slice_border_w_min);
+	float slice_w_max= min(w.y, slice_border_w_max);
+
+	vec4 bb= shared_light_bb[light_local_index];
+	vec2 slice_min_xy= max(min(bb.xy / slice_w_min, bb.xy / slice_w_max), vec2(-0.99, -0.99));
+	vec2 slice_max_xy= min(max(bb.zw / slice_w_min, bb.zw / slice_w_max), vec2(+0.99, +0.99));
+
+	ivec2 cluster_min= ivec2((slice_min_xy * 0.5 + vec2(0.5, 0.5)) * vec2(cluster_volume_size.xy));
+	ivec2 cluster_max= ivec2((slice_max_xy * 0.5 + vec2(0.5, 0.5)) * vec2(cluster_volume_size.xy));
+	if(any(lessThan(cluster.xy, cluster_min)) || any(greaterThan(cluster.xy, cluster_max)))
+		return false;
+
+	if(refinement_enabled == 0)
+		return true;
+
+	return IsLightIntersectsClusterBox(light_local_index, cluster, slice_border_w_min, slice_border_w_max);
+}
+
+void WriteListElement(uint offset, uint value)
+{
+	if(lights_options.x == 0)
+		atomicOr(light_list_words[offset >> 2], (value & 255) << ((offset & 3) * 8));
+	else
+		atomicOr(light_list_words[offset >> 1], (value & 65535) << ((offset & 1) * 16));
+}
+
+void main()
+{
+	ivec3 size= cluster_volume_size.xyz;
+	uint cluster_count= uint(size.x * size.y * size.z);
+	uint cluster_index= gl_GlobalInvocationID.x;
+	bool cluster_valid= cluster_index < cluster_count;
+	ivec3 cluster=
+		ivec3(
+			int(cluster_index) % size.x,
+			int(cluster_index) / size.x % size.y,
+			int(cluster_index) / (size.x * size.y));
+
+	// Count lights. All invocations must participate in lights loading, even for invalid clusters.
+	uint count= 0;
+	for(int first_light= 0; first_light < light_count; first_light+= int(gl_WorkGroupSize.x))
+	{
+		LoadLights(first_light);
+
+		uint lights_in_group= uint(min(light_count - first_light, int(gl_WorkGroupSize.x)));
+		if(cluster_valid)
+		{
+			for(uint i= 0; i < lights_in_group; ++i)
+			{
+				if(IsLightInCluster(i, cluster))
+					++count;
+			}
+		}
+
+		barrier();
+	}
+	// Counter must fit into list element.
+	uint elements_per_word= lights_options.x == 0 ? 4u : 2u;
+	count= min(count, lights_options.x == 0 ? 255u : 65535u);
+
+	// Allocate list. In case of overflow use empty list in last word of buffer.
+	uint empty_list_offset= (uint(light_list_words.length()) - 1) * elements_per_word;
+	uint offset= empty_list_offset;
+	if(cluster_valid)
+	{
+		offset= atomicAdd(lights_list_allocated, count + 1);
+		if(offset + count + 1 > empty_list_offset)
+		{
+			offset= empty_list_offset;
+			count= 0;
+		}
+
+		light_offsets[cluster_index]= int(offset);
+		WriteListElement(offset, count);
+	}
+
+	// Write lights, in order of light index.
+	uint written= 0;
+	for(int first_light= 0; first_light < light_count; first_light+= int(gl_WorkGroupSize.x))
+	{
+		LoadLights(first_light);
+
+		uint lights_in_group= uint(min(light_count - first_light, int(gl_WorkGroupSize.x)));
+		if(cluster_valid)
+		{
+			for(uint i= 0; i < lights_in_group && written < count; ++i)
+			{
+				if(IsLightInCluster(i, cluster))
+				{
+					WriteListElement(offset + 1 + written, uint(first_light) + i);
+					++written;
+				}
+			}
+		}
+
+		barrier();
+	}
+}
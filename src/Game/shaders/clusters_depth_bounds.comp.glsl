@@ -0,0 +1,75 @@
+#version 450
+
+// Calculate min/max W of each screen tile, using depth buffer after depth pre-pass.
+// Each workgroup processes one tile.
+
+layout(local_size_x= 8, local_size_y= 8) in;
+
+layout(push_constant) uniform uniforms_block
+{
+	vec4 view_matrix_values; // value 0, 5, 10, 14
+	ivec4 tiles_count; // .xy - number of tiles
+};
+
+layout(binding= 0) uniform sampler2D depth_tex;
+
+layout(set= 0, binding= 1, std430) buffer writeonly tile_depth_bounds_buffer_block
+{
+	vec2 tile_depth_bounds[]; // .x - min W, .y - max W. For tiles without geometry min is greater, than max.
+};
+
+shared uint shared_depth_min;
+shared uint shared_depth_max;
+
+void main()
+{
+	ivec2 tile= ivec2(gl_WorkGroupID.xy);
+	ivec2 tex_size= textureSize(depth_tex, 0);
+
+	if(gl_LocalInvocationIndex == 0)
+	{
+		shared_depth_min= floatBitsToUint(1.0);
+		shared_depth_max= floatBitsToUint(0.0);
+	}
+	barrier();
+
+	// Process pixels, which fragment shader maps to this tile. Use same formula, as in fragment shader.
+	ivec2 pixels_begin= max(ivec2(0, 0), tile * tex_size / tiles_count.xy - ivec2(1, 1));
+	ivec2 pixels_end= min(tex_size, (tile + ivec2(1, 1)) * tex_size / tiles_count.xy + ivec2(1, 1));
+
+	float depth_min= 1.0;
+	float depth_max= 0.0;
+	for(int y= pixels_begin.y + int(gl_LocalInvocationID.y); y < pixels_end.y; y+= int(gl_WorkGroupSize.y))
+	for(int x= pixels_begin.x + int(gl_LocalInvocationID.x); x < pixels_end.x; x+= int(gl_WorkGroupSize.x))
+	{
+		ivec2 pixel= ivec2(x, y);
+		ivec2 pixel_tile= ivec2(vec2(tiles_count.xy) * ((vec2(pixel) + vec2(0.5, 0.5)) / vec2(tex_size)));
+		if(pixel_tile != tile)
+			continue;
+
+		float depth= texelFetch(depth_tex, pixel, 0).x;
+		if(depth >= 1.0) // Skip pixels without geometry.
+			continue;
+
+		depth_min= min(depth_min, depth);
+		depth_max= max(depth_max, depth);
+	}
+
+	// Depth values are positive, so, comparison of bits gives same result as comparison of floats.
+	atomicMin(shared_depth_min, floatBitsToUint(depth_min));
+	atomicMax(shared_depth_max, floatBitsToUint(depth_max));
+	barrier();
+
+	if(gl_LocalInvocationIndex == 0)
+	{
+		vec2 bounds= vec2(1.0, 0.0);
+		float tile_depth_min= uintBitsToFloat(shared_depth_min);
+		float tile_depth_max= uintBitsToFloat(shared_depth_max);
+		if(tile_depth_min <= tile_depth_max)
+		{
+			bounds.x= view_matrix_values.w / (tile_depth_min - view_matrix_values.z);
+			bounds.y= view_matrix_values.w / (tile_depth_max - view_matrix_values.z);
+		}
+		tile_depth_bounds[tile.x + tile.y * tiles_count.x]= bounds;
+	}
+}
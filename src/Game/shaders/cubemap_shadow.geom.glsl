@@ -17,6 +17,9 @@ layout(location= 0) in vec3 g_pos[];
 
 layout(location= 0) out vec3 f_pos;
 
+// Invariant, as in other world passes.
+invariant gl_Position;
+
 void main()
 {
 	gl_Layer= gl_InvocationID;
@@ -1,10 +1,4 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
-// in/out - world space position.
-layout(location= 0) in vec3 pos;
-layout(location= 0) out vec3 g_pos;
-
-void main()
-{
-	g_pos= pos;
-}
+#include "inc/cubemap_shadow_vert.glsl"
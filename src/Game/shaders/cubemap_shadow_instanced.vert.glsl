@@ -0,0 +1,6 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Same as "cubemap_shadow.vert", but transforms quantized position of instance into world space.
+#define INSTANCED
+#include "inc/cubemap_shadow_vert.glsl"
@@ -0,0 +1,32 @@
+#version 450
+
+// Build one mip of hierarchical depth pyramid. Each texel contains max depth of 2x2 texels of source image.
+// Source coordinates are clamped, so, source images with odd size are processed properly.
+
+layout(local_size_x= 8, local_size_y= 8) in;
+
+layout(push_constant) uniform uniforms_block
+{
+	ivec4 sizes; // .xy - source size, .zw - destination size
+};
+
+layout(binding= 0) uniform sampler2D src_tex;
+
+layout(binding= 1, r32f) uniform writeonly image2D dst_image;
+
+void main()
+{
+	ivec2 dst_coord= ivec2(gl_GlobalInvocationID.xy);
+	if(dst_coord.x >= sizes.z || dst_coord.y >= sizes.w)
+		return;
+
+	ivec2 src_coord_min= min(dst_coord * 2, sizes.xy - ivec2(1, 1));
+	ivec2 src_coord_max= min(dst_coord * 2 + ivec2(1, 1), sizes.xy - ivec2(1, 1));
+
+	float depth=
+		max(
+			max(texelFetch(src_tex, ivec2(src_coord_min.x, src_coord_min.y), 0).x, texelFetch(src_tex, ivec2(src_coord_max.x, src_coord_min.y), 0).x),
+			max(texelFetch(src_tex, ivec2(src_coord_min.x, src_coord_max.y), 0).x, texelFetch(src_tex, ivec2(src_coord_max.x, src_coord_max.y), 0).x));
+
+	imageStore(dst_image, dst_coord, vec4(depth, 0.0, 0.0, 0.0));
+}
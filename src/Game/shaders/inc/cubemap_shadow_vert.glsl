@@ -0,0 +1,33 @@
+// Common code of cubemap shadow vertex shaders. Variant is selected via defines:
+// INSTANCED - transform quantized position of instance into world space.
+
+layout(push_constant) uniform uniforms_block
+{
+	vec4 light_pos;
+	float vertex_pos_step; // Unused in instanced mode.
+	uint vertex_pos_first_box; // Unused in instanced mode.
+};
+
+#ifndef INSTANCED
+layout(binding= 1, std430) buffer readonly vertex_pos_boxes_block
+{
+	vec4 vertex_pos_boxes[]; // .xyz - offset
+};
+#endif
+
+layout(location= 0) in uvec4 pos; // Quantized, .w contains index of quantization box.
+#ifdef INSTANCED
+layout(location= 1) in vec4 instance_pos_transform_x;
+layout(location= 2) in vec4 instance_pos_transform_y;
+layout(location= 3) in vec4 instance_pos_transform_z;
+#endif
+
+// World space position. It is transformed into clip space in geometry shader.
+layout(location= 0) out vec3 g_pos;
+
+#include "world_pos.glsl"
+
+void main()
+{
+	g_pos= CalculateWorldPos(pos);
+}
@@ -0,0 +1,34 @@
+// Common code of world depth-only vertex shaders. Variant is selected via defines:
+// INSTANCED - transform vertices of segment model with transformation of instance.
+
+layout(push_constant) uniform uniforms_block
+{
+	mat4 mat;
+	float vertex_pos_step; // Unused in instanced mode.
+	uint vertex_pos_first_box; // Unused in instanced mode.
+};
+
+#ifndef INSTANCED
+layout(set= 0, binding= 0, std430) buffer readonly vertex_pos_boxes_block
+{
+	vec4 vertex_pos_boxes[]; // .xyz - offset
+};
+#endif
+
+layout(location=0) in uvec4 pos; // Quantized, .w contains index of quantization box.
+#ifdef INSTANCED
+layout(location=1) in vec4 instance_pos_transform_x;
+layout(location=2) in vec4 instance_pos_transform_y;
+layout(location=3) in vec4 instance_pos_transform_z;
+#endif
+
+invariant gl_Position;
+
+#include "world_pos.glsl"
+
+void main()
+{
+	// Calculate position exactly as in main pass, in order to pass "equal" depth test.
+	vec3 world_pos= CalculateWorldPos(pos);
+	gl_Position= mat * vec4(world_pos, 1.0);
+}
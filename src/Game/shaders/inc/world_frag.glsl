@@ -0,0 +1,230 @@
+// Common code of world fragment shaders. Variant is selected via defines:
+// BINDLESS - textures of all materials are fetched from single array, using index of material.
+
+struct Light
+{
+	vec4 pos; // .z contains fade factor for light radius.
+	vec4 color;
+	vec2 data; // .x contains invert radius, .y contains radius
+	ivec2 shadowmap_index; // .x - number of cubemap array, .y - layer number
+};
+
+layout(set= 0, binding= 0, std430) buffer readonly light_buffer_block
+{
+	// Use vec4 for fit alignment.
+	vec4 ambient_color;
+	ivec4 cluster_volume_size; // .w - 0 for regular mode, 1 for tiled mode, 2 for Z-binning mode
+	vec2 viewport_size;
+	vec2 w_convert_values;
+	ivec4 lights_options; // .x - 0 for 8-bit ids, 1 for 16-bit ids; .y - 1 if static lights grid is used
+	Light lights[];
+};
+
+layout(set= 0, binding= 1, std430) buffer readonly cluster_offset_buffer_block
+{
+	int light_offsets[];
+};
+
+// Lists of bytes or shorts, packed into words.
+layout(set= 0, binding= 2, std430) buffer readonly lights_list_buffer_block
+{
+	uint light_list_words[];
+};
+
+// Used only in tiled mode.
+layout(set= 0, binding= 3, std430) buffer readonly tile_depth_bounds_buffer_block
+{
+	vec2 tile_depth_bounds[]; // .x - min W, .y - max W
+};
+
+layout(set= 0, binding= 4) uniform sampler2D ambient_occlusion_image;
+
+layout(set= 0, binding= 5) uniform samplerCubeArrayShadow depth_cubemaps_array[4];
+
+// Used only in Z-binning mode.
+layout(set= 0, binding= 6, std430) buffer readonly z_bins_buffer_block
+{
+	ivec4 z_bins_size; // .xy - tiles, .z - words per tile, .w - bins count
+	vec2 z_bins_w_convert_values;
+	vec2 z_bins_padding;
+	uint z_bins_data[]; // Bins (packed min and max light index), followed by tiles masks.
+};
+
+// Used only in static lights grid mode.
+layout(set= 0, binding= 7, std430) buffer readonly static_lights_buffer_block
+{
+	Light static_lights[]; // Shadowmap index is not used.
+};
+
+// Offsets of cells (in 16-bit elements), followed by lists of 16-bit elements, packed into words.
+layout(set= 0, binding= 11, std430) buffer readonly static_lights_grid_buffer_block
+{
+	ivec4 static_lights_grid_size; // .xyz - cells
+	vec4 static_lights_grid_start; // .w - inverse cell size
+	uint static_lights_grid_data[];
+};
+
+layout(set= 0, binding= 12, std430) buffer readonly static_lights_shadowmaps_buffer_block
+{
+	uint static_lights_shadowmap_index[]; // Packed array number (low 16 bits) and layer (high 16 bits).
+};
+
+// Marker of light of invisible sector.
+const uint c_static_light_invisible_sector= 0xFFFFFFFFu;
+
+#ifdef BINDLESS
+// Albedo, normals, occlusion for each material.
+layout(set= 1, binding= 8) uniform sampler2D material_textures[];
+#else
+layout(set= 1, binding=  8) uniform sampler2D albedo_tex;
+layout(set= 1, binding=  9) uniform sampler2D normals_tex;
+layout(set= 1, binding= 10) uniform sampler2D occlusion_tex;
+#endif
+
+layout(location= 0) in mat3 f_texture_space_mat;
+layout(location= 3) in vec2 f_tex_coord;
+layout(location= 4) in vec3 f_pos; // World space position.
+#ifdef BINDLESS
+layout(location= 5) flat in uint f_material_index;
+#endif
+
+layout(location = 0) out vec4 out_color;
+
+int GetListElement(int index)
+{
+	if(lights_options.x == 0)
+		return int((light_list_words[index >> 2] >> ((index & 3) * 8)) & 255u);
+	else
+		return int((light_list_words[index >> 1] >> ((index & 1) * 16)) & 65535u);
+}
+
+vec3 CalculateLight(Light light, vec3 normal_normalized)
+{
+	vec3 vec_to_light= light.pos.xyz - f_pos;
+	vec3 vec_to_light_normalized= normalize(vec_to_light);
+	float vec_to_light_square_length= dot(vec_to_light, vec_to_light);
+	float cos_factor= max(dot(normal_normalized, vec_to_light_normalized), 0.0);
+	float fade_factor= max(1.0 / vec_to_light_square_length - light.pos.w, 0.0);
+	float normalized_distance_to_light= length(vec_to_light) * light.data.x;
+
+	vec4 shadowmap_coord= vec4(vec_to_light, float(light.shadowmap_index.y));
+	float shadow_factor= 1.0;
+	if(light.shadowmap_index.x == 0)
+		shadow_factor= texture(depth_cubemaps_array[0], shadowmap_coord, normalized_distance_to_light);
+	else if(light.shadowmap_index.x == 1)
+		shadow_factor= texture(depth_cubemaps_array[1], shadowmap_coord, normalized_distance_to_light);
+	else if(light.shadowmap_index.x == 2)
+		shadow_factor= texture(depth_cubemaps_array[2], shadowmap_coord, normalized_distance_to_light);
+	else if(light.shadowmap_index.x == 3)
+		shadow_factor= texture(depth_cubemaps_array[3], shadowmap_coord, normalized_distance_to_light);
+
+	return light.color.rgb * (cos_factor * fade_factor * shadow_factor);
+}
+
+void main()
+{
+	// Do mipmapped images fetches before any branching, because branching may break mip calculation.
+
+#ifdef BINDLESS
+	// Fragments of different draws may be processed together, so, index is not uniform.
+	uint textures_offset= f_material_index * 3u;
+	vec4 albedo_alpha= texture(material_textures[nonuniformEXT(textures_offset + 0u)], f_tex_coord);
+	float occlusion= texture(material_textures[nonuniformEXT(textures_offset + 2u)], f_tex_coord).r;
+	vec4 normal_map_value= texture(material_textures[nonuniformEXT(textures_offset + 1u)], f_tex_coord);
+#else
+	vec4 albedo_alpha= texture(albedo_tex, f_tex_coord);
+	float occlusion= texture(occlusion_tex, f_tex_coord).r;
+	vec4 normal_map_value= texture(normals_tex, f_tex_coord);
+#endif
+
+	// Reconstruct z, because normal map may not contain it or may be invalud.
+	vec2 map_normal_xy= normal_map_value.xy * 2.0 - vec2(1.0, 1.0);
+	vec3 map_normal= vec3(map_normal_xy, sqrt(max(0.0, 1.0 - dot(map_normal_xy, map_normal_xy))));
+	vec3 normal_normalized= normalize(f_texture_space_mat * map_normal);
+
+	vec2 frag_coord_normalized= gl_FragCoord.xy / viewport_size;
+
+	vec3 l= ambient_color.rgb * (0.5 + 0.5 * occlusion * texture(ambient_occlusion_image, frag_coord_normalized).r);
+
+	if(cluster_volume_size.w == 2)
+	{
+		// Lights are sorted by depth. Bin contains range of lights indices, tile contains mask of lights. Process intersection of them.
+		int bin= clamp(int(z_bins_w_convert_values.x * log2(z_bins_w_convert_values.y * gl_FragCoord.w)), 0, z_bins_size.w - 1);
+		uint bin_value= z_bins_data[bin];
+		int light_min= int(bin_value & 65535u);
+		int light_max= int(bin_value >> 16);
+
+		ivec2 tile= min(ivec2(vec2(z_bins_size.xy) * frag_coord_normalized), z_bins_size.xy - ivec2(1, 1));
+		int mask_offset= z_bins_size.w + (tile.x + tile.y * z_bins_size.x) * z_bins_size.z;
+
+		// For empty bins min is greater, than max, so, loop has no iterations.
+		for(int word_index= light_min >> 5; word_index <= (light_max >> 5); ++word_index)
+		{
+			int word_first_light= word_index << 5;
+			uint mask= z_bins_data[mask_offset + word_index];
+			if(light_min > word_first_light)
+				mask&= ~0u << uint(light_min - word_first_light);
+			if(light_max < word_first_light + 31)
+				mask&= ~0u >> uint(word_first_light + 31 - light_max);
+
+			while(mask != 0u)
+			{
+				int bit= findLSB(mask);
+				mask&= mask - 1u;
+				l+= CalculateLight(lights[word_first_light + bit], normal_normalized);
+			}
+		}
+	}
+	else
+	{
+		vec3 cluster_coord;
+		cluster_coord.xy= cluster_volume_size.xy * frag_coord_normalized;
+		if(cluster_volume_size.w == 0)
+			cluster_coord.z= w_convert_values.x * log2(w_convert_values.y * gl_FragCoord.w);
+		else
+		{
+			// Slices are distributed logarithmically between min and max W of tile.
+			vec2 bounds= tile_depth_bounds[int(cluster_coord.x) + int(cluster_coord.y) * cluster_volume_size.x];
+			float w= 1.0 / gl_FragCoord.w;
+			cluster_coord.z= float(cluster_volume_size.z) * log2(w / bounds.x) / max(log2(bounds.y / bounds.x), 1.0e-6);
+			cluster_coord.z= clamp(cluster_coord.z, 0.0, float(cluster_volume_size.z) - 0.5);
+		}
+		int offset= int(light_offsets[
+			int(cluster_coord.x) +
+			int(cluster_coord.y) * cluster_volume_size.x +
+			int(cluster_coord.z) * (cluster_volume_size.x * cluster_volume_size.y) ]);
+
+		int current_light_count= GetListElement(offset);
+		for(int i= 0; i < current_light_count; ++i)
+			l+= CalculateLight(lights[GetListElement(offset + 1 + i)], normal_normalized);
+	}
+
+	if(lights_options.y != 0)
+	{
+		ivec3 cell= clamp(
+			ivec3((f_pos - static_lights_grid_start.xyz) * static_lights_grid_start.w),
+			ivec3(0, 0, 0),
+			static_lights_grid_size.xyz - ivec3(1, 1, 1));
+		int cell_count= static_lights_grid_size.x * static_lights_grid_size.y * static_lights_grid_size.z;
+		int offset= int(static_lights_grid_data[cell.x + cell.y * static_lights_grid_size.x + cell.z * (static_lights_grid_size.x * static_lights_grid_size.y)]);
+
+		int current_light_count= int((static_lights_grid_data[cell_count + (offset >> 1)] >> ((offset & 1) * 16)) & 65535u);
+		for(int i= 0; i < current_light_count; ++i)
+		{
+			int element_index= offset + 1 + i;
+			int light_index= int((static_lights_grid_data[cell_count + (element_index >> 1)] >> ((element_index & 1) * 16)) & 65535u);
+
+			// Skip lights of invisible sectors, which may shine through walls.
+			// Lights without free shadowmap have out of range array number and are drawn without shadow.
+			uint shadowmap_index= static_lights_shadowmap_index[light_index];
+			if(shadowmap_index == c_static_light_invisible_sector)
+				continue;
+
+			Light light= static_lights[light_index];
+			light.shadowmap_index= ivec2(int(shadowmap_index & 65535u), int(shadowmap_index >> 16));
+			l+= CalculateLight(light, normal_normalized);
+		}
+	}
+
+	out_color= vec4(l * albedo_alpha.rgb, albedo_alpha.a);
+}
@@ -0,0 +1,15 @@
+// Transformation of quantized vertex position into world space. Depth pre-pass and main pass must use same code
+// and "invariant gl_Position" in order to produce exactly same depth for "equal" depth test.
+// Includer must declare "vertex_pos_step", "vertex_pos_first_box" and "vertex_pos_boxes" buffer
+// or (in instanced mode) "instance_pos_transform_x/y/z".
+// Input position - .xyz - quantized position, .w - bit 0 - binormal sign, bits 1-15 - index of quantization box.
+vec3 CalculateWorldPos(uvec4 quantized_pos)
+{
+#ifdef INSTANCED
+	vec4 pos4= vec4(vec3(quantized_pos.xyz), 1.0);
+	return vec3(dot(pos4, instance_pos_transform_x), dot(pos4, instance_pos_transform_y), dot(pos4, instance_pos_transform_z));
+#else
+	// Step is power of two and offset of box is multiple of it, so, result is exact.
+	return vec3(quantized_pos.xyz) * vertex_pos_step + vertex_pos_boxes[vertex_pos_first_box + (quantized_pos.w >> 1)].xyz;
+#endif
+}
@@ -0,0 +1,77 @@
+// Common code of world vertex shaders. Variant is selected via defines:
+// BINDLESS - also pass index of material, which is stored in instance index of draw.
+// INSTANCED - transform vertices of segment model with transformation of instance.
+
+layout(push_constant) uniform uniforms_block
+{
+	mat4 mat;
+	float vertex_pos_step; // Unused in instanced mode.
+	uint vertex_pos_first_box; // Unused in instanced mode.
+};
+
+#ifndef INSTANCED
+layout(set= 0, binding= 13, std430) buffer readonly vertex_pos_boxes_block
+{
+	vec4 vertex_pos_boxes[]; // .xyz - offset
+};
+#endif
+
+layout(location=0) in uvec4 pos; // .xyz - quantized position, .w - binormal sign (bit 0) and quantization box
+layout(location=1) in vec2 tex_coord; // Fixed point.
+layout(location=2) in vec4 tangent_frame; // .xy - normal, .zw - tangent, octahedral encoding.
+#ifdef INSTANCED
+layout(location=3) in vec4 instance_pos_transform_x;
+layout(location=4) in vec4 instance_pos_transform_y;
+layout(location=5) in vec4 instance_pos_transform_z;
+layout(location=6) in vec4 instance_normal_transform; // 2x2 matrix of rotation around Z axis.
+#endif
+
+const float c_tex_coord_scale= 1.0 / 1024.0;
+
+invariant gl_Position;
+
+#include "world_pos.glsl"
+
+layout(location= 0) out mat3 f_texture_space_mat; // mat3 is 3 vectors
+layout(location= 3) out vec2 f_tex_coord;
+layout(location= 4) out vec3 f_pos;
+#ifdef BINDLESS
+layout(location= 5) flat out uint f_material_index;
+#endif
+
+vec3 UnpackDirectionOctahedral(vec2 e)
+{
+	vec3 v= vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(v.z < 0.0)
+		v.xy= (vec2(1.0) - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(v);
+}
+
+#ifdef INSTANCED
+vec3 RotateDirection(vec3 v)
+{
+	return vec3(dot(v.xy, instance_normal_transform.xy), dot(v.xy, instance_normal_transform.zw), v.z);
+}
+#endif
+
+void main()
+{
+	vec3 normal= UnpackDirectionOctahedral(tangent_frame.xy);
+	vec3 tangent= UnpackDirectionOctahedral(tangent_frame.zw);
+#ifdef INSTANCED
+	normal= RotateDirection(normal);
+	tangent= RotateDirection(tangent);
+#endif
+	vec3 binormal= cross(normal, tangent) * ((pos.w & 1u) != 0u ? 1.0 : -1.0);
+
+	// Calculate position exactly as in depth pre-pass, in order to pass "equal" depth test.
+	vec3 world_pos= CalculateWorldPos(pos);
+
+	f_texture_space_mat= mat3(binormal, tangent, normal);
+	f_tex_coord= tex_coord * c_tex_coord_scale;
+	f_pos= world_pos;
+	gl_Position= mat * vec4(world_pos, 1.0);
+#ifdef BINDLESS
+	f_material_index= uint(gl_InstanceIndex);
+#endif
+}
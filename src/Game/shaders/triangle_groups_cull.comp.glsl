@@ -0,0 +1,191 @@
+#version 450
+
+// Cull triangle groups by clip frustums of sectors and (optionally) by hierarchical depth pyramid. Write indirect draw commands.
+
+layout(local_size_x= 64) in;
+
+// Modes.
+const int c_mode_pre_pass_no_occlusion= 0;
+const int c_mode_pre_pass= 1;
+const int c_mode_main_pass= 2;
+
+// Must match constant in C++ code.
+const int c_max_lods= 2;
+
+// Commands lists.
+const int c_list_pre_pass= 0;
+const int c_list_main_pass= 1;
+const int c_list_late_pass= 2;
+
+layout(push_constant) uniform uniforms_block
+{
+	mat4 view_matrix;
+	ivec4 params; // .x - mode, .y - triangle group count, .z - pyramid mip levels, .w - max triangle groups
+	ivec4 depth_size; // .xy - size of depth image
+	vec4 lod_params; // .xyz - camera position, .w - max error of level of detail relative to distance
+};
+
+struct TriangleGroup
+{
+	vec3 bb_min;
+	uint index_count;
+	vec3 bb_max;
+	uint first_index;
+	int vertex_offset;
+	uint sector_index;
+	uint first_instance;
+	uint instance_count;
+	uint lods_first_index[c_max_lods];
+	uint lods_index_count[c_max_lods];
+	float lods_error[c_max_lods];
+	uint lod_count;
+	uint reserved;
+};
+
+struct Sector
+{
+	vec4 planes[5]; // .xyz - normal, .w - dist. Inner side is positive.
+};
+
+layout(binding= 0, std430) buffer readonly triangle_groups_buffer_block
+{
+	TriangleGroup triangle_groups[];
+};
+
+layout(binding= 1, std430) buffer readonly sectors_buffer_block
+{
+	Sector sectors[];
+};
+
+layout(binding= 2, std430) buffer visibility_flags_buffer_block
+{
+	uint visibility_flags[]; // Result of pre-pass culling.
+};
+
+layout(binding= 3, std430) buffer writeonly commands_buffer_block
+{
+	uint commands[]; // VkDrawIndexedIndirectCommand - 5 words for each command.
+};
+
+// Pyramid of max depth. Mip 0 has half size of depth image.
+layout(binding= 4) uniform sampler2D pyramid_tex;
+
+bool IsBoxInsideSectorFrustum(vec3 bb_min, vec3 bb_max, uint sector_index)
+{
+	for(int i= 0; i < 5; ++i)
+	{
+		vec4 plane= sectors[sector_index].planes[i];
+		vec3 corner= vec3(
+			plane.x >= 0.0 ? bb_max.x : bb_min.x,
+			plane.y >= 0.0 ? bb_max.y : bb_min.y,
+			plane.z >= 0.0 ? bb_max.z : bb_min.z);
+		if(dot(corner, plane.xyz) + plane.w < 0.0)
+			return false;
+	}
+	return true;
+}
+
+bool IsBoxVisible(vec3 bb_min, vec3 bb_max)
+{
+	vec2 screen_min= vec2(+1.0e24, +1.0e24);
+	vec2 screen_max= vec2(-1.0e24, -1.0e24);
+	float box_depth_min= 1.0;
+	for(int i= 0; i < 8; ++i)
+	{
+		vec3 corner= vec3(
+			(i & 1) == 0 ? bb_min.x : bb_max.x,
+			(i & 2) == 0 ? bb_min.y : bb_max.y,
+			(i & 4) == 0 ? bb_min.z : bb_max.z);
+
+		vec4 corner_projected= view_matrix * vec4(corner, 1.0);
+		if(corner_projected.w <= 0.0001) // Box intersects near plane or is behind camera - can't cull it.
+			return true;
+
+		vec3 corner_ndc= corner_projected.xyz / corner_projected.w;
+		screen_min= min(screen_min, corner_ndc.xy);
+		screen_max= max(screen_max, corner_ndc.xy);
+		box_depth_min= min(box_depth_min, corner_ndc.z);
+	}
+
+	screen_min= max(screen_min * 0.5 + vec2(0.5, 0.5), vec2(0.0, 0.0));
+	screen_max= min(screen_max * 0.5 + vec2(0.5, 0.5), vec2(1.0, 1.0));
+	if(screen_min.x > screen_max.x || screen_min.y > screen_max.y)
+		return false; // Box is outside screen.
+
+	ivec2 pixels_min= ivec2(screen_min * vec2(depth_size.xy));
+	ivec2 pixels_max= min(ivec2(screen_max * vec2(depth_size.xy)), depth_size.xy - ivec2(1, 1));
+
+	// Select mip, where box covers no more than 2x2 texels. Texel of mip "n" covers 2^(n+1) pixels of depth image.
+	ivec2 extent= pixels_max - pixels_min;
+	int mip= clamp(findMSB(max(extent.x, extent.y)), 0, params.z - 1);
+
+	ivec2 texels_min= pixels_min >> (mip + 1);
+	ivec2 texels_max= pixels_max >> (mip + 1);
+
+	float depth_max= 0.0;
+	for(int y= texels_min.y; y <= texels_max.y; ++y)
+	for(int x= texels_min.x; x <= texels_max.x; ++x)
+		depth_max= max(depth_max, texelFetch(pyramid_tex, ivec2(x, y), mip).x);
+
+	return box_depth_min <= depth_max;
+}
+
+// Select most simplified level of detail with error, small enough for this distance. Same rule is used on CPU.
+// Returns first index and index count.
+uvec2 SelectLod(uint triangle_group_index, vec3 bb_min, vec3 bb_max)
+{
+	vec3 dist_vec= max(max(bb_min - lod_params.xyz, lod_params.xyz - bb_max), vec3(0.0, 0.0, 0.0));
+	float max_error= sqrt(dot(dist_vec, dist_vec)) * lod_params.w;
+
+	uvec2 result= uvec2(triangle_groups[triangle_group_index].first_index, triangle_groups[triangle_group_index].index_count);
+	uint lod_count= min(triangle_groups[triangle_group_index].lod_count, uint(c_max_lods));
+	for(uint i= 0u; i < lod_count && triangle_groups[triangle_group_index].lods_error[i] <= max_error; ++i)
+		result= uvec2(triangle_groups[triangle_group_index].lods_first_index[i], triangle_groups[triangle_group_index].lods_index_count[i]);
+
+	return result;
+}
+
+void WriteCommand(int list, uint triangle_group_index, bool visible, uvec2 lod_indices)
+{
+	uint offset= (uint(list * params.w) + triangle_group_index) * 5u;
+	commands[offset + 0u]= lod_indices.y;
+	commands[offset + 1u]= visible ? triangle_groups[triangle_group_index].instance_count : 0u;
+	commands[offset + 2u]= lod_indices.x;
+	commands[offset + 3u]= uint(triangle_groups[triangle_group_index].vertex_offset);
+	commands[offset + 4u]= triangle_groups[triangle_group_index].first_instance;
+}
+
+void main()
+{
+	uint triangle_group_index= gl_GlobalInvocationID.x;
+	if(triangle_group_index >= uint(params.y))
+		return;
+
+	vec3 bb_min= triangle_groups[triangle_group_index].bb_min;
+	vec3 bb_max= triangle_groups[triangle_group_index].bb_max;
+
+	// Parameters are same in both passes, so, depth pre-pass and main pass use same level of detail.
+	uvec2 lod_indices= SelectLod(triangle_group_index, bb_min, bb_max);
+
+	int mode= params.x;
+	if(mode == c_mode_main_pass)
+	{
+		// Groups, drawn in pre-pass, are already inside clip frustums.
+		bool drawn_in_pre_pass= visibility_flags[triangle_group_index] != 0u;
+		bool visible=
+			(drawn_in_pre_pass || IsBoxInsideSectorFrustum(bb_min, bb_max, triangle_groups[triangle_group_index].sector_index)) &&
+			IsBoxVisible(bb_min, bb_max);
+
+		WriteCommand(c_list_main_pass, triangle_group_index, visible && drawn_in_pre_pass, lod_indices);
+		WriteCommand(c_list_late_pass, triangle_group_index, visible && !drawn_in_pre_pass, lod_indices);
+	}
+	else
+	{
+		bool visible=
+			IsBoxInsideSectorFrustum(bb_min, bb_max, triangle_groups[triangle_group_index].sector_index) &&
+			(mode == c_mode_pre_pass_no_occlusion || IsBoxVisible(bb_min, bb_max));
+		visibility_flags[triangle_group_index]= visible ? 1u : 0u;
+
+		WriteCommand(c_list_pre_pass, triangle_group_index, visible, lod_indices);
+	}
+}
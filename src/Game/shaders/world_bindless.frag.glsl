@@ -0,0 +1,7 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Same as "world.frag", but textures of all materials are fetched from single array, using index of material.
+#define BINDLESS
+#include "inc/world_frag.glsl"
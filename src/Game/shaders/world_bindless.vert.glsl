@@ -0,0 +1,6 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Same as "world.vert", but also passes index of material, which is stored in instance index of draw.
+#define BINDLESS
+#include "inc/world_vert.glsl"
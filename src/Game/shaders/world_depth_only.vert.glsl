@@ -1,13 +1,4 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
-layout(push_constant) uniform uniforms_block
-{
-	mat4 mat;
-};
-
-layout(location=0) in vec3 pos;
-
-void main()
-{
-	gl_Position= mat * vec4(pos, 1.0);
-}
+#include "inc/world_depth_only_vert.glsl"
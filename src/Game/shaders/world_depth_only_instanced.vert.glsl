@@ -0,0 +1,6 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Same as "world_depth_only.vert", but transforms vertices of segment model with transformation of instance.
+#define INSTANCED
+#include "inc/world_depth_only_vert.glsl"
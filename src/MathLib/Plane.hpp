@@ -71,7 +71,7 @@ inline bool m_Plane2::IsPointBehindPlane(const m_Vec2& point) const
 
 inline float m_Plane2::GetSignedDistance(const m_Vec2& point) const
 {
-	return point * normal + dist;
+	return point.x * normal.x + point.y * normal.y + dist;
 }
 
 /*
@@ -94,7 +94,7 @@ inline bool m_Plane3::IsPointBehindPlane(const m_Vec3& point) const
 
 inline float m_Plane3::GetSignedDistance(const m_Vec3& point) const
 {
-	return point * normal + dist;
+	return mVec3Dot(point, normal) + dist;
 }
 
 } // namespace KK